@@ -6,4 +6,4 @@ cd "$rootdir"
 rootdir=`pwd`
 export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:"$rootdir"
 cd "$cwdir"
-"$rootdir/gxttool" "$1" "$2" "$3" "$4" "$5" "$6"
+"$rootdir/gxttool" "$@"
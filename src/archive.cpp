@@ -0,0 +1,395 @@
+#include "archive.h"
+#include <time.h>
+#include <zlib.h>
+
+const u32 CArchive::s_uCopyBufferSize = 1024 * 1024;
+
+// tar has no index of its own, the last entry lists where every entry's data starts
+const string CArchive::s_sIndexFileName = "gxttool_archive_index.txt";
+
+CArchive::CArchive()
+	: m_fp(nullptr)
+	, m_eType(kTypeTar)
+	, m_uOffset(0)
+	, m_uTime(0)
+	, m_uDosTime(0)
+{
+}
+
+CArchive::~CArchive()
+{
+	Abort();
+}
+
+// the archive is written under a temp name and only gets its own name once it is complete
+bool CArchive::Open(const UString& a_sFileName, EType a_eType)
+{
+	m_sFileName = a_sFileName;
+	m_sTempFileName = a_sFileName + USTR(".tmp");
+	m_fp = UFopen(m_sTempFileName.c_str(), USTR("wb"));
+	if (m_fp == nullptr)
+	{
+		return false;
+	}
+	m_eType = a_eType;
+	m_uOffset = 0;
+	m_vEntry.clear();
+	m_vCopyBuffer.resize(s_uCopyBufferSize);
+	time_t tNow = time(nullptr);
+	m_uTime = static_cast<u32>(tNow);
+	struct tm* pNow = localtime(&tNow);
+	m_uDosTime = static_cast<u32>(std::max(pNow->tm_year - 80, 0)) << 25 | (pNow->tm_mon + 1) << 21 | pNow->tm_mday << 16 | pNow->tm_hour << 11 | pNow->tm_min << 5 | pNow->tm_sec / 2;
+	return true;
+}
+
+bool CArchive::Close()
+{
+	if (m_fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = m_eType == kTypeTar ? writeTarEnd() : writeZipCentralDirectory();
+	if (fclose(m_fp) != 0)
+	{
+		bResult = false;
+	}
+	m_fp = nullptr;
+	for (vector<FILE*>::iterator it = m_vScratch.begin(); it != m_vScratch.end(); ++it)
+	{
+		fclose(*it);
+	}
+	m_vScratch.clear();
+	m_vFreeScratch.clear();
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	if (bResult)
+	{
+		_wremove(m_sFileName.c_str());
+	}
+	if (!bResult || _wrename(m_sTempFileName.c_str(), m_sFileName.c_str()) != 0)
+	{
+		_wremove(m_sTempFileName.c_str());
+		bResult = false;
+	}
+#else
+	if (!bResult || rename(m_sTempFileName.c_str(), m_sFileName.c_str()) != 0)
+	{
+		remove(m_sTempFileName.c_str());
+		bResult = false;
+	}
+#endif
+	return bResult;
+}
+
+// a failed export leaves no archive behind
+void CArchive::Abort()
+{
+	for (vector<FILE*>::iterator it = m_vScratch.begin(); it != m_vScratch.end(); ++it)
+	{
+		fclose(*it);
+	}
+	m_vScratch.clear();
+	m_vFreeScratch.clear();
+	if (m_fp == nullptr)
+	{
+		return;
+	}
+	fclose(m_fp);
+	m_fp = nullptr;
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	_wremove(m_sTempFileName.c_str());
+#else
+	remove(m_sTempFileName.c_str());
+#endif
+}
+
+bool CArchive::IsOpen() const
+{
+	return m_fp != nullptr;
+}
+
+// outputs are produced in an unlinked scratch file per worker, so no file is created for them
+FILE* CArchive::AcquireScratch()
+{
+	lock_guard<mutex> lock(m_Mutex);
+	if (!m_vFreeScratch.empty())
+	{
+		FILE* fp = m_vFreeScratch.back();
+		m_vFreeScratch.pop_back();
+		return fp;
+	}
+	FILE* fp = tmpfile();
+	if (fp == nullptr)
+	{
+		UPrintf(USTR("ERROR: create scratch file failed\n\n"));
+		return nullptr;
+	}
+	m_vScratch.push_back(fp);
+	return fp;
+}
+
+void CArchive::ReleaseScratch(FILE* a_fpScratch)
+{
+	Fseek(a_fpScratch, 0, SEEK_SET);
+	lock_guard<mutex> lock(m_Mutex);
+	m_vFreeScratch.push_back(a_fpScratch);
+}
+
+// the first a_uSize bytes of the scratch file become one entry, appended to the archive in one run
+bool CArchive::Add(const string& a_sName, FILE* a_fpScratch, u64 a_uSize)
+{
+	fflush(a_fpScratch);
+	Fseek(a_fpScratch, 0, SEEK_SET);
+	bool bResult = true;
+	{
+		lock_guard<mutex> lock(m_Mutex);
+		SEntry entry = { a_sName, m_uOffset, 0, a_uSize, 0 };
+		bResult = m_eType == kTypeTar ? writeTarHeader(a_sName, a_uSize) : writeZipLocalHeader(entry);
+		entry.DataOffset = m_uOffset;
+		entry.Crc32 = crc32(0, nullptr, 0);
+		for (u64 uRemain = a_uSize; bResult && uRemain != 0; )
+		{
+			size_t uCopySize = static_cast<size_t>(std::min<u64>(uRemain, s_uCopyBufferSize));
+			if (fread(&*m_vCopyBuffer.begin(), 1, uCopySize, a_fpScratch) != uCopySize)
+			{
+				UPrintf(USTR("ERROR: read scratch file failed\n\n"));
+				bResult = false;
+				break;
+			}
+			if (m_eType == kTypeZip)
+			{
+				entry.Crc32 = crc32(entry.Crc32, &*m_vCopyBuffer.begin(), static_cast<uInt>(uCopySize));
+			}
+			bResult = write(&*m_vCopyBuffer.begin(), uCopySize);
+			uRemain -= uCopySize;
+		}
+		if (bResult && m_eType == kTypeTar && a_uSize % 512 != 0)
+		{
+			static const u8 c_uPadding[512] = {};
+			bResult = write(c_uPadding, static_cast<size_t>(512 - a_uSize % 512));
+		}
+		else if (bResult && m_eType == kTypeZip)
+		{
+			bResult = writeZipDataDescriptor(entry);
+		}
+		if (bResult)
+		{
+			m_vEntry.push_back(entry);
+		}
+	}
+	ReleaseScratch(a_fpScratch);
+	return bResult;
+}
+
+const UChar* CArchive::GetExtension(EType a_eType)
+{
+	return a_eType == kTypeTar ? USTR("tar") : USTR("zip");
+}
+
+bool CArchive::write(const void* a_pData, size_t a_uSize)
+{
+	if (fwrite(a_pData, 1, a_uSize, m_fp) != a_uSize)
+	{
+		UPrintf(USTR("ERROR: write archive failed\n\n"));
+		return false;
+	}
+	m_uOffset += a_uSize;
+	return true;
+}
+
+bool CArchive::writeTarHeader(const string& a_sName, u64 a_uSize)
+{
+	if (a_sName.size() >= 100)
+	{
+		UPrintf(USTR("ERROR: archive entry name is too long\n\n"));
+		return false;
+	}
+	char szHeader[512] = {};
+	memcpy(szHeader, a_sName.c_str(), a_sName.size());
+	setOctal(szHeader + 100, 8, 0644);
+	setOctal(szHeader + 108, 8, 0);
+	setOctal(szHeader + 116, 8, 0);
+	// sizes that do not fit 11 octal digits use the base-256 form of gnu tar
+	if (a_uSize < SDW_BIT64(33))
+	{
+		setOctal(szHeader + 124, 12, a_uSize);
+	}
+	else
+	{
+		szHeader[124] = static_cast<char>(0x80);
+		for (n32 i = 0; i < 8; i++)
+		{
+			szHeader[128 + i] = static_cast<char>(a_uSize >> (56 - i * 8) & 0xFF);
+		}
+	}
+	setOctal(szHeader + 136, 12, m_uTime);
+	szHeader[156] = '0';
+	memcpy(szHeader + 257, "ustar", 6);
+	memcpy(szHeader + 263, "00", 2);
+	memset(szHeader + 148, ' ', 8);
+	u32 uCheckSum = 0;
+	for (n32 i = 0; i < 512; i++)
+	{
+		uCheckSum += static_cast<u8>(szHeader[i]);
+	}
+	setOctal(szHeader + 148, 7, uCheckSum);
+	return write(szHeader, sizeof(szHeader));
+}
+
+bool CArchive::writeTarEnd()
+{
+	string sIndex;
+	for (vector<SEntry>::iterator it = m_vEntry.begin(); it != m_vEntry.end(); ++it)
+	{
+		char szLine[64] = {};
+		snprintf(szLine, sizeof(szLine), "%llu %llu ", static_cast<unsigned long long>(it->DataOffset), static_cast<unsigned long long>(it->Size));
+		sIndex += szLine + it->Name + "\n";
+	}
+	if (!writeTarHeader(s_sIndexFileName, sIndex.size()) || !write(sIndex.c_str(), sIndex.size()))
+	{
+		return false;
+	}
+	// pad the index and add the two zero records that end the archive
+	vector<u8> vEnd((512 - sIndex.size() % 512) % 512 + 1024, 0);
+	return write(&*vEnd.begin(), vEnd.size());
+}
+
+bool CArchive::writeZipLocalHeader(const SEntry& a_Entry)
+{
+	// crc and sizes follow the data in a descriptor, a zip64 extra marks an entry of 4 GB or more
+	bool bZip64 = a_Entry.Size >= 0xFFFFFFFF;
+	vector<u8> vHeader;
+	putU32(vHeader, 0x04034B50);
+	putU16(vHeader, bZip64 ? 45 : 20);
+	putU16(vHeader, 0x0008);
+	putU16(vHeader, 0);
+	putU32(vHeader, m_uDosTime);
+	putU32(vHeader, 0);
+	putU32(vHeader, bZip64 ? 0xFFFFFFFF : 0);
+	putU32(vHeader, bZip64 ? 0xFFFFFFFF : 0);
+	putU16(vHeader, static_cast<u16>(a_Entry.Name.size()));
+	putU16(vHeader, bZip64 ? 20 : 0);
+	vHeader.insert(vHeader.end(), a_Entry.Name.begin(), a_Entry.Name.end());
+	if (bZip64)
+	{
+		putU16(vHeader, 0x0001);
+		putU16(vHeader, 16);
+		putU64(vHeader, 0);
+		putU64(vHeader, 0);
+	}
+	return write(&*vHeader.begin(), vHeader.size());
+}
+
+bool CArchive::writeZipDataDescriptor(const SEntry& a_Entry)
+{
+	vector<u8> vDescriptor;
+	putU32(vDescriptor, 0x08074B50);
+	putU32(vDescriptor, a_Entry.Crc32);
+	if (a_Entry.Size >= 0xFFFFFFFF)
+	{
+		putU64(vDescriptor, a_Entry.Size);
+		putU64(vDescriptor, a_Entry.Size);
+	}
+	else
+	{
+		putU32(vDescriptor, static_cast<u32>(a_Entry.Size));
+		putU32(vDescriptor, static_cast<u32>(a_Entry.Size));
+	}
+	return write(&*vDescriptor.begin(), vDescriptor.size());
+}
+
+bool CArchive::writeZipCentralDirectory()
+{
+	u64 uDirectoryOffset = m_uOffset;
+	vector<u8> vDirectory;
+	for (vector<SEntry>::iterator it = m_vEntry.begin(); it != m_vEntry.end(); ++it)
+	{
+		bool bZip64Size = it->Size >= 0xFFFFFFFF;
+		bool bZip64Offset = it->HeaderOffset >= 0xFFFFFFFF;
+		u16 uExtraSize = (bZip64Size ? 16 : 0) + (bZip64Offset ? 8 : 0);
+		putU32(vDirectory, 0x02014B50);
+		putU16(vDirectory, 45);
+		putU16(vDirectory, bZip64Size || bZip64Offset ? 45 : 20);
+		putU16(vDirectory, 0x0008);
+		putU16(vDirectory, 0);
+		putU32(vDirectory, m_uDosTime);
+		putU32(vDirectory, it->Crc32);
+		putU32(vDirectory, bZip64Size ? 0xFFFFFFFF : static_cast<u32>(it->Size));
+		putU32(vDirectory, bZip64Size ? 0xFFFFFFFF : static_cast<u32>(it->Size));
+		putU16(vDirectory, static_cast<u16>(it->Name.size()));
+		putU16(vDirectory, uExtraSize == 0 ? 0 : uExtraSize + 4);
+		putU16(vDirectory, 0);
+		putU16(vDirectory, 0);
+		putU16(vDirectory, 0);
+		putU32(vDirectory, 0);
+		putU32(vDirectory, bZip64Offset ? 0xFFFFFFFF : static_cast<u32>(it->HeaderOffset));
+		vDirectory.insert(vDirectory.end(), it->Name.begin(), it->Name.end());
+		if (uExtraSize != 0)
+		{
+			putU16(vDirectory, 0x0001);
+			putU16(vDirectory, uExtraSize);
+			if (bZip64Size)
+			{
+				putU64(vDirectory, it->Size);
+				putU64(vDirectory, it->Size);
+			}
+			if (bZip64Offset)
+			{
+				putU64(vDirectory, it->HeaderOffset);
+			}
+		}
+	}
+	u64 uDirectorySize = vDirectory.size();
+	u64 uEntryCount = m_vEntry.size();
+	// a run of a million textures needs the zip64 end record for the entry count alone
+	bool bZip64 = uEntryCount >= 0xFFFF || uDirectoryOffset >= 0xFFFFFFFF || uDirectorySize >= 0xFFFFFFFF;
+	if (bZip64)
+	{
+		u64 uRecordOffset = uDirectoryOffset + uDirectorySize;
+		putU32(vDirectory, 0x06064B50);
+		putU64(vDirectory, 44);
+		putU16(vDirectory, 45);
+		putU16(vDirectory, 45);
+		putU32(vDirectory, 0);
+		putU32(vDirectory, 0);
+		putU64(vDirectory, uEntryCount);
+		putU64(vDirectory, uEntryCount);
+		putU64(vDirectory, uDirectorySize);
+		putU64(vDirectory, uDirectoryOffset);
+		putU32(vDirectory, 0x07064B50);
+		putU32(vDirectory, 0);
+		putU64(vDirectory, uRecordOffset);
+		putU32(vDirectory, 1);
+	}
+	putU32(vDirectory, 0x06054B50);
+	putU16(vDirectory, 0);
+	putU16(vDirectory, 0);
+	putU16(vDirectory, bZip64 ? 0xFFFF : static_cast<u16>(uEntryCount));
+	putU16(vDirectory, bZip64 ? 0xFFFF : static_cast<u16>(uEntryCount));
+	putU32(vDirectory, bZip64 ? 0xFFFFFFFF : static_cast<u32>(uDirectorySize));
+	putU32(vDirectory, bZip64 ? 0xFFFFFFFF : static_cast<u32>(uDirectoryOffset));
+	putU16(vDirectory, 0);
+	return write(&*vDirectory.begin(), vDirectory.size());
+}
+
+void CArchive::setOctal(char* a_pField, u32 a_uFieldSize, u64 a_uValue)
+{
+	snprintf(a_pField, a_uFieldSize, "%0*llo", static_cast<int>(a_uFieldSize - 1), static_cast<unsigned long long>(a_uValue));
+}
+
+void CArchive::putU16(vector<u8>& a_vData, u16 a_uValue)
+{
+	a_vData.push_back(static_cast<u8>(a_uValue));
+	a_vData.push_back(static_cast<u8>(a_uValue >> 8));
+}
+
+void CArchive::putU32(vector<u8>& a_vData, u32 a_uValue)
+{
+	putU16(a_vData, static_cast<u16>(a_uValue));
+	putU16(a_vData, static_cast<u16>(a_uValue >> 16));
+}
+
+void CArchive::putU64(vector<u8>& a_vData, u64 a_uValue)
+{
+	putU32(a_vData, static_cast<u32>(a_uValue));
+	putU32(a_vData, static_cast<u32>(a_uValue >> 32));
+}
@@ -0,0 +1,60 @@
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <sdw.h>
+#include <mutex>
+
+class CArchive
+{
+public:
+	enum EType
+	{
+		kTypeTar,
+		kTypeZip
+	};
+	CArchive();
+	~CArchive();
+	bool Open(const UString& a_sFileName, EType a_eType);
+	bool Close();
+	void Abort();
+	bool IsOpen() const;
+	FILE* AcquireScratch();
+	void ReleaseScratch(FILE* a_fpScratch);
+	bool Add(const string& a_sName, FILE* a_fpScratch, u64 a_uSize);
+	static const UChar* GetExtension(EType a_eType);
+private:
+	struct SEntry
+	{
+		string Name;
+		u64 HeaderOffset;
+		u64 DataOffset;
+		u64 Size;
+		u32 Crc32;
+	};
+	bool write(const void* a_pData, size_t a_uSize);
+	bool writeTarHeader(const string& a_sName, u64 a_uSize);
+	bool writeTarEnd();
+	bool writeZipLocalHeader(const SEntry& a_Entry);
+	bool writeZipDataDescriptor(const SEntry& a_Entry);
+	bool writeZipCentralDirectory();
+	static void setOctal(char* a_pField, u32 a_uFieldSize, u64 a_uValue);
+	static void putU16(vector<u8>& a_vData, u16 a_uValue);
+	static void putU32(vector<u8>& a_vData, u32 a_uValue);
+	static void putU64(vector<u8>& a_vData, u64 a_uValue);
+	static const u32 s_uCopyBufferSize;
+	static const string s_sIndexFileName;
+	UString m_sFileName;
+	UString m_sTempFileName;
+	FILE* m_fp;
+	EType m_eType;
+	u64 m_uOffset;
+	u32 m_uTime;
+	u32 m_uDosTime;
+	vector<SEntry> m_vEntry;
+	vector<FILE*> m_vScratch;
+	vector<FILE*> m_vFreeScratch;
+	vector<u8> m_vCopyBuffer;
+	mutex m_Mutex;
+};
+
+#endif	// ARCHIVE_H_
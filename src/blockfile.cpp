@@ -0,0 +1,199 @@
+#include "blockfile.h"
+
+bool CBlockFile::IsSupported(EContainer a_eContainer, EFormat a_eFormat)
+{
+	switch (a_eContainer)
+	{
+	case kContainerDds:
+		// dds has no fourcc for pvrtc
+		return a_eFormat <= kFormatBC5S;
+	case kContainerKtx:
+	case kContainerPvr:
+		return true;
+	}
+	return false;
+}
+
+const UChar* CBlockFile::GetExtension(EContainer a_eContainer)
+{
+	switch (a_eContainer)
+	{
+	case kContainerDds:
+		return USTR("dds");
+	case kContainerKtx:
+		return USTR("ktx");
+	case kContainerPvr:
+		return USTR("pvr");
+	}
+	return USTR("");
+}
+
+// a_vLevel holds the blocks of every level in gxt order, face by face, each level in row order
+bool CBlockFile::Write(FILE* a_fp, EContainer a_eContainer, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel)
+{
+	if (!IsSupported(a_eContainer, a_eFormat) || a_vLevel.size() != a_uLevelCount * a_uFaceCount)
+	{
+		return false;
+	}
+	switch (a_eContainer)
+	{
+	case kContainerDds:
+		return writeDds(a_fp, a_eFormat, a_uWidth, a_uHeight, a_uLevelCount, a_uFaceCount, a_vLevel);
+	case kContainerKtx:
+		return writeKtx(a_fp, a_eFormat, a_uWidth, a_uHeight, a_uLevelCount, a_uFaceCount, a_vLevel);
+	case kContainerPvr:
+		return writePvr(a_fp, a_eFormat, a_uWidth, a_uHeight, a_uLevelCount, a_uFaceCount, a_vLevel);
+	}
+	return false;
+}
+
+bool CBlockFile::writeDds(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel)
+{
+	static const u32 c_uFourCC[] =
+	{
+		SDW_CONVERT_ENDIAN32('DXT1'),
+		SDW_CONVERT_ENDIAN32('DXT3'),
+		SDW_CONVERT_ENDIAN32('DXT5'),
+		SDW_CONVERT_ENDIAN32('ATI1'),
+		SDW_CONVERT_ENDIAN32('BC4S'),
+		SDW_CONVERT_ENDIAN32('ATI2'),
+		SDW_CONVERT_ENDIAN32('BC5S')
+	};
+	// magic followed by DDS_HEADER, one dword each
+	u32 uHeader[32] = {};
+	uHeader[0] = SDW_CONVERT_ENDIAN32('DDS ');
+	uHeader[1] = 124;
+	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE
+	uHeader[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;
+	uHeader[3] = a_uHeight;
+	uHeader[4] = a_uWidth;
+	uHeader[5] = static_cast<u32>(a_vLevel[0].size());
+	uHeader[7] = a_uLevelCount;
+	uHeader[19] = 32;
+	// DDPF_FOURCC
+	uHeader[20] = 0x4;
+	uHeader[21] = c_uFourCC[a_eFormat];
+	// DDSCAPS_TEXTURE
+	uHeader[27] = 0x1000;
+	if (a_uLevelCount > 1)
+	{
+		// DDSD_MIPMAPCOUNT, DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+		uHeader[2] |= 0x20000;
+		uHeader[27] |= 0x8 | 0x400000;
+	}
+	if (a_uFaceCount == 6)
+	{
+		// DDSCAPS_COMPLEX, DDSCAPS2_CUBEMAP with all six faces
+		uHeader[27] |= 0x8;
+		uHeader[28] = 0x200 | 0xFC00;
+	}
+	if (!writeData(a_fp, uHeader, sizeof(uHeader)))
+	{
+		return false;
+	}
+	// dds stores face by face like gxt
+	for (vector<vector<u8>>::const_iterator it = a_vLevel.begin(); it != a_vLevel.end(); ++it)
+	{
+		if (!writeData(a_fp, &*it->begin(), it->size()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CBlockFile::writeKtx(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel)
+{
+	static const u8 c_uIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	// glInternalFormat and glBaseInternalFormat
+	static const u32 c_uFormat[][2] =
+	{
+		{ 0x83F1, 0x1908 },	// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		{ 0x83F2, 0x1908 },	// GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+		{ 0x83F3, 0x1908 },	// GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		{ 0x8DBB, 0x1903 },	// GL_COMPRESSED_RED_RGTC1
+		{ 0x8DBC, 0x1903 },	// GL_COMPRESSED_SIGNED_RED_RGTC1
+		{ 0x8DBD, 0x8227 },	// GL_COMPRESSED_RG_RGTC2
+		{ 0x8DBE, 0x8227 },	// GL_COMPRESSED_SIGNED_RG_RGTC2
+		{ 0x8C01, 0x1907 },	// GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG
+		{ 0x8C03, 0x1908 },	// GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG
+		{ 0x8C00, 0x1907 },	// GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG
+		{ 0x8C02, 0x1908 },	// GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG
+		{ 0x9137, 0x1908 },	// GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG
+		{ 0x9138, 0x1908 }	// GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG
+	};
+	u32 uHeader[13] = {};
+	uHeader[0] = 0x04030201;
+	uHeader[2] = 1;
+	uHeader[4] = c_uFormat[a_eFormat][0];
+	uHeader[5] = c_uFormat[a_eFormat][1];
+	uHeader[6] = a_uWidth;
+	uHeader[7] = a_uHeight;
+	uHeader[10] = a_uFaceCount;
+	uHeader[11] = a_uLevelCount;
+	if (!writeData(a_fp, c_uIdentifier, sizeof(c_uIdentifier)) || !writeData(a_fp, uHeader, sizeof(uHeader)))
+	{
+		return false;
+	}
+	// ktx stores level by level, block data is always a multiple of 4 bytes so no padding is needed
+	for (u32 i = 0; i < a_uLevelCount; i++)
+	{
+		u32 uImageSize = static_cast<u32>(a_vLevel[i].size());
+		if (!writeData(a_fp, &uImageSize, 4))
+		{
+			return false;
+		}
+		for (u32 j = 0; j < a_uFaceCount; j++)
+		{
+			const vector<u8>& vLevel = a_vLevel[j * a_uLevelCount + i];
+			if (!writeData(a_fp, &*vLevel.begin(), vLevel.size()))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool CBlockFile::writePvr(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel)
+{
+	static const u32 c_uPixelFormat[] = { 7, 9, 11, 12, 12, 13, 13, 0, 1, 2, 3, 4, 5 };
+	u32 uHeader[13] = {};
+	uHeader[0] = 0x03525650;
+	uHeader[2] = c_uPixelFormat[a_eFormat];
+	// unsigned or signed byte normalised
+	uHeader[5] = a_eFormat == kFormatBC4S || a_eFormat == kFormatBC5S ? 1 : 0;
+	uHeader[6] = a_uHeight;
+	uHeader[7] = a_uWidth;
+	uHeader[8] = 1;
+	uHeader[9] = 1;
+	uHeader[10] = a_uFaceCount;
+	uHeader[11] = a_uLevelCount;
+	if (!writeData(a_fp, uHeader, sizeof(uHeader)))
+	{
+		return false;
+	}
+	// pvr stores level by level
+	for (u32 i = 0; i < a_uLevelCount; i++)
+	{
+		for (u32 j = 0; j < a_uFaceCount; j++)
+		{
+			const vector<u8>& vLevel = a_vLevel[j * a_uLevelCount + i];
+			if (!writeData(a_fp, &*vLevel.begin(), vLevel.size()))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool CBlockFile::writeData(FILE* a_fp, const void* a_pData, size_t a_uSize)
+{
+	if (fwrite(a_pData, 1, a_uSize, a_fp) != a_uSize)
+	{
+		UPrintf(USTR("ERROR: write file failed\n\n"));
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef BLOCKFILE_H_
+#define BLOCKFILE_H_
+
+#include <sdw.h>
+
+class CBlockFile
+{
+public:
+	enum EContainer
+	{
+		kContainerDds,
+		kContainerKtx,
+		kContainerPvr
+	};
+	enum EFormat
+	{
+		kFormatBC1,
+		kFormatBC2,
+		kFormatBC3,
+		kFormatBC4,
+		kFormatBC4S,
+		kFormatBC5,
+		kFormatBC5S,
+		kFormatPvrtc2RGB,
+		kFormatPvrtc2RGBA,
+		kFormatPvrtc4RGB,
+		kFormatPvrtc4RGBA,
+		kFormatPvrtcII2,
+		kFormatPvrtcII4
+	};
+	static bool IsSupported(EContainer a_eContainer, EFormat a_eFormat);
+	static const UChar* GetExtension(EContainer a_eContainer);
+	static bool Write(FILE* a_fp, EContainer a_eContainer, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel);
+private:
+	static bool writeDds(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel);
+	static bool writeKtx(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel);
+	static bool writePvr(FILE* a_fp, EFormat a_eFormat, u32 a_uWidth, u32 a_uHeight, u32 a_uLevelCount, u32 a_uFaceCount, const vector<vector<u8>>& a_vLevel);
+	static bool writeData(FILE* a_fp, const void* a_pData, size_t a_uSize);
+};
+
+#endif	// BLOCKFILE_H_
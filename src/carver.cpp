@@ -0,0 +1,242 @@
+#include "carver.h"
+#include "gxt.h"
+#include "threadpool.h"
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CARVER_USE_SSE2 1
+#else
+#define CARVER_USE_SSE2 0
+#endif
+
+// large enough to keep every thread streaming, small enough to balance the tail
+const u64 CCarver::s_uChunkSize = 16 * 1024 * 1024;
+
+// every chunk owns the candidates that start inside it and reads up to the end of the file,
+// so a header across a chunk boundary is still found exactly once
+void CCarver::Scan(const u8* a_pData, u64 a_uSize, vector<SBlob>& a_vBlob)
+{
+	u32 uChunkCount = static_cast<u32>((a_uSize + s_uChunkSize - 1) / s_uChunkSize);
+	vector<vector<SBlob>> vChunkBlob(uChunkCount);
+	CThreadPool::ParallelFor(uChunkCount, [&](u32 a_uChunk)
+	{
+		u64 uBegin = a_uChunk * s_uChunkSize;
+		scanChunk(a_pData, a_uSize, uBegin, std::min<u64>(uBegin + s_uChunkSize, a_uSize), vChunkBlob[a_uChunk]);
+	});
+	a_vBlob.clear();
+	for (vector<vector<SBlob>>::iterator it = vChunkBlob.begin(); it != vChunkBlob.end(); ++it)
+	{
+		a_vBlob.insert(a_vBlob.end(), it->begin(), it->end());
+	}
+}
+
+bool CCarver::Extract(const UString& a_sFileName, const UString& a_sDirName, bool a_bVerbose)
+{
+	u64 uSize = 0;
+	const u8* pData = mapFile(a_sFileName, uSize);
+	if (pData == nullptr)
+	{
+		UPrintf(USTR("ERROR: map file %") PRIUS USTR(" failed\n\n"), a_sFileName.c_str());
+		return false;
+	}
+	vector<SBlob> vBlob;
+	Scan(pData, uSize, vBlob);
+	if (a_bVerbose)
+	{
+		UPrintf(USTR("carve: %u gxt found\n"), static_cast<u32>(vBlob.size()));
+	}
+	bool bResult = true;
+	if (!vBlob.empty())
+	{
+		UMkdir(a_sDirName.c_str());
+	}
+	for (vector<SBlob>::iterator it = vBlob.begin(); it != vBlob.end(); ++it)
+	{
+		// named by the offset in the source file
+		UString sGxtFileName = Format(USTR("%") PRIUS USTR("/%08llX.gxt"), a_sDirName.c_str(), static_cast<unsigned long long>(it->Offset));
+		FILE* fp = UFopen(sGxtFileName.c_str(), USTR("wb"));
+		if (fp == nullptr)
+		{
+			bResult = false;
+			break;
+		}
+		if (a_bVerbose)
+		{
+			UPrintf(USTR("save: %") PRIUS USTR(", offset %llu, size %llu\n"), sGxtFileName.c_str(), static_cast<unsigned long long>(it->Offset), static_cast<unsigned long long>(it->Size));
+		}
+		if (fwrite(pData + it->Offset, 1, static_cast<size_t>(it->Size), fp) != it->Size)
+		{
+			UPrintf(USTR("ERROR: write file %") PRIUS USTR(" failed\n\n"), sGxtFileName.c_str());
+			bResult = false;
+		}
+		fclose(fp);
+		if (!bResult)
+		{
+			break;
+		}
+	}
+	unmapFile(pData, uSize);
+	return bResult;
+}
+
+void CCarver::scanChunk(const u8* a_pData, u64 a_uSize, u64 a_uBegin, u64 a_uEnd, vector<SBlob>& a_vBlob)
+{
+	// tag and version, as they are stored
+	u8 uMagic[8] = {};
+	u32 uTag = SCE_GXT_TAG;
+	u32 uVersion = SCE_GXT_VERSION;
+	memcpy(uMagic, &uTag, 4);
+	memcpy(uMagic + 4, &uVersion, 4);
+	if (a_uSize < sizeof(uMagic))
+	{
+		return;
+	}
+	a_uEnd = std::min<u64>(a_uEnd, a_uSize - sizeof(uMagic) + 1);
+	u64 uOffset = a_uBegin;
+#if CARVER_USE_SSE2
+	// 16 positions at a time whose first two bytes are 'GX', the rest is checked per hit
+	const __m128i nFirst = _mm_set1_epi8(static_cast<char>(uMagic[0]));
+	const __m128i nSecond = _mm_set1_epi8(static_cast<char>(uMagic[1]));
+	for (; uOffset + 16 < a_uEnd; uOffset += 16)
+	{
+		__m128i nData0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_pData + uOffset));
+		__m128i nData1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_pData + uOffset + 1));
+		u32 uMask = static_cast<u32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(nData0, nFirst), _mm_cmpeq_epi8(nData1, nSecond))));
+		while (uMask != 0)
+		{
+			u32 uBit = 0;
+			while ((uMask >> uBit & 1) == 0)
+			{
+				uBit++;
+			}
+			uMask &= uMask - 1;
+			u64 uCandidate = uOffset + uBit;
+			SBlob blob = { uCandidate, 0 };
+			if (memcmp(a_pData + uCandidate, uMagic, sizeof(uMagic)) == 0 && validate(a_pData, a_uSize, uCandidate, blob.Size))
+			{
+				a_vBlob.push_back(blob);
+			}
+		}
+	}
+#endif
+	while (uOffset < a_uEnd)
+	{
+		const u8* pFound = static_cast<const u8*>(memchr(a_pData + uOffset, uMagic[0], static_cast<size_t>(a_uEnd - uOffset)));
+		if (pFound == nullptr)
+		{
+			break;
+		}
+		u64 uCandidate = pFound - a_pData;
+		SBlob blob = { uCandidate, 0 };
+		if (memcmp(pFound, uMagic, sizeof(uMagic)) == 0 && validate(a_pData, a_uSize, uCandidate, blob.Size))
+		{
+			a_vBlob.push_back(blob);
+		}
+		uOffset = uCandidate + 1;
+	}
+}
+
+// the header and the texture info table must describe ranges inside the rest of the file
+bool CCarver::validate(const u8* a_pData, u64 a_uSize, u64 a_uOffset, u64& a_uBlobSize)
+{
+	u64 uRemainSize = a_uSize - a_uOffset;
+	SceGxtHeader sceGxtHeader = {};
+	if (uRemainSize < sizeof(sceGxtHeader))
+	{
+		return false;
+	}
+	memcpy(&sceGxtHeader, a_pData + a_uOffset, sizeof(sceGxtHeader));
+	if (!sce::Texture::Gxt::isValidInput(reinterpret_cast<const u8*>(&sceGxtHeader), sizeof(sceGxtHeader)) || sceGxtHeader.numTextures == 0)
+	{
+		return false;
+	}
+	u64 uInfoEnd = sizeof(sceGxtHeader) + static_cast<u64>(sceGxtHeader.numTextures) * sizeof(SceGxtTextureInfo);
+	u64 uDataEnd = static_cast<u64>(sceGxtHeader.dataOffset) + sceGxtHeader.dataSize;
+	u64 uPaletteSize = static_cast<u64>(sceGxtHeader.numP4Palettes) * SCE_GXT_PALETTE_SIZE_P4 + static_cast<u64>(sceGxtHeader.numP8Palettes) * SCE_GXT_PALETTE_SIZE_P8;
+	if (sceGxtHeader.dataOffset < uInfoEnd || uDataEnd > uRemainSize || uPaletteSize > sceGxtHeader.dataSize)
+	{
+		return false;
+	}
+	u64 uPaletteOffset = uDataEnd - uPaletteSize;
+	for (u32 i = 0; i < sceGxtHeader.numTextures; i++)
+	{
+		SceGxtTextureInfo sceGxtTextureInfo = {};
+		memcpy(&sceGxtTextureInfo, a_pData + a_uOffset + sizeof(sceGxtHeader) + i * sizeof(SceGxtTextureInfo), sizeof(sceGxtTextureInfo));
+		if (sceGxtTextureInfo.width == 0 || sceGxtTextureInfo.height == 0 || sceGxtTextureInfo.dataOffset < sceGxtHeader.dataOffset || static_cast<u64>(sceGxtTextureInfo.dataOffset) + sceGxtTextureInfo.dataSize > uPaletteOffset)
+		{
+			return false;
+		}
+		if (sceGxtTextureInfo.paletteIndex != UINT32_MAX && sceGxtTextureInfo.paletteIndex >= sceGxtHeader.numP4Palettes + sceGxtHeader.numP8Palettes)
+		{
+			return false;
+		}
+	}
+	a_uBlobSize = uDataEnd;
+	return true;
+}
+
+// the whole file is mapped read only, the os pages it in as the threads stream through it
+const u8* CCarver::mapFile(const UString& a_sFileName, u64& a_uSize)
+{
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	HANDLE hFile = CreateFileW(a_sFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER nFileSize = {};
+	if (!GetFileSizeEx(hFile, &nFileSize) || nFileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return nullptr;
+	}
+	a_uSize = nFileSize.QuadPart;
+	// the view keeps the mapping and the file alive
+	HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);
+	if (hMapping == nullptr)
+	{
+		return nullptr;
+	}
+	void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(hMapping);
+	return static_cast<const u8*>(pData);
+#else
+	n32 nFd = open(a_sFileName.c_str(), O_RDONLY);
+	if (nFd < 0)
+	{
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(nFd, &st) != 0 || st.st_size == 0)
+	{
+		close(nFd);
+		return nullptr;
+	}
+	a_uSize = st.st_size;
+	void* pData = mmap(nullptr, static_cast<size_t>(a_uSize), PROT_READ, MAP_PRIVATE, nFd, 0);
+	close(nFd);
+	if (pData == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	madvise(pData, static_cast<size_t>(a_uSize), MADV_SEQUENTIAL);
+	return static_cast<const u8*>(pData);
+#endif
+}
+
+void CCarver::unmapFile(const u8* a_pData, u64 a_uSize)
+{
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	UnmapViewOfFile(a_pData);
+#else
+	munmap(const_cast<u8*>(a_pData), static_cast<size_t>(a_uSize));
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef CARVER_H_
+#define CARVER_H_
+
+#include <sdw.h>
+
+class CCarver
+{
+public:
+	struct SBlob
+	{
+		u64 Offset;
+		u64 Size;
+	};
+	static void Scan(const u8* a_pData, u64 a_uSize, vector<SBlob>& a_vBlob);
+	static bool Extract(const UString& a_sFileName, const UString& a_sDirName, bool a_bVerbose);
+private:
+	static void scanChunk(const u8* a_pData, u64 a_uSize, u64 a_uBegin, u64 a_uEnd, vector<SBlob>& a_vBlob);
+	static bool validate(const u8* a_pData, u64 a_uSize, u64 a_uOffset, u64& a_uBlobSize);
+	static const u8* mapFile(const UString& a_sFileName, u64& a_uSize);
+	static void unmapFile(const u8* a_pData, u64 a_uSize);
+	static const u64 s_uChunkSize;
+};
+
+#endif	// CARVER_H_
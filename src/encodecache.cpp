@@ -0,0 +1,236 @@
+#include "encodecache.h"
+#include "hash.h"
+#include <atomic>
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+#include <io.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+// bump whenever an encoder change alters its output, so that stale payloads are never reused
+const u32 CEncodeCache::s_uEncoderVersion = 1;
+
+const u32 CEncodeCache::s_uSignature = SDW_CONVERT_ENDIAN32('GXTC');
+
+static atomic<u32> s_uTempIndex(0);
+
+CEncodeCache::CKeyBuilder::CKeyBuilder()
+{
+	m_Key.Hash[0] = CHash::s_uFnvOffsetBasis;
+	m_Key.Hash[1] = ~CHash::s_uFnvOffsetBasis;
+	Add(s_uEncoderVersion);
+}
+
+void CEncodeCache::CKeyBuilder::Add(const void* a_pData, size_t a_uSize)
+{
+	u64 uSize = a_uSize;
+	m_Key.Hash[0] = CHash::Fnv1a64(&uSize, sizeof(uSize), m_Key.Hash[0]);
+	m_Key.Hash[0] = CHash::Fnv1a64(a_pData, a_uSize, m_Key.Hash[0]);
+	m_Key.Hash[1] = CHash::Fnv1a64(a_pData, a_uSize, m_Key.Hash[1]);
+	m_Key.Hash[1] = CHash::Fnv1a64(&uSize, sizeof(uSize), m_Key.Hash[1]);
+}
+
+void CEncodeCache::CKeyBuilder::Add(u32 a_uValue)
+{
+	Add(&a_uValue, sizeof(a_uValue));
+}
+
+CEncodeCache::SKey CEncodeCache::CKeyBuilder::GetKey() const
+{
+	return m_Key;
+}
+
+CEncodeCache::CEncodeCache()
+	: m_uMaxSize(0)
+{
+}
+
+CEncodeCache::~CEncodeCache()
+{
+}
+
+void CEncodeCache::SetDirName(const UString& a_sDirName)
+{
+	m_sDirName = a_sDirName;
+	if (!m_sDirName.empty())
+	{
+		UMkdir(m_sDirName.c_str());
+	}
+}
+
+void CEncodeCache::SetMaxSize(u64 a_uMaxSize)
+{
+	m_uMaxSize = a_uMaxSize;
+}
+
+bool CEncodeCache::IsEnabled() const
+{
+	return !m_sDirName.empty();
+}
+
+bool CEncodeCache::Load(const SKey& a_Key, vector<u8>& a_vData) const
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+	UString sFileName = getFileName(a_Key);
+	FILE* fp = UFopen(sFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	u32 uHeader[2] = {};
+	SKey key = {};
+	bool bResult = fread(uHeader, sizeof(uHeader), 1, fp) == 1 && fread(&key, sizeof(key), 1, fp) == 1 && uHeader[0] == s_uSignature && memcmp(&key, &a_Key, sizeof(key)) == 0;
+	if (bResult)
+	{
+		a_vData.resize(uHeader[1]);
+		bResult = uHeader[1] == 0 || fread(&*a_vData.begin(), 1, uHeader[1], fp) == uHeader[1];
+	}
+	fclose(fp);
+	if (bResult)
+	{
+		// a hit refreshes the entry for the lru order
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+		_wutime(sFileName.c_str(), nullptr);
+#else
+		utime(sFileName.c_str(), nullptr);
+#endif
+	}
+	return bResult;
+}
+
+void CEncodeCache::Store(const SKey& a_Key, const vector<u8>& a_vData) const
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	// write a private temp file and rename it into place, readers never see a partial entry
+	UString sFileName = getFileName(a_Key);
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	n32 nProcessId = _getpid();
+#else
+	n32 nProcessId = getpid();
+#endif
+	UString sTempFileName = sFileName + Format(USTR(".%d.%u.tmp"), nProcessId, s_uTempIndex++);
+	FILE* fp = UFopen(sTempFileName.c_str(), USTR("wb"));
+	if (fp == nullptr)
+	{
+		return;
+	}
+	u32 uHeader[2] = { s_uSignature, static_cast<u32>(a_vData.size()) };
+	bool bResult = fwrite(uHeader, sizeof(uHeader), 1, fp) == 1 && fwrite(&a_Key, sizeof(a_Key), 1, fp) == 1 && (a_vData.empty() || fwrite(&*a_vData.begin(), 1, a_vData.size(), fp) == a_vData.size());
+	bResult = fclose(fp) == 0 && bResult;
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	if (!bResult || _wrename(sTempFileName.c_str(), sFileName.c_str()) != 0)
+	{
+		// another process may have stored the same entry first, its content is identical
+		_wremove(sTempFileName.c_str());
+	}
+#else
+	if (!bResult || rename(sTempFileName.c_str(), sFileName.c_str()) != 0)
+	{
+		remove(sTempFileName.c_str());
+	}
+#endif
+}
+
+void CEncodeCache::Trim() const
+{
+	if (!IsEnabled() || m_uMaxSize == 0)
+	{
+		return;
+	}
+	vector<SEntry> vEntry;
+	listEntry(vEntry);
+	u64 uTotalSize = 0;
+	for (vector<SEntry>::iterator it = vEntry.begin(); it != vEntry.end(); ++it)
+	{
+		uTotalSize += it->Size;
+	}
+	if (uTotalSize <= m_uMaxSize)
+	{
+		return;
+	}
+	// evict the least recently used entries down to 90% of the limit to avoid trimming on every run
+	sort(vEntry.begin(), vEntry.end(), [](const SEntry& a_Lhs, const SEntry& a_Rhs)
+	{
+		return a_Lhs.Time < a_Rhs.Time;
+	});
+	u64 uTargetSize = m_uMaxSize / 10 * 9;
+	for (vector<SEntry>::iterator it = vEntry.begin(); it != vEntry.end() && uTotalSize > uTargetSize; ++it)
+	{
+		UString sFileName = m_sDirName + USTR("/") + it->FileName;
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+		bool bRemoved = _wremove(sFileName.c_str()) == 0;
+#else
+		bool bRemoved = remove(sFileName.c_str()) == 0;
+#endif
+		if (bRemoved)
+		{
+			uTotalSize -= it->Size;
+		}
+	}
+}
+
+UString CEncodeCache::getFileName(const SKey& a_Key) const
+{
+	return Format(USTR("%") PRIUS USTR("/%08X%08X%08X%08X.gxtc"), m_sDirName.c_str(), static_cast<u32>(a_Key.Hash[0] >> 32), static_cast<u32>(a_Key.Hash[0]), static_cast<u32>(a_Key.Hash[1] >> 32), static_cast<u32>(a_Key.Hash[1]));
+}
+
+void CEncodeCache::listEntry(vector<SEntry>& a_vEntry) const
+{
+	a_vEntry.clear();
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	_wfinddata64_t findData;
+	intptr_t nHandle = _wfindfirst64((m_sDirName + USTR("/*.gxtc")).c_str(), &findData);
+	if (nHandle == -1)
+	{
+		return;
+	}
+	do
+	{
+		if ((findData.attrib & _A_SUBDIR) == 0)
+		{
+			SEntry entry;
+			entry.FileName = findData.name;
+			entry.Size = findData.size;
+			entry.Time = findData.time_write;
+			a_vEntry.push_back(entry);
+		}
+	} while (_wfindnext64(nHandle, &findData) == 0);
+	_findclose(nHandle);
+#else
+	DIR* pDir = opendir(m_sDirName.c_str());
+	if (pDir == nullptr)
+	{
+		return;
+	}
+	dirent* pDirent = nullptr;
+	while ((pDirent = readdir(pDir)) != nullptr)
+	{
+		string sName = pDirent->d_name;
+		if (sName.size() <= 5 || sName.compare(sName.size() - 5, 5, ".gxtc") != 0)
+		{
+			continue;
+		}
+		struct stat st;
+		if (stat((m_sDirName + "/" + sName).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			continue;
+		}
+		SEntry entry;
+		entry.FileName = sName;
+		entry.Size = st.st_size;
+		entry.Time = st.st_mtime;
+		a_vEntry.push_back(entry);
+	}
+	closedir(pDir);
+#endif
+}
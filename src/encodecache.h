@@ -0,0 +1,46 @@
+#ifndef ENCODECACHE_H_
+#define ENCODECACHE_H_
+
+#include <sdw.h>
+
+class CEncodeCache
+{
+public:
+	struct SKey
+	{
+		u64 Hash[2];
+	};
+	class CKeyBuilder
+	{
+	public:
+		CKeyBuilder();
+		void Add(const void* a_pData, size_t a_uSize);
+		void Add(u32 a_uValue);
+		SKey GetKey() const;
+	private:
+		SKey m_Key;
+	};
+	CEncodeCache();
+	~CEncodeCache();
+	void SetDirName(const UString& a_sDirName);
+	void SetMaxSize(u64 a_uMaxSize);
+	bool IsEnabled() const;
+	bool Load(const SKey& a_Key, vector<u8>& a_vData) const;
+	void Store(const SKey& a_Key, const vector<u8>& a_vData) const;
+	void Trim() const;
+	static const u32 s_uEncoderVersion;
+private:
+	struct SEntry
+	{
+		UString FileName;
+		u64 Size;
+		n64 Time;
+	};
+	UString getFileName(const SKey& a_Key) const;
+	void listEntry(vector<SEntry>& a_vEntry) const;
+	UString m_sDirName;
+	u64 m_uMaxSize;
+	static const u32 s_uSignature;
+};
+
+#endif	// ENCODECACHE_H_
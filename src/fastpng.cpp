@@ -0,0 +1,559 @@
+#include "fastpng.h"
+#include "pngwriter.h"
+#include <zlib.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FASTPNG_USE_SSE2 1
+#else
+#define FASTPNG_USE_SSE2 0
+#endif
+
+const n32 CFastPng::s_nHashBits = 15;
+
+const u32 CFastPng::s_uBlockSymbolCount = 64 * 1024;
+
+const u16 CFastPng::s_uLengthBase[29] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const u8 CFastPng::s_uLengthExtra[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const u16 CFastPng::s_uDistanceBase[30] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+const u8 CFastPng::s_uDistanceExtra[30] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+const u8 CFastPng::s_uCodeLengthOrder[19] =
+{
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+u8 CFastPng::s_uLengthCode[259] = {};
+
+u8 CFastPng::s_uDistanceCode[512] = {};
+
+bool CFastPng::s_bTableReady = CFastPng::initTable();
+
+// the output is always 8 bit rgba, every row uses the up filter and the stream is deflated by a
+// greedy single probe matcher with one dynamic huffman block per 64k symbols
+bool CFastPng::Write(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride)
+{
+	u32 uRowSize = a_uWidth * 4 + 1;
+	vector<u8> vFiltered(static_cast<size_t>(uRowSize) * a_uHeight);
+	filter(a_pRGBA, a_uWidth, a_uHeight, a_uStride, &*vFiltered.begin());
+	vector<u8> vDeflate;
+	vDeflate.reserve(vFiltered.size() / 2 + 64);
+	// zlib header: deflate, 32k window, fastest level hint
+	vDeflate.push_back(0x78);
+	vDeflate.push_back(0x01);
+	deflate(&*vFiltered.begin(), static_cast<u32>(vFiltered.size()), vDeflate);
+	u32 uAdler = adler32(&*vFiltered.begin(), static_cast<u32>(vFiltered.size()));
+	for (n32 i = 0; i < 4; i++)
+	{
+		vDeflate.push_back(static_cast<u8>(uAdler >> (24 - i * 8)));
+	}
+	return CPngWriter::WriteHeader(a_fp, a_uWidth, a_uHeight) && CPngWriter::WriteChunk(a_fp, "IDAT", &*vDeflate.begin(), static_cast<u32>(vDeflate.size())) && CPngWriter::WriteChunk(a_fp, "IEND", nullptr, 0);
+}
+
+bool CFastPng::initTable()
+{
+	for (n32 i = 0; i < 29; i++)
+	{
+		u32 uCount = 1 << s_uLengthExtra[i];
+		for (u32 j = 0; j < uCount && s_uLengthBase[i] + j <= 258; j++)
+		{
+			s_uLengthCode[s_uLengthBase[i] + j] = static_cast<u8>(i);
+		}
+	}
+	// the last entries of code 27 overlap 258, which has its own code
+	s_uLengthCode[258] = 28;
+	// distances up to 256 index directly, larger ones by (distance - 1) >> 7
+	for (n32 i = 0; i < 30; i++)
+	{
+		u32 uCount = 1 << s_uDistanceExtra[i];
+		for (u32 j = 0; j < uCount; j++)
+		{
+			u32 uDistance = s_uDistanceBase[i] + j - 1;
+			if (uDistance < 256)
+			{
+				s_uDistanceCode[uDistance] = static_cast<u8>(i);
+			}
+			else
+			{
+				s_uDistanceCode[256 + (uDistance >> 7)] = static_cast<u8>(i);
+			}
+		}
+	}
+	return true;
+}
+
+void CFastPng::filter(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u8* a_pFiltered)
+{
+	u32 uSize = a_uWidth * 4;
+	for (u32 y = 0; y < a_uHeight; y++)
+	{
+		const u8* pRow = a_pRGBA + y * a_uStride;
+		u8* pOut = a_pFiltered + y * (uSize + 1);
+		if (y == 0)
+		{
+			pOut[0] = 0;
+			memcpy(pOut + 1, pRow, uSize);
+			continue;
+		}
+		const u8* pPrevRow = pRow - a_uStride;
+		pOut[0] = 2;
+		pOut++;
+		u32 x = 0;
+#if FASTPNG_USE_SSE2
+		for (; x + 16 <= uSize; x += 16)
+		{
+			__m128i vRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x));
+			__m128i vPrevRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrevRow + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x), _mm_sub_epi8(vRow, vPrevRow));
+		}
+#endif
+		for (; x < uSize; x++)
+		{
+			pOut[x] = static_cast<u8>(pRow[x] - pPrevRow[x]);
+		}
+	}
+}
+
+void CFastPng::deflate(const u8* a_pData, u32 a_uSize, vector<u8>& a_vDeflate)
+{
+	SBitWriter bitWriter;
+	bitWriter.Data.swap(a_vDeflate);
+	bitWriter.Bits = 0;
+	bitWriter.Count = 0;
+	vector<u32> vHead(static_cast<size_t>(1) << s_nHashBits, 0);
+	vector<u32> vSymbol;
+	vSymbol.reserve(s_uBlockSymbolCount);
+	u32 uPos = 0;
+	while (uPos < a_uSize)
+	{
+		u32 uLength = 0;
+		u32 uDistance = 0;
+		if (uPos + 4 <= a_uSize)
+		{
+			u32 uValue = 0;
+			memcpy(&uValue, a_pData + uPos, 4);
+			u32 uHash = (uValue * 2654435761U) >> (32 - s_nHashBits);
+			u32 uCandidate = vHead[uHash];
+			vHead[uHash] = uPos + 1;
+			// a repeat of the previous pixel is the most common match in texture data
+			u32 uPrevValue = 0;
+			if (uPos >= 4)
+			{
+				memcpy(&uPrevValue, a_pData + uPos - 4, 4);
+			}
+			if (uPos >= 4 && uPrevValue == uValue)
+			{
+				uDistance = 4;
+			}
+			else if (uCandidate != 0 && uPos - (uCandidate - 1) <= 32768)
+			{
+				memcpy(&uPrevValue, a_pData + uCandidate - 1, 4);
+				if (uPrevValue == uValue)
+				{
+					uDistance = uPos - (uCandidate - 1);
+				}
+			}
+			if (uDistance != 0)
+			{
+				const u8* pMatch = a_pData + uPos - uDistance;
+				u32 uMaxLength = std::min<u32>(258, a_uSize - uPos);
+				uLength = 4;
+				while (uLength + 8 <= uMaxLength)
+				{
+					u64 uLhs = 0;
+					u64 uRhs = 0;
+					memcpy(&uLhs, pMatch + uLength, 8);
+					memcpy(&uRhs, a_pData + uPos + uLength, 8);
+					if (uLhs != uRhs)
+					{
+						break;
+					}
+					uLength += 8;
+				}
+				while (uLength < uMaxLength && pMatch[uLength] == a_pData[uPos + uLength])
+				{
+					uLength++;
+				}
+			}
+		}
+		if (uLength != 0)
+		{
+			vSymbol.push_back(0x80000000U | uLength << 16 | (uDistance - 1));
+			uPos += uLength;
+		}
+		else
+		{
+			vSymbol.push_back(a_pData[uPos]);
+			uPos++;
+		}
+		if (vSymbol.size() >= s_uBlockSymbolCount)
+		{
+			writeBlock(bitWriter, vSymbol, uPos >= a_uSize);
+			vSymbol.clear();
+		}
+	}
+	if (!vSymbol.empty() || a_uSize == 0)
+	{
+		writeBlock(bitWriter, vSymbol, true);
+	}
+	for (; bitWriter.Count > 0; bitWriter.Count -= 8)
+	{
+		bitWriter.Data.push_back(static_cast<u8>(bitWriter.Bits));
+		bitWriter.Bits >>= 8;
+	}
+	a_vDeflate.swap(bitWriter.Data);
+}
+
+void CFastPng::writeBlock(SBitWriter& a_BitWriter, const vector<u32>& a_vSymbol, bool a_bFinal)
+{
+	u32 uLiteralFrequency[286] = {};
+	u32 uDistanceFrequency[30] = {};
+	for (vector<u32>::const_iterator it = a_vSymbol.begin(); it != a_vSymbol.end(); ++it)
+	{
+		if ((*it & 0x80000000U) == 0)
+		{
+			uLiteralFrequency[*it]++;
+		}
+		else
+		{
+			u32 uDistance = *it & 0xFFFF;
+			uLiteralFrequency[257 + s_uLengthCode[*it >> 16 & 0x1FF]]++;
+			uDistanceFrequency[uDistance < 256 ? s_uDistanceCode[uDistance] : s_uDistanceCode[256 + (uDistance >> 7)]]++;
+		}
+	}
+	uLiteralFrequency[256] = 1;
+	u8 uLength[286 + 30] = {};
+	u8* pLiteralLength = uLength;
+	u8* pDistanceLength = uLength + 286;
+	buildLength(uLiteralFrequency, 286, 15, pLiteralLength);
+	buildLength(uDistanceFrequency, 30, 15, pDistanceLength);
+	n32 nLiteralCount = 286;
+	while (nLiteralCount > 257 && pLiteralLength[nLiteralCount - 1] == 0)
+	{
+		nLiteralCount--;
+	}
+	n32 nDistanceCount = 30;
+	while (nDistanceCount > 1 && pDistanceLength[nDistanceCount - 1] == 0)
+	{
+		nDistanceCount--;
+	}
+	if (pDistanceLength[0] == 0 && nDistanceCount == 1)
+	{
+		// a block without matches still declares one distance code
+		pDistanceLength[0] = 1;
+	}
+	u16 uLiteralCode[286] = {};
+	u16 uDistanceCode[30] = {};
+	buildCode(pLiteralLength, 286, uLiteralCode);
+	buildCode(pDistanceLength, 30, uDistanceCode);
+	// run length encode the code lengths, the low byte is the symbol and the rest its extra bits
+	u8 uAllLength[286 + 30] = {};
+	memcpy(uAllLength, pLiteralLength, nLiteralCount);
+	memcpy(uAllLength + nLiteralCount, pDistanceLength, nDistanceCount);
+	n32 nAllCount = nLiteralCount + nDistanceCount;
+	vector<u32> vCodeLengthSymbol;
+	u32 uCodeLengthFrequency[19] = {};
+	for (n32 i = 0; i < nAllCount;)
+	{
+		u8 uValue = uAllLength[i];
+		n32 nRun = 1;
+		while (i + nRun < nAllCount && uAllLength[i + nRun] == uValue)
+		{
+			nRun++;
+		}
+		i += nRun;
+		if (uValue == 0)
+		{
+			while (nRun >= 11)
+			{
+				n32 nCount = std::min<n32>(nRun, 138);
+				vCodeLengthSymbol.push_back(18 | (nCount - 11) << 8);
+				uCodeLengthFrequency[18]++;
+				nRun -= nCount;
+			}
+			if (nRun >= 3)
+			{
+				vCodeLengthSymbol.push_back(17 | (nRun - 3) << 8);
+				uCodeLengthFrequency[17]++;
+				nRun = 0;
+			}
+		}
+		else
+		{
+			vCodeLengthSymbol.push_back(uValue);
+			uCodeLengthFrequency[uValue]++;
+			nRun--;
+			while (nRun >= 3)
+			{
+				n32 nCount = std::min<n32>(nRun, 6);
+				vCodeLengthSymbol.push_back(16 | (nCount - 3) << 8);
+				uCodeLengthFrequency[16]++;
+				nRun -= nCount;
+			}
+		}
+		for (; nRun > 0; nRun--)
+		{
+			vCodeLengthSymbol.push_back(uValue);
+			uCodeLengthFrequency[uValue]++;
+		}
+	}
+	u8 uCodeLengthLength[19] = {};
+	u16 uCodeLengthCode[19] = {};
+	buildLength(uCodeLengthFrequency, 19, 7, uCodeLengthLength);
+	buildCode(uCodeLengthLength, 19, uCodeLengthCode);
+	n32 nCodeLengthCount = 19;
+	while (nCodeLengthCount > 4 && uCodeLengthLength[s_uCodeLengthOrder[nCodeLengthCount - 1]] == 0)
+	{
+		nCodeLengthCount--;
+	}
+	putBits(a_BitWriter, a_bFinal ? 1 : 0, 1);
+	putBits(a_BitWriter, 2, 2);
+	putBits(a_BitWriter, nLiteralCount - 257, 5);
+	putBits(a_BitWriter, nDistanceCount - 1, 5);
+	putBits(a_BitWriter, nCodeLengthCount - 4, 4);
+	for (n32 i = 0; i < nCodeLengthCount; i++)
+	{
+		putBits(a_BitWriter, uCodeLengthLength[s_uCodeLengthOrder[i]], 3);
+	}
+	for (vector<u32>::iterator it = vCodeLengthSymbol.begin(); it != vCodeLengthSymbol.end(); ++it)
+	{
+		u32 uSymbol = *it & 0xFF;
+		putBits(a_BitWriter, uCodeLengthCode[uSymbol], uCodeLengthLength[uSymbol]);
+		if (uSymbol == 16)
+		{
+			putBits(a_BitWriter, *it >> 8, 2);
+		}
+		else if (uSymbol == 17)
+		{
+			putBits(a_BitWriter, *it >> 8, 3);
+		}
+		else if (uSymbol == 18)
+		{
+			putBits(a_BitWriter, *it >> 8, 7);
+		}
+	}
+	for (vector<u32>::const_iterator it = a_vSymbol.begin(); it != a_vSymbol.end(); ++it)
+	{
+		if ((*it & 0x80000000U) == 0)
+		{
+			putBits(a_BitWriter, uLiteralCode[*it], pLiteralLength[*it]);
+			continue;
+		}
+		u32 uMatchLength = *it >> 16 & 0x1FF;
+		u32 uLengthCode = s_uLengthCode[uMatchLength];
+		putBits(a_BitWriter, uLiteralCode[257 + uLengthCode], pLiteralLength[257 + uLengthCode]);
+		putBits(a_BitWriter, uMatchLength - s_uLengthBase[uLengthCode], s_uLengthExtra[uLengthCode]);
+		u32 uDistance = *it & 0xFFFF;
+		u32 uDistanceSymbol = uDistance < 256 ? s_uDistanceCode[uDistance] : s_uDistanceCode[256 + (uDistance >> 7)];
+		putBits(a_BitWriter, uDistanceCode[uDistanceSymbol], pDistanceLength[uDistanceSymbol]);
+		putBits(a_BitWriter, uDistance + 1 - s_uDistanceBase[uDistanceSymbol], s_uDistanceExtra[uDistanceSymbol]);
+	}
+	putBits(a_BitWriter, uLiteralCode[256], pLiteralLength[256]);
+}
+
+// huffman code lengths by the two queue method, lengths over the limit are folded back the way
+// miniz does it and handed out again from the rarest symbol up
+void CFastPng::buildLength(const u32* a_pFrequency, n32 a_nCount, n32 a_nMaxLength, u8* a_pLength)
+{
+	memset(a_pLength, 0, a_nCount);
+	vector<pair<u32, n32>> vLeaf;
+	for (n32 i = 0; i < a_nCount; i++)
+	{
+		if (a_pFrequency[i] != 0)
+		{
+			vLeaf.push_back(make_pair(a_pFrequency[i], i));
+		}
+	}
+	n32 nLeafCount = static_cast<n32>(vLeaf.size());
+	if (nLeafCount == 0)
+	{
+		return;
+	}
+	if (nLeafCount == 1)
+	{
+		a_pLength[vLeaf.front().second] = 1;
+		return;
+	}
+	sort(vLeaf.begin(), vLeaf.end());
+	vector<u64> vWeight(nLeafCount * 2 - 1);
+	vector<n32> vParent(nLeafCount * 2 - 1, 0);
+	for (n32 i = 0; i < nLeafCount; i++)
+	{
+		vWeight[i] = vLeaf[i].first;
+	}
+	n32 nLeaf = 0;
+	n32 nNode = nLeafCount;
+	for (n32 i = nLeafCount; i < nLeafCount * 2 - 1; i++)
+	{
+		n32 nChild[2] = {};
+		for (n32 j = 0; j < 2; j++)
+		{
+			if (nLeaf < nLeafCount && (nNode >= i || vWeight[nLeaf] <= vWeight[nNode]))
+			{
+				nChild[j] = nLeaf++;
+			}
+			else
+			{
+				nChild[j] = nNode++;
+			}
+		}
+		vWeight[i] = vWeight[nChild[0]] + vWeight[nChild[1]];
+		vParent[nChild[0]] = i;
+		vParent[nChild[1]] = i;
+	}
+	vector<n32> vDepth(nLeafCount * 2 - 1, 0);
+	n32 nLengthCount[33] = {};
+	for (n32 i = nLeafCount * 2 - 3; i >= 0; i--)
+	{
+		vDepth[i] = vDepth[vParent[i]] + 1;
+		if (i < nLeafCount)
+		{
+			nLengthCount[std::min<n32>(vDepth[i], 32)]++;
+		}
+	}
+	for (n32 i = a_nMaxLength + 1; i <= 32; i++)
+	{
+		nLengthCount[a_nMaxLength] += nLengthCount[i];
+		nLengthCount[i] = 0;
+	}
+	u32 uTotal = 0;
+	for (n32 i = a_nMaxLength; i > 0; i--)
+	{
+		uTotal += static_cast<u32>(nLengthCount[i]) << (a_nMaxLength - i);
+	}
+	while (uTotal != 1U << a_nMaxLength)
+	{
+		nLengthCount[a_nMaxLength]--;
+		for (n32 i = a_nMaxLength - 1; i > 0; i--)
+		{
+			if (nLengthCount[i] != 0)
+			{
+				nLengthCount[i]--;
+				nLengthCount[i + 1] += 2;
+				break;
+			}
+		}
+		uTotal--;
+	}
+	n32 nIndex = 0;
+	for (n32 i = a_nMaxLength; i > 0; i--)
+	{
+		for (n32 j = 0; j < nLengthCount[i]; j++)
+		{
+			a_pLength[vLeaf[nIndex++].second] = static_cast<u8>(i);
+		}
+	}
+}
+
+// canonical codes, bit reversed because deflate sends huffman codes from the top bit
+void CFastPng::buildCode(const u8* a_pLength, n32 a_nCount, u16* a_pCode)
+{
+	u32 uLengthCount[16] = {};
+	for (n32 i = 0; i < a_nCount; i++)
+	{
+		uLengthCount[a_pLength[i]]++;
+	}
+	uLengthCount[0] = 0;
+	u32 uNextCode[16] = {};
+	u32 uCode = 0;
+	for (n32 i = 1; i < 16; i++)
+	{
+		uCode = (uCode + uLengthCount[i - 1]) << 1;
+		uNextCode[i] = uCode;
+	}
+	for (n32 i = 0; i < a_nCount; i++)
+	{
+		n32 nLength = a_pLength[i];
+		if (nLength == 0)
+		{
+			continue;
+		}
+		u32 uValue = uNextCode[nLength]++;
+		u32 uReversed = 0;
+		for (n32 j = 0; j < nLength; j++)
+		{
+			uReversed = uReversed << 1 | (uValue >> j & 1);
+		}
+		a_pCode[i] = static_cast<u16>(uReversed);
+	}
+}
+
+void CFastPng::putBits(SBitWriter& a_BitWriter, u32 a_uBits, n32 a_nCount)
+{
+	a_BitWriter.Bits |= static_cast<u64>(a_uBits) << a_BitWriter.Count;
+	a_BitWriter.Count += a_nCount;
+	if (a_BitWriter.Count >= 32)
+	{
+		u8 uByte[4] = { static_cast<u8>(a_BitWriter.Bits), static_cast<u8>(a_BitWriter.Bits >> 8), static_cast<u8>(a_BitWriter.Bits >> 16), static_cast<u8>(a_BitWriter.Bits >> 24) };
+		a_BitWriter.Data.insert(a_BitWriter.Data.end(), uByte, uByte + 4);
+		a_BitWriter.Bits >>= 32;
+		a_BitWriter.Count -= 32;
+	}
+}
+
+u32 CFastPng::adler32(const u8* a_pData, u32 a_uSize)
+{
+	// 5552 is the largest block whose sums cannot overflow 32 bits before the modulo
+	const u32 uBase = 65521;
+	const u32 uMaxBlock = 5552;
+	u32 uA = 1;
+	u32 uB = 0;
+	while (a_uSize > 0)
+	{
+		u32 uBlock = std::min<u32>(a_uSize, uMaxBlock);
+		a_uSize -= uBlock;
+		u32 i = 0;
+#if FASTPNG_USE_SSE2
+		u32 uVectorSize = uBlock & ~15U;
+		if (uVectorSize != 0)
+		{
+			const __m128i vZero = _mm_setzero_si128();
+			const __m128i vWeightLow = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+			const __m128i vWeightHigh = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+			__m128i vSumA = _mm_setzero_si128();
+			__m128i vSumPrevA = _mm_setzero_si128();
+			__m128i vSumB = _mm_setzero_si128();
+			for (; i < uVectorSize; i += 16)
+			{
+				__m128i vData = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_pData + i));
+				vSumPrevA = _mm_add_epi32(vSumPrevA, vSumA);
+				vSumA = _mm_add_epi32(vSumA, _mm_sad_epu8(vData, vZero));
+				vSumB = _mm_add_epi32(vSumB, _mm_madd_epi16(_mm_unpacklo_epi8(vData, vZero), vWeightLow));
+				vSumB = _mm_add_epi32(vSumB, _mm_madd_epi16(_mm_unpackhi_epi8(vData, vZero), vWeightHigh));
+			}
+			u32 uSumA[4] = {};
+			u32 uSumPrevA[4] = {};
+			u32 uSumB[4] = {};
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(uSumA), vSumA);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(uSumPrevA), vSumPrevA);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(uSumB), vSumB);
+			u64 uBlockB = static_cast<u64>(uA) * uVectorSize + (static_cast<u64>(uSumPrevA[0]) + uSumPrevA[2]) * 16 + uSumB[0] + uSumB[1] + uSumB[2] + uSumB[3];
+			uA = (uA + uSumA[0] + uSumA[2]) % uBase;
+			uB = static_cast<u32>((uB + uBlockB) % uBase);
+		}
+#endif
+		for (; i < uBlock; i++)
+		{
+			uA += a_pData[i];
+			uB += uA;
+		}
+		uA %= uBase;
+		uB %= uBase;
+		a_pData += uBlock;
+	}
+	return uB << 16 | uA;
+}
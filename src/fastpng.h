@@ -0,0 +1,37 @@
+#ifndef FASTPNG_H_
+#define FASTPNG_H_
+
+#include <sdw.h>
+
+class CFastPng
+{
+public:
+	static bool Write(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride);
+private:
+	struct SBitWriter
+	{
+		vector<u8> Data;
+		u64 Bits;
+		n32 Count;
+	};
+	static bool initTable();
+	static void filter(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u8* a_pFiltered);
+	static void deflate(const u8* a_pData, u32 a_uSize, vector<u8>& a_vDeflate);
+	static void writeBlock(SBitWriter& a_BitWriter, const vector<u32>& a_vSymbol, bool a_bFinal);
+	static void buildLength(const u32* a_pFrequency, n32 a_nCount, n32 a_nMaxLength, u8* a_pLength);
+	static void buildCode(const u8* a_pLength, n32 a_nCount, u16* a_pCode);
+	static void putBits(SBitWriter& a_BitWriter, u32 a_uBits, n32 a_nCount);
+	static u32 adler32(const u8* a_pData, u32 a_uSize);
+	static const n32 s_nHashBits;
+	static const u32 s_uBlockSymbolCount;
+	static const u16 s_uLengthBase[29];
+	static const u8 s_uLengthExtra[29];
+	static const u16 s_uDistanceBase[30];
+	static const u8 s_uDistanceExtra[30];
+	static const u8 s_uCodeLengthOrder[19];
+	static u8 s_uLengthCode[259];
+	static u8 s_uDistanceCode[512];
+	static bool s_bTableReady;
+};
+
+#endif	// FASTPNG_H_
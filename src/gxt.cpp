@@ -1,4 +1,8 @@
 #include "gxt.h"
+#include "hash.h"
+#include "patcher.h"
+#include "pvrtc.h"
+#include "threadpool.h"
 #include <png.h>
 #include <PVRTextureUtilities.h>
 
@@ -105,6 +109,57 @@ namespace sce
 			}
 		}
 
+		void swizzleLevel4bpp(u8* a_pTgt, const u8* a_pSrc, u32 a_uWidth, u32 a_uHeight)
+		{
+			u32 uMX = getMortonNumber(a_uWidth - 1, 0, a_uWidth, a_uHeight);
+			u32 uMY = getMortonNumber(0, a_uHeight - 1, a_uWidth, a_uHeight);
+			u32 uLineStride = SCE_ALIGN(a_uWidth, 2);
+			u32 uOY = 0;
+			for (u32 uY = 0; uY < a_uHeight; uY++)
+			{
+				u32 uOX = 0;
+				for (u32 uX = 0; uX < a_uWidth; uX++)
+				{
+					size_t uSrcOfsN = uY * uLineStride + uX;
+					size_t uTgtOfsN = uOX + uOY;
+					size_t uSrcOfs = uSrcOfsN >> 1;
+					size_t uTgtOfs = uTgtOfsN >> 1;
+					u32 uSrcShift = (uSrcOfsN & 1) << 2;
+					u32 uTgtShift = (uTgtOfsN & 1) << 2;
+					u8 n = (a_pSrc[uSrcOfs] >> uSrcShift) & 0xF;
+					a_pTgt[uTgtOfs] = (a_pTgt[uTgtOfs] & (0xF0 >> uTgtShift)) | (n << uTgtShift);
+					uOX = (uOX - uMX) & uMX;
+				}
+				uOY = (uOY - uMY) & uMY;
+			}
+		}
+
+		void swizzleLevel(u8* a_pTgt, const u8* a_pSrc, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp)
+		{
+			if (a_uBpp == 4)
+			{
+				return swizzleLevel4bpp(a_pTgt, a_pSrc, a_uWidth, a_uHeight);
+			}
+			u32 uWidthPow2 = enclosingPowerOf2(a_uWidth);
+			u32 uHeightPow2 = enclosingPowerOf2(a_uHeight);
+			u32 uMX = getMortonNumber(uWidthPow2 - 1, 0, uWidthPow2, uHeightPow2);
+			u32 uMY = getMortonNumber(0, uHeightPow2 - 1, uWidthPow2, uHeightPow2);
+			u32 uPixelSize = a_uBpp / 8;
+			u32 uOY = 0;
+			for (u32 uY = 0; uY < a_uHeight; ++uY)
+			{
+				u32 uOX = 0;
+				for (u32 uX = 0; uX < a_uWidth; ++uX)
+				{
+					size_t uTgtOfs = (uOX + uOY) * uPixelSize;
+					memcpy(a_pTgt + uTgtOfs, a_pSrc, uPixelSize);
+					a_pSrc += uPixelSize;
+					uOX = (uOX - uMX) & uMX;
+				}
+				uOY = (uOY - uMY) & uMY;
+			}
+		}
+
 		namespace Gxt
 		{
 
@@ -177,24 +232,24 @@ namespace sce
 			{
 				if (a_uWidth > SCE_GXM_TEXTURE_MAX_SIZE)
 				{
-					UPrintf(USTR("ERROR: width %u > %u\n\n"), a_uWidth, SCE_GXM_TEXTURE_MAX_SIZE);
+					CGxt::Report(Format(USTR("ERROR: width %u > %u\n\n"), a_uWidth, SCE_GXM_TEXTURE_MAX_SIZE));
 					return false;
 				}
 				if (a_uHeight > SCE_GXM_TEXTURE_MAX_SIZE)
 				{
-					UPrintf(USTR("ERROR: height %u > %u\n\n"), a_uHeight, SCE_GXM_TEXTURE_MAX_SIZE);
+					CGxt::Report(Format(USTR("ERROR: height %u > %u\n\n"), a_uHeight, SCE_GXM_TEXTURE_MAX_SIZE));
 					return false;
 				}
 				if (a_eType == SCE_GXM_TEXTURE_SWIZZLED || a_eType == SCE_GXM_TEXTURE_CUBE)
 				{
 					if (!SCE_IS_POW2(a_uWidth))
 					{
-						UPrintf(USTR("ERROR: width %u is not pow2\n\n"), a_uWidth);
+						CGxt::Report(Format(USTR("ERROR: width %u is not pow2\n\n"), a_uWidth));
 						return false;
 					}
 					if (!SCE_IS_POW2(a_uHeight))
 					{
-						UPrintf(USTR("ERROR: height %u is not pow2\n\n"), a_uHeight);
+						CGxt::Report(Format(USTR("ERROR: height %u is not pow2\n\n"), a_uHeight));
 						return false;
 					}
 				}
@@ -207,12 +262,30 @@ namespace sce
 				{
 					return false;
 				}
+				// the size is the end of the last level, so it can not drift from the layout getLevels gives
 				a_uSize = 0;
+				vector<Level> vLevel;
+				if (!getLevels(vLevel, a_uWidth, a_uHeight, a_uNumLevels, a_uNumFaces, a_eFormat, a_eType))
+				{
+					return false;
+				}
+				if (!vLevel.empty())
+				{
+					a_uSize = vLevel.back().m_offset + vLevel.back().m_size;
+				}
+				a_uSize = SCE_ALIGN(a_uSize, SCE_GXM_TEXTURE_ALIGNMENT);
+				return true;
+			}
+
+			bool getLevels(vector<Level>& a_vLevel, u32 a_uWidth, u32 a_uHeight, u32 a_uNumLevels, u32 a_uNumFaces, SceGxmTextureFormat a_eFormat, SceGxmTextureType a_eType)
+			{
+				a_vLevel.clear();
 				u32 uBpp = 0;
-				if (!sce::Texture::Gxt::getBpp(uBpp, a_eFormat))
+				if (!getBpp(uBpp, a_eFormat))
 				{
 					return false;
 				}
+				u32 uOffset = 0;
 				u32 uFaceAlignment = (a_uNumFaces > 1 && a_uNumLevels > 1) ? getFaceAlignment(uBpp, a_uWidth) : 1;
 				if (isBlockCompressed(a_eFormat))
 				{
@@ -220,17 +293,24 @@ namespace sce
 					u32 uBlockHeight = getBlockHeight(a_eFormat);
 					for (u32 i = 0; i < a_uNumFaces; i++)
 					{
-						u32 uFaceOffset = a_uSize;
+						u32 uFaceOffset = uOffset;
 						u32 uMipWidth = std::max<u32>(a_uWidth, uBlockWidth);
 						u32 uMipHeight = std::max<u32>(a_uHeight, uBlockHeight);
 						u32 uMipWidthEx = enclosingPowerOf2(uMipWidth);
 						u32 uMipHeightEx = enclosingPowerOf2(uMipHeight);
 						for (u32 j = 0; j < a_uNumLevels; j++)
 						{
-							u32 uMipWidthBlocks = (uMipWidth + uBlockWidth - 1) / uBlockWidth;
-							u32 uMipHeightBlocks = (uMipHeight + uBlockHeight - 1) / uBlockHeight;
-							u32 uLevelSizeTgt = (uBpp * uMipWidthEx * uMipHeightEx) / 8;
-							a_uSize += uLevelSizeTgt;
+							Level level;
+							level.m_face = i;
+							level.m_level = j;
+							level.m_offset = uOffset;
+							level.m_width = uMipWidth;
+							level.m_height = uMipHeight;
+							level.m_widthEx = uMipWidthEx;
+							level.m_heightEx = uMipHeightEx;
+							level.m_size = (uBpp * uMipWidthEx * uMipHeightEx) / 8;
+							a_vLevel.push_back(level);
+							uOffset += level.m_size;
 							uMipWidth = uMipWidth > uBlockWidth ? uMipWidth / 2 : uBlockWidth;
 							uMipHeight = uMipHeight > uBlockHeight ? uMipHeight / 2 : uBlockHeight;
 							uMipWidthEx = uMipWidthEx > uBlockWidth ? uMipWidthEx / 2 : uBlockWidth;
@@ -238,7 +318,7 @@ namespace sce
 						}
 						if (i < a_uNumFaces - 1)
 						{
-							a_uSize = uFaceOffset + SCE_ALIGN(a_uSize - uFaceOffset, uFaceAlignment);
+							uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
 						}
 					}
 				}
@@ -247,7 +327,7 @@ namespace sce
 					u32 uWidthAlignment = a_eType == SCE_GXM_TEXTURE_LINEAR ? SCE_GXM_TEXTURE_IMPLICIT_STRIDE_ALIGNMENT : 1;
 					for (u32 i = 0; i < a_uNumFaces; i++)
 					{
-						u32 uFaceOffset = a_uSize;
+						u32 uFaceOffset = uOffset;
 						u32 uMipWidth = a_uWidth;
 						u32 uMipHeight = a_uHeight;
 						u32 uMipWidthEx = a_uNumLevels > 1 ? enclosingPowerOf2(a_uWidth) : a_uWidth;
@@ -255,7 +335,17 @@ namespace sce
 						uMipWidthEx = SCE_ALIGN(uMipWidthEx, uWidthAlignment);
 						for (u32 j = 0; j < a_uNumLevels; j++)
 						{
-							a_uSize += uMipHeightEx * ((uMipWidthEx * uBpp + 7) / 8);
+							Level level;
+							level.m_face = i;
+							level.m_level = j;
+							level.m_offset = uOffset;
+							level.m_width = uMipWidth;
+							level.m_height = uMipHeight;
+							level.m_widthEx = uMipWidthEx;
+							level.m_heightEx = uMipHeightEx;
+							level.m_size = uMipHeightEx * ((uMipWidthEx * uBpp + 7) / 8);
+							a_vLevel.push_back(level);
+							uOffset += level.m_size;
 							uMipWidth = uMipWidth > 1 ? uMipWidth / 2 : 1;
 							uMipHeight = uMipHeight > 1 ? uMipHeight / 2 : 1;
 							uMipWidthEx = uMipWidthEx > 1 ? uMipWidthEx / 2 : 1;
@@ -264,11 +354,10 @@ namespace sce
 						}
 						if (i < a_uNumFaces - 1)
 						{
-							a_uSize = uFaceOffset + SCE_ALIGN(a_uSize - uFaceOffset, uFaceAlignment);
+							uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
 						}
 					}
 				}
-				a_uSize = SCE_ALIGN(a_uSize, SCE_GXM_TEXTURE_ALIGNMENT);
 				return true;
 			}
 
@@ -276,7 +365,7 @@ namespace sce
 			{
 				if (!supportsBorderData(a_eFormat))
 				{
-					UPrintf(USTR("ERROR: format %08X do not support border\n\n"), a_eFormat);
+					CGxt::Report(Format(USTR("ERROR: format %08X do not support border\n\n"), a_eFormat));
 					return false;
 				}
 				u32 uBpp = 0;
@@ -300,6 +389,16 @@ namespace sce
 			}
 
 			bool getBpp(u32& a_uBpp, SceGxmTextureFormat a_eFormat)
+			{
+				if (!lookupBpp(a_uBpp, a_eFormat))
+				{
+					CGxt::Report(Format(USTR("ERROR: do not support base format %08X\n\n"), getBaseFormat(a_eFormat)));
+					return false;
+				}
+				return true;
+			}
+
+			bool lookupBpp(u32& a_uBpp, SceGxmTextureFormat a_eFormat)
 			{
 				SceGxmTextureBaseFormat eBaseFormat = getBaseFormat(a_eFormat);
 				switch (eBaseFormat)
@@ -376,7 +475,6 @@ namespace sce
 					a_uBpp = 32;
 					break;
 				default:
-					UPrintf(USTR("ERROR: do not support base format %08X\n\n"), eBaseFormat);
 					return false;
 				}
 				return true;
@@ -457,8 +555,43 @@ namespace sce
 	} // namespace Texture
 } // namespace sce
 
+const UString CGxt::s_sManifestFileName = USTR("gxttool_manifest.txt");
+
+const UString CGxt::s_sRawPackFileName = USTR("textures");
+
+// keeps every level of the pack aligned for simd loads after mmap
+const u32 CGxt::s_uRawPackAlignment = 64;
+
+const UString CGxt::s_sPaletteRankFileName = USTR("palette_rank.txt");
+
+const u32 CGxt::s_uTestSheetSpacing = 2;
+
+// set while libgxt runs a call on this thread, the messages go to the handle instead of the console
+static thread_local string* s_pErrorSink = nullptr;
+
 CGxt::CGxt()
 	: m_bVerbose(false)
+	, m_eQuality(kQualityHigh)
+	, m_eDither(CQuantizer::kDitherNone)
+	, m_eMipFilter(CMipmap::kFilterNone)
+	, m_bIncremental(false)
+	, m_bPatch(false)
+	, m_bAllLevels(false)
+	, m_bPngRGBA(false)
+	, m_eFormat(kFormatPng)
+	, m_bRawPack(false)
+	, m_fpRawPack(nullptr)
+	, m_eArchive(kArchiveNone)
+	, m_uTestTop(3)
+	, m_bTestSheet(false)
+	, m_bRect(false)
+	, m_uRectX(0)
+	, m_uRectY(0)
+	, m_uRectWidth(0)
+	, m_uRectHeight(0)
+	, m_uThumbnail(0)
+	, m_uPalette16Offset(0)
+	, m_uPalette256Offset(0)
 {
 }
 
@@ -481,9 +614,332 @@ void CGxt::SetVerbose(bool a_bVerbose)
 	m_bVerbose = a_bVerbose;
 }
 
+void CGxt::SetQuality(EQuality a_eQuality)
+{
+	m_eQuality = a_eQuality;
+}
+
+void CGxt::SetDither(CQuantizer::EDither a_eDither)
+{
+	m_eDither = a_eDither;
+}
+
+void CGxt::SetMipFilter(CMipmap::EFilter a_eMipFilter)
+{
+	m_eMipFilter = a_eMipFilter;
+}
+
+void CGxt::SetIncremental(bool a_bIncremental)
+{
+	m_bIncremental = a_bIncremental;
+}
+
+void CGxt::SetCacheDirName(const UString& a_sCacheDirName)
+{
+	m_EncodeCache.SetDirName(a_sCacheDirName);
+}
+
+void CGxt::SetCacheMaxSize(u64 a_uCacheMaxSize)
+{
+	m_EncodeCache.SetMaxSize(a_uCacheMaxSize);
+}
+
+void CGxt::SetAllLevels(bool a_bAllLevels)
+{
+	m_bAllLevels = a_bAllLevels;
+}
+
+void CGxt::SetPngRGBA(bool a_bPngRGBA)
+{
+	m_bPngRGBA = a_bPngRGBA;
+}
+
+void CGxt::SetFormat(EFormat a_eFormat)
+{
+	m_eFormat = a_eFormat;
+}
+
+void CGxt::SetRawPack(bool a_bRawPack)
+{
+	m_bRawPack = a_bRawPack;
+}
+
+void CGxt::SetArchive(EArchive a_eArchive)
+{
+	m_eArchive = a_eArchive;
+}
+
+void CGxt::SetRect(u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight)
+{
+	m_bRect = true;
+	m_uRectX = a_uX;
+	m_uRectY = a_uY;
+	m_uRectWidth = a_uWidth;
+	m_uRectHeight = a_uHeight;
+}
+
+void CGxt::SetThumbnail(u32 a_uThumbnail)
+{
+	m_uThumbnail = a_uThumbnail;
+}
+
+void CGxt::SetTestTop(u32 a_uTestTop)
+{
+	m_uTestTop = a_uTestTop;
+}
+
+void CGxt::SetTestSheet(bool a_bTestSheet)
+{
+	m_bTestSheet = a_bTestSheet;
+}
+
+void CGxt::SetPngEncoder(CPngWriter::EEncoder a_ePngEncoder)
+{
+	m_PngWriter.SetEncoder(a_ePngEncoder);
+}
+
+void CGxt::SetPngLevel(n32 a_nPngLevel)
+{
+	m_PngWriter.SetLevel(a_nPngLevel);
+}
+
+void CGxt::SetPngFilter(CPngWriter::EFilter a_ePngFilter)
+{
+	m_PngWriter.SetFilter(a_ePngFilter);
+}
+
+void CGxt::SetPngStrategy(CPngWriter::EStrategy a_ePngStrategy)
+{
+	m_PngWriter.SetStrategy(a_ePngStrategy);
+}
+
+void CGxt::SetPatch(bool a_bPatch)
+{
+	m_bPatch = a_bPatch;
+}
+
+// the memory interface keeps its own copy of the file, encoded levels are written back into it
+bool CGxt::ParseBuffer(const u8* a_pGxt, u32 a_uGxtSize)
+{
+	if (a_uGxtSize < sizeof(SceGxtHeader))
+	{
+		Report(USTR("ERROR: data size is too small\n\n"));
+		return false;
+	}
+	m_vGxt.assign(a_pGxt, a_pGxt + a_uGxtSize);
+	m_vData.clear();
+	m_vTextureDataOffset.clear();
+	m_vPalette16.clear();
+	m_vPalette256.clear();
+	return parse(&*m_vGxt.begin(), a_uGxtSize);
+}
+
+u32 CGxt::GetTextureCount() const
+{
+	return static_cast<u32>(m_vData.size());
+}
+
+const sce::Texture::Gxt::Data* CGxt::GetTexture(u32 a_uIndex) const
+{
+	return a_uIndex < static_cast<u32>(m_vData.size()) ? &m_vData[a_uIndex] : nullptr;
+}
+
+bool CGxt::GetLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, sce::Texture::Gxt::Level& a_Level) const
+{
+	if (a_uIndex >= static_cast<u32>(m_vData.size()))
+	{
+		return false;
+	}
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+	vector<sce::Texture::Gxt::Level> vLevel;
+	if (!sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type))
+	{
+		return false;
+	}
+	for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
+	{
+		if (it->m_face == a_uFace && it->m_level == a_uLevel)
+		{
+			a_Level = *it;
+			return true;
+		}
+	}
+	return false;
+}
+
+// a_pRGBA receives the texels of the level without the stored padding
+bool CGxt::DecodeLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, u8* a_pRGBA, u32 a_uStride)
+{
+	sce::Texture::Gxt::Level level;
+	if (!GetLevel(a_uIndex, a_uFace, a_uLevel, level))
+	{
+		return false;
+	}
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uWidth = std::max<u32>(data.m_width >> a_uLevel, 1);
+	u32 uHeight = std::max<u32>(data.m_height >> a_uLevel, 1);
+	vector<u8> vRGBA;
+	if (!decodeLevel(a_uIndex, level, vRGBA))
+	{
+		return false;
+	}
+	for (u32 y = 0; y < uHeight; y++)
+	{
+		memcpy(a_pRGBA + y * a_uStride, &*vRGBA.begin() + y * level.m_widthEx * 4, uWidth * 4);
+	}
+	return true;
+}
+
+// indexed levels are mapped to the palette they already use, the palette itself is not changed
+bool CGxt::EncodeLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, const u8* a_pRGBA, u32 a_uStride)
+{
+	sce::Texture::Gxt::Level level;
+	if (m_vGxt.empty() || !GetLevel(a_uIndex, a_uFace, a_uLevel, level))
+	{
+		return false;
+	}
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uWidth = std::max<u32>(data.m_width >> a_uLevel, 1);
+	u32 uHeight = std::max<u32>(data.m_height >> a_uLevel, 1);
+	// pad to the stored size by repeating the last column and row
+	vector<u8> vRGBA(level.m_widthEx * level.m_heightEx * 4);
+	for (u32 y = 0; y < level.m_heightEx; y++)
+	{
+		const u8* pRow = a_pRGBA + std::min<u32>(y, uHeight - 1) * a_uStride;
+		for (u32 x = 0; x < level.m_widthEx; x++)
+		{
+			memcpy(&*vRGBA.begin() + (y * level.m_widthEx + x) * 4, pRow + std::min<u32>(x, uWidth - 1) * 4, 4);
+		}
+	}
+	if (sce::Texture::Gxt::isIndexed(data.m_format))
+	{
+		if (data.m_palette16 == nullptr && data.m_palette256 == nullptr)
+		{
+			return false;
+		}
+		u32 uColorCount = data.m_palette16 != nullptr ? 16 : 256;
+		u32 uPalette = static_cast<u32>(data.m_palette16 != nullptr ? data.m_palette16 - &*m_vPalette16.begin() : data.m_palette256 - &*m_vPalette256.begin());
+		n32 nOrder[4] = {};
+		bool bOpaque = false;
+		if (!getPaletteOrder(data.m_format, nOrder, bOpaque))
+		{
+			return false;
+		}
+		vector<u8> vPalette;
+		getTestPalette(a_uIndex, uPalette, vPalette);
+		vector<u8> vIndex(level.m_widthEx * level.m_heightEx);
+		CQuantizer::Map(&*vRGBA.begin(), level.m_widthEx, level.m_heightEx, &*vPalette.begin(), uColorCount, m_eDither, &*vIndex.begin());
+		setIndex(a_uIndex, level, vIndex, &*m_vGxt.begin());
+		return true;
+	}
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	vector<u8> vLinear(level.m_size);
+	if (encode(&data, &*vRGBA.begin(), level.m_widthEx, level.m_heightEx, uBpp, &*vLinear.begin()) != 0)
+	{
+		Report(USTR("ERROR: encode error\n\n"));
+		return false;
+	}
+	storeLevel(a_uIndex, level, &*vLinear.begin(), &*m_vGxt.begin());
+	return true;
+}
+
+void CGxt::SetErrorSink(string* a_pErrorSink)
+{
+	s_pErrorSink = a_pErrorSink;
+}
+
+// errors and warnings, tasks running on other threads still print
+void CGxt::Report(const UString& a_sMessage)
+{
+	if (s_pErrorSink == nullptr)
+	{
+		UPrintf(USTR("%") PRIUS, a_sMessage.c_str());
+		return;
+	}
+	string sMessage = UToU8(a_sMessage);
+	string::size_type uSize = sMessage.find_last_not_of('\n');
+	if (uSize == string::npos)
+	{
+		return;
+	}
+	if (!s_pErrorSink->empty())
+	{
+		*s_pErrorSink += "\n";
+	}
+	s_pErrorSink->append(sMessage, 0, uSize + 1);
+}
+
+const vector<u8>& CGxt::GetGxt() const
+{
+	return m_vGxt;
+}
+
+// face 0 at the size --thumbnail would write
+bool CGxt::GetThumbnail(u32 a_uIndex, u32 a_uThumbnail, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight)
+{
+	if (a_uIndex >= static_cast<u32>(m_vData.size()) || a_uThumbnail == 0)
+	{
+		return false;
+	}
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	sce::Texture::Gxt::Level level;
+	if (!GetLevel(a_uIndex, 0, getThumbnailLevel(data.m_width, data.m_height, data.m_numLevels, a_uThumbnail), level))
+	{
+		return false;
+	}
+	return makeThumbnail(a_uIndex, level, a_uThumbnail, a_vRGBA, a_uWidth, a_uHeight);
+}
+
+// the rect of level 0 clipped to the texture, false when nothing is left
+bool CGxt::GetRect(u32 a_uIndex, u32 a_uFace, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, vector<u8>& a_vRGBA, u32& a_uRectWidth, u32& a_uRectHeight)
+{
+	sce::Texture::Gxt::Level level;
+	if (!GetLevel(a_uIndex, a_uFace, 0, level))
+	{
+		return false;
+	}
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	if (a_uX >= data.m_width || a_uY >= data.m_height || a_uWidth == 0 || a_uHeight == 0)
+	{
+		return false;
+	}
+	a_uRectWidth = std::min<u32>(a_uWidth, data.m_width - a_uX);
+	a_uRectHeight = std::min<u32>(a_uHeight, data.m_height - a_uY);
+	return decodeRect(a_uIndex, level, a_uX, a_uY, a_uRectWidth, a_uRectHeight, a_vRGBA);
+}
+
 bool CGxt::ExportFile()
 {
-	bool bResult = true;
+	bool bResult = m_uThumbnail != 0 ? exportThumbnail() : exportTextures();
+	if (m_Archive.IsOpen())
+	{
+		if (bResult)
+		{
+			bResult = m_Archive.Close();
+		}
+		else
+		{
+			m_Archive.Abort();
+		}
+	}
+	return bResult;
+}
+
+bool CGxt::exportTextures()
+{
+	struct SExport
+	{
+		u32 Texture;
+		sce::Texture::Gxt::Level Level;
+		u64 RawOffset;
+	};
+	struct SBlockExport
+	{
+		u32 Texture;
+		CBlockFile::EFormat Format;
+	};
 	FILE* fp = UFopen(m_sFileName.c_str(), USTR("rb"));
 	if (fp == nullptr)
 	{
@@ -495,452 +951,2317 @@ bool CGxt::ExportFile()
 	u8* pGxt = new u8[uGxtSize];
 	fread(pGxt, 1, uGxtSize, fp);
 	fclose(fp);
-	SceGxtHeader* pSceGxtHeader = reinterpret_cast<SceGxtHeader*>(pGxt);
-	do
+	bool bResult = parse(pGxt, uGxtSize);
+	delete[] pGxt;
+	if (!bResult || !openExport())
 	{
-		if (!sce::Texture::Gxt::isValidInput(pGxt, uGxtSize))
+		return false;
+	}
+	vector<SExport> vExport;
+	vector<SBlockExport> vBlockExport;
+	CBlockFile::EContainer eContainer = m_eFormat == kFormatDds ? CBlockFile::kContainerDds : (m_eFormat == kFormatKtx ? CBlockFile::kContainerKtx : CBlockFile::kContainerPvr);
+	for (u32 i = 0; i < static_cast<u32>(m_vData.size()); i++)
+	{
+		sce::Texture::Gxt::Data& data = m_vData[i];
+		u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+		vector<sce::Texture::Gxt::Level> vLevel;
+		if (!sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type))
 		{
-			bResult = false;
-			UPrintf(USTR("ERROR: unknown version %08X\n\n"), pSceGxtHeader->version);
-			break;
+			return false;
 		}
-		if (pSceGxtHeader->numP4Palettes * SCE_GXT_PALETTE_SIZE_P4 + pSceGxtHeader->numP8Palettes * SCE_GXT_PALETTE_SIZE_P8 > pSceGxtHeader->dataSize)
+		// block compressed textures are copied to the container as they are, everything else is still a png
+		CBlockFile::EFormat eBlockFormat = CBlockFile::kFormatBC1;
+		if (!m_bRect && m_eFormat != kFormatPng && m_eFormat != kFormatRaw && getBlockFormat(data.m_format, eBlockFormat))
 		{
-			bResult = false;
-			UPrintf(USTR("ERROR: data size is too small\n\n"));
-			break;
+			if (CBlockFile::IsSupported(eContainer, eBlockFormat))
+			{
+				SBlockExport blockExport = { i, eBlockFormat };
+				vBlockExport.push_back(blockExport);
+				continue;
+			}
+			Report(Format(USTR("WARN: texture %u can not be saved as %") PRIUS USTR(", saved as png\n"), i, CBlockFile::GetExtension(eContainer)));
 		}
-		u32 uDataEnd = pSceGxtHeader->dataOffset + pSceGxtHeader->dataSize;
-		u32 uPal256Offset = uDataEnd - pSceGxtHeader->numP8Palettes * SCE_GXT_PALETTE_SIZE_P8;
-		u32 uPal16Offset = uPal256Offset - pSceGxtHeader->numP4Palettes * SCE_GXT_PALETTE_SIZE_P4;
-		for (u32 i = 0; i < pSceGxtHeader->numP4Palettes; i++)
+		for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
 		{
-			sce::Texture::Gxt::Palette16 palette16;
-			memcpy(palette16.m_data, pGxt + uPal16Offset + i * SCE_GXT_PALETTE_SIZE_P4, SCE_GXT_PALETTE_SIZE_P4);
-			m_vPalette16.push_back(palette16);
+			if (it->m_level == 0 || (m_bAllLevels && !m_bRect))
+			{
+				SExport levelExport = { i, *it, 0 };
+				vExport.push_back(levelExport);
+			}
 		}
-		for (u32 i = 0; i < pSceGxtHeader->numP8Palettes; i++)
+	}
+	// the pack has a fixed layout, so every level can be written to its own range in parallel
+	UString sPackFileName = m_sDirName + USTR("/") + s_sRawPackFileName + USTR(".rgba");
+	u64 uPackSize = 0;
+	if (m_eFormat == kFormatRaw && m_bRawPack && !m_bRect)
+	{
+		for (vector<SExport>::iterator it = vExport.begin(); it != vExport.end(); ++it)
 		{
-			sce::Texture::Gxt::Palette256 palette256;
-			memcpy(palette256.m_data, pGxt + uPal256Offset + i * SCE_GXT_PALETTE_SIZE_P8, SCE_GXT_PALETTE_SIZE_P8);
-			m_vPalette256.push_back(palette256);
+			it->RawOffset = SCE_ALIGN(uPackSize, s_uRawPackAlignment);
+			uPackSize = it->RawOffset + static_cast<u64>(std::max<u32>(m_vData[it->Texture].m_width >> it->Level.m_level, 1)) * std::max<u32>(m_vData[it->Texture].m_height >> it->Level.m_level, 1) * 4;
 		}
-		uDataEnd = uPal16Offset;
-		u32 uDataBegin = pSceGxtHeader->dataOffset;
-		if (uDataBegin + pSceGxtHeader->numTextures * sizeof(SceGxtTextureInfo) > uDataEnd)
+		m_fpRawPack = openOutput(sPackFileName);
+		if (m_fpRawPack == nullptr)
 		{
-			bResult = false;
-			UPrintf(USTR("ERROR: data size is too small\n\n"));
+			return false;
+		}
+	}
+	// every face and level decodes on its own, a container holds a whole texture
+	vector<u8> vResult(vExport.size() + vBlockExport.size(), 0);
+	CThreadPool::ParallelFor(static_cast<u32>(vResult.size()), [&](u32 a_uIndex)
+	{
+		if (a_uIndex < static_cast<u32>(vExport.size()) && m_bRect)
+		{
+			vResult[a_uIndex] = exportRect(vExport[a_uIndex].Texture, vExport[a_uIndex].Level) ? 1 : 0;
+		}
+		else if (a_uIndex < static_cast<u32>(vExport.size()) && m_eFormat == kFormatRaw)
+		{
+			vResult[a_uIndex] = exportRaw(vExport[a_uIndex].Texture, vExport[a_uIndex].Level, vExport[a_uIndex].RawOffset) ? 1 : 0;
+		}
+		else if (a_uIndex < static_cast<u32>(vExport.size()))
+		{
+			vResult[a_uIndex] = exportLevel(vExport[a_uIndex].Texture, vExport[a_uIndex].Level) ? 1 : 0;
+		}
+		else
+		{
+			const SBlockExport& blockExport = vBlockExport[a_uIndex - vExport.size()];
+			vResult[a_uIndex] = exportBlock(blockExport.Texture, eContainer, blockExport.Format) ? 1 : 0;
+		}
+	});
+	for (vector<u8>::iterator it = vResult.begin(); it != vResult.end(); ++it)
+	{
+		if (*it == 0)
+		{
+			bResult = false;
+		}
+	}
+	if (m_fpRawPack != nullptr)
+	{
+		bResult = closeOutput(m_fpRawPack, sPackFileName, bResult, uPackSize) && bResult;
+		m_fpRawPack = nullptr;
+	}
+	if (!bResult)
+	{
+		return false;
+	}
+	if (m_eFormat == kFormatRaw && m_bRawPack && !m_bRect)
+	{
+		UString sIndexFileName = m_sDirName + USTR("/") + s_sRawPackFileName + USTR(".json");
+		fp = openOutput(sIndexFileName);
+		if (fp == nullptr)
+		{
+			return false;
+		}
+		fprintf(fp, "{\n\t\"alignment\": %u,\n\t\"levels\":\n\t[", s_uRawPackAlignment);
+		for (vector<SExport>::iterator it = vExport.begin(); it != vExport.end(); ++it)
+		{
+			u64 uSize = static_cast<u64>(std::max<u32>(m_vData[it->Texture].m_width >> it->Level.m_level, 1)) * std::max<u32>(m_vData[it->Texture].m_height >> it->Level.m_level, 1) * 4;
+			fprintf(fp, "%s\n\t\t{ ", it == vExport.begin() ? "" : ",");
+			writeRawJson(fp, it->Texture, it->Level, ", ");
+			fprintf(fp, ", \"offset\": %llu, \"size\": %llu }", static_cast<unsigned long long>(it->RawOffset), static_cast<unsigned long long>(uSize));
+		}
+		fprintf(fp, "\n\t]\n}\n");
+		if (!closeOutput(fp, sIndexFileName, true))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CGxt::openExport()
+{
+	if (m_eArchive != kArchiveNone)
+	{
+		CArchive::EType eArchiveType = m_eArchive == kArchiveTar ? CArchive::kTypeTar : CArchive::kTypeZip;
+		UString sArchiveFileName = m_sDirName + USTR(".") + CArchive::GetExtension(eArchiveType);
+		if (!m_Archive.Open(sArchiveFileName, eArchiveType))
+		{
+			Report(Format(USTR("ERROR: open file %") PRIUS USTR(" failed\n\n"), sArchiveFileName.c_str()));
+			return false;
+		}
+	}
+	else
+	{
+		UMkdir(m_sDirName.c_str());
+	}
+	return true;
+}
+
+// only the header, the info table, the palettes and the chosen level of face 0 are read,
+// each texture data holds that level alone
+bool CGxt::exportThumbnail()
+{
+	FILE* fp = UFopen(m_sFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	Fseek(fp, 0, SEEK_END);
+	u64 uFileSize = Ftell(fp);
+	Fseek(fp, 0, SEEK_SET);
+	SceGxtHeader sceGxtHeader = {};
+	if (uFileSize < sizeof(sceGxtHeader) || fread(&sceGxtHeader, sizeof(sceGxtHeader), 1, fp) != 1 || !sce::Texture::Gxt::isValidInput(reinterpret_cast<const u8*>(&sceGxtHeader), sizeof(sceGxtHeader)))
+	{
+		fclose(fp);
+		Report(Format(USTR("ERROR: %") PRIUS USTR(" is not a gxt file\n\n"), m_sFileName.c_str()));
+		return false;
+	}
+	u64 uDataEnd = static_cast<u64>(sceGxtHeader.dataOffset) + sceGxtHeader.dataSize;
+	u64 uPaletteSize = static_cast<u64>(sceGxtHeader.numP4Palettes) * SCE_GXT_PALETTE_SIZE_P4 + static_cast<u64>(sceGxtHeader.numP8Palettes) * SCE_GXT_PALETTE_SIZE_P8;
+	if (sizeof(sceGxtHeader) + static_cast<u64>(sceGxtHeader.numTextures) * sizeof(SceGxtTextureInfo) > uFileSize || uDataEnd > uFileSize || uPaletteSize > sceGxtHeader.dataSize)
+	{
+		fclose(fp);
+		Report(USTR("ERROR: data size is too small\n\n"));
+		return false;
+	}
+	vector<SceGxtTextureInfo> vSceGxtTextureInfo(sceGxtHeader.numTextures);
+	if (!vSceGxtTextureInfo.empty() && fread(&*vSceGxtTextureInfo.begin(), sizeof(SceGxtTextureInfo), vSceGxtTextureInfo.size(), fp) != vSceGxtTextureInfo.size())
+	{
+		fclose(fp);
+		Report(USTR("ERROR: read file failed\n\n"));
+		return false;
+	}
+	u64 uPalette16Offset = uDataEnd - uPaletteSize;
+	m_vPalette16.resize(sceGxtHeader.numP4Palettes);
+	m_vPalette256.resize(sceGxtHeader.numP8Palettes);
+	Fseek(fp, uPalette16Offset, SEEK_SET);
+	for (vector<sce::Texture::Gxt::Palette16>::iterator it = m_vPalette16.begin(); it != m_vPalette16.end(); ++it)
+	{
+		fread(it->m_data, 1, SCE_GXT_PALETTE_SIZE_P4, fp);
+	}
+	for (vector<sce::Texture::Gxt::Palette256>::iterator it = m_vPalette256.begin(); it != m_vPalette256.end(); ++it)
+	{
+		fread(it->m_data, 1, SCE_GXT_PALETTE_SIZE_P8, fp);
+	}
+	vector<sce::Texture::Gxt::Level> vThumbnailLevel;
+	bool bResult = true;
+	for (u32 i = 0; i < sceGxtHeader.numTextures; i++)
+	{
+		const SceGxtTextureInfo& sceGxtTextureInfo = vSceGxtTextureInfo[i];
+		sce::Texture::Gxt::Data data;
+		data.m_format = static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format);
+		data.m_type = static_cast<SceGxmTextureType>(sceGxtTextureInfo.type);
+		data.m_width = sceGxtTextureInfo.width;
+		data.m_height = sceGxtTextureInfo.height;
+		data.m_numLevels = sceGxtTextureInfo.mipCount;
+		data.m_borderSize = 0;
+		data.m_totalSize = 0;
+		data.m_palette16 = nullptr;
+		data.m_palette256 = nullptr;
+		u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+		vector<sce::Texture::Gxt::Level> vLevel;
+		if (!sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type) || vLevel.empty())
+		{
+			bResult = false;
+			Report(Format(USTR("ERROR: texture %u format %08X is not supported\n\n"), i, sceGxtTextureInfo.format));
+			break;
+		}
+		// levels of face 0 come first
+		sce::Texture::Gxt::Level level = vLevel[getThumbnailLevel(data.m_width, data.m_height, static_cast<u32>(vLevel.size() / uNumFaces), m_uThumbnail)];
+		u64 uLevelOffset = sceGxtTextureInfo.dataOffset + static_cast<u64>(level.m_offset);
+		if ((sceGxtTextureInfo.flags & SCE_GXT_TEXTURE_FLAG_HAS_BORDER_DATA) != 0)
+		{
+			u32 uBorderDataSize = 0;
+			if (!sce::Texture::Gxt::getBorderDataSize(uBorderDataSize, sceGxtTextureInfo.width, sceGxtTextureInfo.height, data.m_format))
+			{
+				bResult = false;
+				break;
+			}
+			uLevelOffset += uBorderDataSize;
+		}
+		if (uLevelOffset + level.m_size > uPalette16Offset)
+		{
+			bResult = false;
+			Report(USTR("ERROR: data size is too small\n\n"));
+			break;
+		}
+		if (sce::Texture::Gxt::isIndexed(data.m_format))
+		{
+			u32 uBpp = 0;
+			sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+			if (uBpp == 4 && sceGxtTextureInfo.paletteIndex < sceGxtHeader.numP4Palettes)
+			{
+				data.m_palette16 = &*(m_vPalette16.begin() + sceGxtTextureInfo.paletteIndex);
+			}
+			else if (uBpp == 8 && sceGxtTextureInfo.paletteIndex < sceGxtHeader.numP8Palettes)
+			{
+				data.m_palette256 = &*(m_vPalette256.begin() + sceGxtTextureInfo.paletteIndex);
+			}
+			else
+			{
+				bResult = false;
+				Report(Format(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex)));
+				break;
+			}
+		}
+		data.m_totalSize = level.m_size;
+		data.m_data.resize(level.m_size);
+		Fseek(fp, uLevelOffset, SEEK_SET);
+		if (fread(&*data.m_data.begin(), 1, level.m_size, fp) != level.m_size)
+		{
+			bResult = false;
+			Report(USTR("ERROR: read file failed\n\n"));
+			break;
+		}
+		level.m_offset = 0;
+		m_vData.push_back(data);
+		vThumbnailLevel.push_back(level);
+	}
+	fclose(fp);
+	if (!bResult || !openExport())
+	{
+		return false;
+	}
+	vector<u8> vResult(vThumbnailLevel.size(), 0);
+	CThreadPool::ParallelFor(static_cast<u32>(vResult.size()), [&](u32 a_uIndex)
+	{
+		vResult[a_uIndex] = writeThumbnail(a_uIndex, vThumbnailLevel[a_uIndex]) ? 1 : 0;
+	});
+	for (vector<u8>::iterator it = vResult.begin(); it != vResult.end(); ++it)
+	{
+		if (*it == 0)
+		{
+			bResult = false;
+		}
+	}
+	return bResult;
+}
+
+bool CGxt::writeThumbnail(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level)
+{
+	vector<u8> vRGBA;
+	u32 uWidth = 0;
+	u32 uHeight = 0;
+	if (!makeThumbnail(a_uIndex, a_Level, m_uThumbnail, vRGBA, uWidth, uHeight))
+	{
+		return false;
+	}
+	return writePng(Format(USTR("%") PRIUS USTR("/%d_thumbnail.png"), m_sDirName.c_str(), a_uIndex), &*vRGBA.begin(), uWidth, uHeight, uWidth * 4);
+}
+
+// the smallest level that still covers the thumbnail, level 0 when none does
+u32 CGxt::getThumbnailLevel(u32 a_uWidth, u32 a_uHeight, u32 a_uNumLevels, u32 a_uThumbnail)
+{
+	u32 uLevel = 0;
+	for (u32 i = 1; i < a_uNumLevels; i++)
+	{
+		if (std::max<u32>(std::max<u32>(a_uWidth >> i, 1), std::max<u32>(a_uHeight >> i, 1)) >= a_uThumbnail)
+		{
+			uLevel = i;
+		}
+	}
+	return uLevel;
+}
+
+// whole halvings first, then one box resize so that the longer side is the thumbnail size
+bool CGxt::makeThumbnail(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uThumbnail, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uWidth = std::max<u32>(data.m_width >> a_Level.m_level, 1);
+	u32 uHeight = std::max<u32>(data.m_height >> a_Level.m_level, 1);
+	vector<u8> vLevel;
+	if (!decodeLevel(a_uIndex, a_Level, vLevel))
+	{
+		return false;
+	}
+	a_vRGBA.resize(uWidth * uHeight * 4);
+	for (u32 y = 0; y < uHeight; y++)
+	{
+		memcpy(&*a_vRGBA.begin() + y * uWidth * 4, &*vLevel.begin() + y * a_Level.m_widthEx * 4, uWidth * 4);
+	}
+	while (std::max<u32>(uWidth, uHeight) >= a_uThumbnail * 2)
+	{
+		u32 uHalfWidth = std::max<u32>(uWidth / 2, 1);
+		u32 uHalfHeight = std::max<u32>(uHeight / 2, 1);
+		vector<u8> vHalf(uHalfWidth * uHalfHeight * 4);
+		CMipmap::Halve(&*a_vRGBA.begin(), uWidth, uHeight, &*vHalf.begin());
+		a_vRGBA.swap(vHalf);
+		uWidth = uHalfWidth;
+		uHeight = uHalfHeight;
+	}
+	if (std::max<u32>(uWidth, uHeight) > a_uThumbnail)
+	{
+		u32 uThumbnailWidth = uWidth >= uHeight ? a_uThumbnail : std::max<u32>((uWidth * a_uThumbnail + uHeight / 2) / uHeight, 1);
+		u32 uThumbnailHeight = uWidth >= uHeight ? std::max<u32>((uHeight * a_uThumbnail + uWidth / 2) / uWidth, 1) : a_uThumbnail;
+		vector<u8> vThumbnail(uThumbnailWidth * uThumbnailHeight * 4);
+		CMipmap::Resize(&*a_vRGBA.begin(), uWidth, uHeight, &*vThumbnail.begin(), uThumbnailWidth, uThumbnailHeight, CMipmap::kFilterBox);
+		a_vRGBA.swap(vThumbnail);
+		uWidth = uThumbnailWidth;
+		uHeight = uThumbnailHeight;
+	}
+	a_uWidth = uWidth;
+	a_uHeight = uHeight;
+	return true;
+}
+
+bool CGxt::exportLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	// level 0 keeps the name import reads, the other levels are only for inspection
+	u32 uWidth = std::max<u32>(data.m_width >> a_Level.m_level, 1);
+	u32 uHeight = std::max<u32>(data.m_height >> a_Level.m_level, 1);
+	UString sPngFileName = getLevelFileName(a_uIndex, a_Level, USTR("png"));
+	if (!m_bPngRGBA && sce::Texture::Gxt::isIndexed(data.m_format) && (data.m_palette16 != nullptr || data.m_palette256 != nullptr))
+	{
+		n32 nOrder[4] = {};
+		bool bOpaque = false;
+		if (!getPaletteOrder(data.m_format, nOrder, bOpaque))
+		{
+			return false;
+		}
+		// indexed textures keep their indices, the palette goes to PLTE and tRNS as the texture shows it
+		u32 uColorCount = data.m_palette16 != nullptr ? 16 : 256;
+		const u8* pPalette = data.m_palette16 != nullptr ? data.m_palette16->m_data : data.m_palette256->m_data;
+		vector<u8> vPalette(uColorCount * 4);
+		for (u32 i = 0; i < uColorCount; i++)
+		{
+			for (n32 j = 0; j < 4; j++)
+			{
+				vPalette[i * 4 + nOrder[j]] = pPalette[i * 4 + j];
+			}
+			if (bOpaque)
+			{
+				vPalette[i * 4 + 3] = 0xFF;
+			}
+		}
+		vector<u8> vIndex;
+		getIndex(a_uIndex, a_Level, vIndex);
+		FILE* fp = openOutput(sPngFileName);
+		if (fp == nullptr)
+		{
+			return false;
+		}
+		bool bResult = m_PngWriter.WriteIndexed(fp, &*vIndex.begin(), uWidth, uHeight, a_Level.m_widthEx, &*vPalette.begin(), uColorCount);
+		return closeOutput(fp, sPngFileName, bResult);
+	}
+	u32 uChannelCount = 1;
+	n32 nBitDepth = 8;
+	bool bSigned = false;
+	if (!m_bPngRGBA && getGrayLayout(data.m_format, uChannelCount, nBitDepth, bSigned))
+	{
+		vector<u8> vGray;
+		getGray(a_uIndex, a_Level, vGray);
+		FILE* fp = openOutput(sPngFileName);
+		if (fp == nullptr)
+		{
+			return false;
+		}
+		bool bResult = m_PngWriter.WriteGray(fp, &*vGray.begin(), uWidth, uHeight, a_Level.m_widthEx * uChannelCount * nBitDepth / 8, uChannelCount, nBitDepth);
+		return closeOutput(fp, sPngFileName, bResult);
+	}
+	vector<u8> vRGBA;
+	if (!decodeLevel(a_uIndex, a_Level, vRGBA))
+	{
+		return false;
+	}
+	return writePng(sPngFileName, &*vRGBA.begin(), uWidth, uHeight, a_Level.m_widthEx * 4);
+}
+
+// raw levels are tightly packed rgba8 rows, described by a json sidecar or by the pack index
+bool CGxt::exportRaw(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u64 a_uOffset)
+{
+	u32 uWidth = std::max<u32>(m_vData[a_uIndex].m_width >> a_Level.m_level, 1);
+	u32 uHeight = std::max<u32>(m_vData[a_uIndex].m_height >> a_Level.m_level, 1);
+	vector<u8> vRGBA;
+	if (!decodeLevel(a_uIndex, a_Level, vRGBA))
+	{
+		return false;
+	}
+	if (m_fpRawPack != nullptr)
+	{
+		lock_guard<mutex> lock(m_RawPackMutex);
+		Fseek(m_fpRawPack, a_uOffset, SEEK_SET);
+		for (u32 i = 0; i < uHeight; i++)
+		{
+			if (fwrite(&vRGBA[i * a_Level.m_widthEx * 4], 1, uWidth * 4, m_fpRawPack) != uWidth * 4)
+			{
+				Report(USTR("ERROR: write file failed\n\n"));
+				return false;
+			}
+		}
+		return true;
+	}
+	UString sRawFileName = getLevelFileName(a_uIndex, a_Level, USTR("rgba"));
+	FILE* fp = openOutput(sRawFileName);
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = true;
+	for (u32 i = 0; i < uHeight; i++)
+	{
+		if (fwrite(&vRGBA[i * a_Level.m_widthEx * 4], 1, uWidth * 4, fp) != uWidth * 4)
+		{
+			Report(USTR("ERROR: write file failed\n\n"));
+			bResult = false;
 			break;
 		}
-		uDataBegin += pSceGxtHeader->numTextures * sizeof(SceGxtTextureInfo);
-		SceGxtTextureInfo* pSceGxtTextureInfo = reinterpret_cast<SceGxtTextureInfo*>(pSceGxtHeader + 1);
-		for (u32 i = 0; i < pSceGxtHeader->numTextures; i++)
+	}
+	if (!closeOutput(fp, sRawFileName, bResult))
+	{
+		return false;
+	}
+	UString sJsonFileName = getLevelFileName(a_uIndex, a_Level, USTR("json"));
+	fp = openOutput(sJsonFileName);
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fprintf(fp, "{\n\t");
+	writeRawJson(fp, a_uIndex, a_Level, ",\n\t");
+	fprintf(fp, "\n}\n");
+	return closeOutput(fp, sJsonFileName, true);
+}
+
+void CGxt::writeRawJson(FILE* a_fp, u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const char* a_pSeparator) const
+{
+	u32 uWidth = std::max<u32>(m_vData[a_uIndex].m_width >> a_Level.m_level, 1);
+	u32 uHeight = std::max<u32>(m_vData[a_uIndex].m_height >> a_Level.m_level, 1);
+	fprintf(a_fp, "\"texture\": %u%s\"face\": %u%s\"level\": %u%s", a_uIndex, a_pSeparator, a_Level.m_face, a_pSeparator, a_Level.m_level, a_pSeparator);
+	fprintf(a_fp, "\"width\": %u%s\"height\": %u%s\"stride\": %u%s", uWidth, a_pSeparator, uHeight, a_pSeparator, uWidth * 4, a_pSeparator);
+	fprintf(a_fp, "\"pixel_format\": \"rgba8\"%s\"gxt_format\": \"0x%08X\"", a_pSeparator, m_vData[a_uIndex].m_format);
+}
+
+// every decodable format ends up as rgba8 with a stride of the padded width
+bool CGxt::decodeLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vRGBA)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uChannelCount = 1;
+	n32 nBitDepth = 8;
+	bool bSigned = false;
+	a_vRGBA.resize(a_Level.m_widthEx * a_Level.m_heightEx * 4);
+	if (getGrayLayout(data.m_format, uChannelCount, nBitDepth, bSigned))
+	{
+		vector<u8> vGray;
+		getGray(a_uIndex, a_Level, vGray);
+		// the high byte of each sample, gray goes to rgb and the second channel to alpha
+		u32 uSampleSize = nBitDepth / 8;
+		for (u32 i = 0; i < a_Level.m_widthEx * a_Level.m_heightEx; i++)
+		{
+			const u8* pSample = &vGray[i * uChannelCount * uSampleSize];
+			a_vRGBA[i * 4] = a_vRGBA[i * 4 + 1] = a_vRGBA[i * 4 + 2] = pSample[uSampleSize - 1];
+			a_vRGBA[i * 4 + 3] = uChannelCount == 2 ? pSample[uSampleSize * 2 - 1] : 0xFF;
+		}
+		return true;
+	}
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	vector<u8> vLinear(a_Level.m_size);
+	loadLinear(a_uIndex, a_Level, &*vLinear.begin());
+	pvrtexture::CPVRTexture* pPVRTexture = nullptr;
+	if (decode(&data, &*vLinear.begin(), a_Level.m_widthEx, a_Level.m_heightEx, uBpp, &pPVRTexture) != 0)
+	{
+		Report(USTR("ERROR: decode error\n\n"));
+		return false;
+	}
+	memcpy(&*a_vRGBA.begin(), pPVRTexture->getDataPtr(), a_vRGBA.size());
+	delete pPVRTexture;
+	return true;
+}
+
+// only the blocks under the rect are read, swizzled levels are addressed through their morton numbers
+bool CGxt::decodeRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, vector<u8>& a_vRGBA)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	a_vRGBA.resize(a_uWidth * a_uHeight * 4);
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	u32 uBlockWidth = 1;
+	u32 uBlockHeight = 1;
+	if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
+	{
+		uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
+		uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
+	}
+	// p4 is decoded in byte pairs
+	u32 uAlignWidth = uBpp == 4 ? 2 : uBlockWidth;
+	u32 uX0 = a_uX / uAlignWidth * uAlignWidth;
+	u32 uY0 = a_uY / uBlockHeight * uBlockHeight;
+	u32 uX1 = SCE_ALIGN(a_uX + a_uWidth, uAlignWidth);
+	u32 uY1 = SCE_ALIGN(a_uY + a_uHeight, uBlockHeight);
+	u32 uChannelCount = 1;
+	n32 nBitDepth = 8;
+	bool bSigned = false;
+	if (sce::Texture::Gxt::isPvr(data.m_format) || getGrayLayout(data.m_format, uChannelCount, nBitDepth, bSigned) || uX1 > a_Level.m_widthEx || uY1 > a_Level.m_heightEx)
+	{
+		// pvrtc blocks blend their neighbours and gray formats decode whole levels, both crop a full decode
+		vector<u8> vRGBA;
+		if (!decodeLevel(a_uIndex, a_Level, vRGBA))
+		{
+			return false;
+		}
+		for (u32 y = 0; y < a_uHeight; y++)
+		{
+			memcpy(&*a_vRGBA.begin() + y * a_uWidth * 4, &*vRGBA.begin() + ((a_uY + y) * a_Level.m_widthEx + a_uX) * 4, a_uWidth * 4);
+		}
+		return true;
+	}
+	u32 uRectWidth = uX1 - uX0;
+	u32 uRectHeight = uY1 - uY0;
+	vector<u8> vLinear(uRectWidth * uRectHeight * uBpp / 8);
+	loadLinearRect(a_uIndex, a_Level, uX0 / uBlockWidth, uY0 / uBlockHeight, uRectWidth / uBlockWidth, uRectHeight / uBlockHeight, &*vLinear.begin());
+	pvrtexture::CPVRTexture* pPVRTexture = nullptr;
+	if (decode(&data, &*vLinear.begin(), uRectWidth, uRectHeight, uBpp, &pPVRTexture) != 0)
+	{
+		Report(USTR("ERROR: decode error\n\n"));
+		return false;
+	}
+	const u8* pRGBA = static_cast<const u8*>(pPVRTexture->getDataPtr());
+	for (u32 y = 0; y < a_uHeight; y++)
+	{
+		memcpy(&*a_vRGBA.begin() + y * a_uWidth * 4, pRGBA + ((a_uY - uY0 + y) * uRectWidth + a_uX - uX0) * 4, a_uWidth * 4);
+	}
+	delete pPVRTexture;
+	return true;
+}
+
+// a_uX, a_uY and the size are in blocks, a block is one texel for uncompressed formats,
+// the rect is written tightly packed
+void CGxt::loadLinearRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, u8* a_pLinear) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	const u8* pLevel = &*data.m_data.begin() + a_Level.m_offset;
+	u32 uBlockWidth = 1;
+	u32 uBlockHeight = 1;
+	u32 uLevelWidth = a_Level.m_widthEx;
+	u32 uLevelHeight = a_Level.m_heightEx;
+	if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
+	{
+		uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
+		uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
+		uLevelWidth = (a_Level.m_width + uBlockWidth - 1) / uBlockWidth;
+		uLevelHeight = (a_Level.m_height + uBlockHeight - 1) / uBlockHeight;
+	}
+	bool bSwizzled = data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE;
+	u32 uWidthPow2 = sce::Texture::enclosingPowerOf2(uLevelWidth);
+	u32 uHeightPow2 = sce::Texture::enclosingPowerOf2(uLevelHeight);
+	u32 uStride = a_Level.m_widthEx / uBlockWidth;
+	u32 uBlockBits = uBpp * uBlockWidth * uBlockHeight;
+	u32 uBlockSize = uBlockBits / 8;
+	for (u32 y = 0; y < a_uHeight; y++)
+	{
+		for (u32 x = 0; x < a_uWidth; x++)
+		{
+			u32 uSrc = bSwizzled ? sce::Texture::getMortonNumber(a_uX + x, a_uY + y, uWidthPow2, uHeightPow2) : (a_uY + y) * uStride + a_uX + x;
+			u32 uTgt = y * a_uWidth + x;
+			if (uBlockBits == 4)
+			{
+				u8 uIndex = pLevel[uSrc / 2] >> (uSrc % 2 * 4) & 0xF;
+				a_pLinear[uTgt / 2] = static_cast<u8>((a_pLinear[uTgt / 2] & (0xF0 >> (uTgt % 2 * 4))) | uIndex << (uTgt % 2 * 4));
+			}
+			else
+			{
+				memcpy(a_pLinear + uTgt * uBlockSize, pLevel + uSrc * uBlockSize, uBlockSize);
+			}
+		}
+	}
+}
+
+bool CGxt::exportRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	if (m_uRectX >= data.m_width || m_uRectY >= data.m_height)
+	{
+		Report(Format(USTR("WARN: rect is outside texture %u\n"), a_uIndex));
+		return true;
+	}
+	u32 uWidth = std::min<u32>(m_uRectWidth, data.m_width - m_uRectX);
+	u32 uHeight = std::min<u32>(m_uRectHeight, data.m_height - m_uRectY);
+	vector<u8> vRGBA;
+	if (!decodeRect(a_uIndex, a_Level, m_uRectX, m_uRectY, uWidth, uHeight, vRGBA))
+	{
+		return false;
+	}
+	return writePng(Format(USTR("%") PRIUS USTR("/%d_%d_rect.png"), m_sDirName.c_str(), a_uIndex, a_Level.m_face), &*vRGBA.begin(), uWidth, uHeight, uWidth * 4);
+}
+
+// only the block order is undone, the blocks themselves are written without decoding
+bool CGxt::exportBlock(u32 a_uIndex, CBlockFile::EContainer a_eContainer, CBlockFile::EFormat a_eBlockFormat)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+	vector<sce::Texture::Gxt::Level> vLevel;
+	sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type);
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	u32 uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
+	u32 uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
+	u32 uBlockSize = uBpp * uBlockWidth * uBlockHeight / 8;
+	vector<vector<u8>> vBlock(vLevel.size());
+	for (u32 i = 0; i < static_cast<u32>(vLevel.size()); i++)
+	{
+		const sce::Texture::Gxt::Level& level = vLevel[i];
+		vector<u8> vLinear(level.m_size);
+		loadLinear(a_uIndex, level, &*vLinear.begin());
+		if (!sce::Texture::Gxt::isUbc(data.m_format))
+		{
+			// pvrtc keeps its own pow2 layout, containers store it as it is
+			vBlock[i].swap(vLinear);
+			continue;
+		}
+		// loadLinear gives every bc level rows at the padded pitch, containers only store the blocks covering the level
+		u32 uBlockCountX = (std::max<u32>(data.m_width >> level.m_level, 1) + uBlockWidth - 1) / uBlockWidth;
+		u32 uBlockCountY = (std::max<u32>(data.m_height >> level.m_level, 1) + uBlockHeight - 1) / uBlockHeight;
+		u32 uStride = level.m_widthEx / uBlockWidth * uBlockSize;
+		vBlock[i].resize(uBlockCountX * uBlockCountY * uBlockSize);
+		for (u32 j = 0; j < uBlockCountY; j++)
+		{
+			memcpy(&vBlock[i][j * uBlockCountX * uBlockSize], &vLinear[j * uStride], uBlockCountX * uBlockSize);
+		}
+	}
+	UString sFileName = Format(USTR("%") PRIUS USTR("/%d.%") PRIUS, m_sDirName.c_str(), a_uIndex, CBlockFile::GetExtension(a_eContainer));
+	FILE* fp = openOutput(sFileName);
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = CBlockFile::Write(fp, a_eContainer, a_eBlockFormat, data.m_width, data.m_height, data.m_numLevels, uNumFaces, vBlock);
+	return closeOutput(fp, sFileName, bResult);
+}
+
+bool CGxt::writePng(const UString& a_sPngFileName, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride)
+{
+	FILE* fp = openOutput(a_sPngFileName);
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = m_PngWriter.Write(fp, a_pRGBA, a_uWidth, a_uHeight, a_uStride);
+	return closeOutput(fp, a_sPngFileName, bResult);
+}
+
+// with an archive every output goes to a scratch file and is appended as one entry when it is done
+FILE* CGxt::openOutput(const UString& a_sFileName)
+{
+	FILE* fp = m_Archive.IsOpen() ? m_Archive.AcquireScratch() : UFopen(a_sFileName.c_str(), USTR("wb"));
+	if (fp != nullptr && m_bVerbose)
+	{
+		UPrintf(USTR("save: %") PRIUS USTR("\n"), a_sFileName.c_str());
+	}
+	return fp;
+}
+
+bool CGxt::closeOutput(FILE* a_fp, const UString& a_sFileName, bool a_bResult, u64 a_uSize)
+{
+	if (!m_Archive.IsOpen())
+	{
+		fclose(a_fp);
+		return a_bResult;
+	}
+	if (!a_bResult)
+	{
+		m_Archive.ReleaseScratch(a_fp);
+		return false;
+	}
+	if (a_uSize == UINT64_MAX)
+	{
+		a_uSize = Ftell(a_fp);
+	}
+	return m_Archive.Add(UToA(a_sFileName.substr(m_sDirName.size() + 1)), a_fp, a_uSize);
+}
+
+bool CGxt::ImportFile()
+{
+	if (!CPatcher::Recover(m_sFileName))
+	{
+		return false;
+	}
+	FILE* fp = UFopen(m_sFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	u32 uGxtSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	u8* pGxt = new u8[uGxtSize];
+	fread(pGxt, 1, uGxtSize, fp);
+	fclose(fp);
+	bool bResult = parse(pGxt, uGxtSize);
+	vector<CPatcher::SRange> vRange;
+	if (bResult && m_bIncremental)
+	{
+		loadManifest();
+	}
+	if (bResult)
+	{
+		bResult = importIndexed(pGxt, vRange);
+	}
+	if (bResult)
+	{
+		// textures are independent, each one runs on its own worker
+		u32 uTextureCount = static_cast<u32>(m_vData.size());
+		vector<n32> vResult(uTextureCount, 0);
+		CThreadPool::ParallelFor(uTextureCount, [&](u32 a_uIndex)
+		{
+			if (!sce::Texture::Gxt::isIndexed(m_vData[a_uIndex].m_format))
+			{
+				vResult[a_uIndex] = importTexture(pGxt, a_uIndex);
+			}
+		});
+		for (u32 i = 0; i < uTextureCount; i++)
+		{
+			if (vResult[i] < 0)
+			{
+				bResult = false;
+				break;
+			}
+			if (vResult[i] > 0)
+			{
+				CPatcher::SRange range = { m_vTextureDataOffset[i], static_cast<u32>(m_vData[i].m_data.size()) };
+				vRange.push_back(range);
+			}
+		}
+	}
+	if (bResult && !vRange.empty() && m_bPatch)
+	{
+		// every texture keeps its slot, so only the touched ranges need to reach the disk
+		bResult = CPatcher::Patch(m_sFileName, pGxt, uGxtSize, vRange, m_bVerbose);
+	}
+	else if (bResult && !vRange.empty())
+	{
+		bResult = writeGxt(pGxt, uGxtSize);
+	}
+	if (bResult && m_bIncremental && !saveManifest())
+	{
+		Report(USTR("WARN: save manifest failed\n\n"));
+	}
+	m_EncodeCache.Trim();
+	delete[] pGxt;
+	return bResult;
+}
+
+bool CGxt::writeGxt(const u8* a_pGxt, u32 a_uGxtSize) const
+{
+	// the original stays untouched until the new file is complete on disk
+	UString sTempFileName = m_sFileName + USTR(".tmp");
+	FILE* fp = UFopen(sTempFileName.c_str(), USTR("wb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = fwrite(a_pGxt, 1, a_uGxtSize, fp) == a_uGxtSize;
+	bResult = fflush(fp) == 0 && bResult;
+	bResult = fclose(fp) == 0 && bResult;
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	if (bResult)
+	{
+		_wremove(m_sFileName.c_str());
+	}
+	if (!bResult || _wrename(sTempFileName.c_str(), m_sFileName.c_str()) != 0)
+	{
+		_wremove(sTempFileName.c_str());
+		bResult = false;
+	}
+#else
+	if (!bResult || rename(sTempFileName.c_str(), m_sFileName.c_str()) != 0)
+	{
+		remove(sTempFileName.c_str());
+		bResult = false;
+	}
+#endif
+	if (!bResult)
+	{
+		Report(Format(USTR("ERROR: write %") PRIUS USTR(" failed\n\n"), m_sFileName.c_str()));
+	}
+	return bResult;
+}
+
+n32 CGxt::importTexture(u8* a_pGxt, u32 a_uIndex)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+	u32 uBpp = 0;
+	vector<sce::Texture::Gxt::Level> vLevel;
+	if (!sce::Texture::Gxt::getBpp(uBpp, data.m_format) || !sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type))
+	{
+		return -1;
+	}
+	u64 uPngHash = 0;
+	if (m_bIncremental)
+	{
+		if (!getPngHash(a_uIndex, uPngHash))
+		{
+			return -1;
+		}
+		if (isUnchanged(a_uIndex, uPngHash))
+		{
+			return 0;
+		}
+	}
+	vector<vector<u8>> vFaceRGBA(uNumFaces);
+	vector<u8> vFound(uNumFaces, 0);
+	for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
+	{
+		if (it->m_level == 0)
+		{
+			bool bFound = false;
+			if (!loadLevel(a_uIndex, *it, vFaceRGBA[it->m_face], bFound))
+			{
+				return -1;
+			}
+			vFound[it->m_face] = bFound ? 1 : 0;
+		}
+	}
+	// the encoded texture only depends on the pixels, the settings and the data it is merged into
+	CEncodeCache::CKeyBuilder keyBuilder;
+	CEncodeCache::SKey key = {};
+	if (m_EncodeCache.IsEnabled())
+	{
+		addKey(keyBuilder, a_uIndex);
+		keyBuilder.Add(m_eQuality);
+		for (u32 i = 0; i < uNumFaces; i++)
+		{
+			keyBuilder.Add(vFound[i]);
+			if (vFound[i] != 0)
+			{
+				keyBuilder.Add(&*vFaceRGBA[i].begin(), vFaceRGBA[i].size());
+			}
+		}
+		key = keyBuilder.GetKey();
+		vector<u8> vCache;
+		if (m_EncodeCache.Load(key, vCache) && vCache.size() == data.m_data.size())
+		{
+			if (vCache != data.m_data)
+			{
+				storeData(a_uIndex, &*vCache.begin(), a_pGxt);
+			}
+			if (m_bIncremental)
+			{
+				updateManifest(a_uIndex, uPngHash);
+			}
+			return 1;
+		}
+	}
+	n32 nResult = 0;
+	vector<vector<u8>> vMipmap;
+	for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
+	{
+		sce::Texture::Gxt::Level& level = *it;
+		vector<u8> vRGBA;
+		if (level.m_level == 0)
+		{
+			vMipmap.clear();
+			if (vFound[level.m_face] == 0)
+			{
+				continue;
+			}
+			vRGBA.swap(vFaceRGBA[level.m_face]);
+			if (m_eMipFilter != CMipmap::kFilterNone)
+			{
+				generateMipmap(a_uIndex, vLevel, level.m_face, vRGBA, vMipmap);
+			}
+		}
+		else if (level.m_level < vMipmap.size())
+		{
+			vRGBA.swap(vMipmap[level.m_level]);
+		}
+		else
+		{
+			continue;
+		}
+		vector<u8> vLinear(level.m_size);
+		if (encode(&data, &*vRGBA.begin(), level.m_widthEx, level.m_heightEx, uBpp, &*vLinear.begin()) != 0)
+		{
+			Report(USTR("ERROR: encode error\n\n"));
+			return -1;
+		}
+		storeLevel(a_uIndex, level, &*vLinear.begin(), a_pGxt);
+		nResult = 1;
+	}
+	if (nResult > 0)
+	{
+		m_EncodeCache.Store(key, data.m_data);
+	}
+	if (m_bIncremental && nResult > 0)
+	{
+		updateManifest(a_uIndex, uPngHash);
+	}
+	return nResult;
+}
+
+void CGxt::generateMipmap(u32 a_uIndex, const vector<sce::Texture::Gxt::Level>& a_vLevel, u32 a_uFace, const vector<u8>& a_vRGBA, vector<vector<u8>>& a_vMipmap) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	a_vMipmap.assign(data.m_numLevels, vector<u8>());
+	if (data.m_numLevels <= 1)
+	{
+		return;
+	}
+	// each level is filtered from the previous one at its visible size, then edge-padded to the stored size
+	u32 uWidth = data.m_width;
+	u32 uHeight = data.m_height;
+	u32 uStride = 0;
+	for (vector<sce::Texture::Gxt::Level>::const_iterator it = a_vLevel.begin(); it != a_vLevel.end(); ++it)
+	{
+		if (it->m_face == a_uFace && it->m_level == 0)
+		{
+			uStride = it->m_widthEx;
+			break;
+		}
+	}
+	vector<u8> vPrevious(uWidth * uHeight * 4);
+	for (u32 y = 0; y < uHeight; y++)
+	{
+		memcpy(&*vPrevious.begin() + y * uWidth * 4, &*a_vRGBA.begin() + y * uStride * 4, uWidth * 4);
+	}
+	for (vector<sce::Texture::Gxt::Level>::const_iterator it = a_vLevel.begin(); it != a_vLevel.end(); ++it)
+	{
+		if (it->m_face != a_uFace || it->m_level == 0)
+		{
+			continue;
+		}
+		u32 uMipWidth = std::max<u32>(data.m_width >> it->m_level, 1);
+		u32 uMipHeight = std::max<u32>(data.m_height >> it->m_level, 1);
+		vector<u8> vCurrent(uMipWidth * uMipHeight * 4);
+		CMipmap::Resize(&*vPrevious.begin(), uWidth, uHeight, &*vCurrent.begin(), uMipWidth, uMipHeight, m_eMipFilter);
+		vector<u8>& vMipmap = a_vMipmap[it->m_level];
+		vMipmap.resize(it->m_widthEx * it->m_heightEx * 4);
+		for (u32 y = 0; y < it->m_heightEx; y++)
+		{
+			u32 uSrcY = std::min<u32>(y, uMipHeight - 1);
+			for (u32 x = 0; x < it->m_widthEx; x++)
+			{
+				memcpy(&*vMipmap.begin() + (y * it->m_widthEx + x) * 4, &*vCurrent.begin() + (uSrcY * uMipWidth + std::min<u32>(x, uMipWidth - 1)) * 4, 4);
+			}
+		}
+		vPrevious.swap(vCurrent);
+		uWidth = uMipWidth;
+		uHeight = uMipHeight;
+	}
+}
+
+UString CGxt::getPngFileName(u32 a_uIndex, u32 a_uFace) const
+{
+	return Format(USTR("%") PRIUS USTR("/%d_%d.png"), m_sDirName.c_str(), a_uIndex, a_uFace);
+}
+
+UString CGxt::getLevelFileName(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const UChar* a_pExtension) const
+{
+	if (a_Level.m_level == 0)
+	{
+		return Format(USTR("%") PRIUS USTR("/%d_%d.%") PRIUS, m_sDirName.c_str(), a_uIndex, a_Level.m_face, a_pExtension);
+	}
+	return Format(USTR("%") PRIUS USTR("/%d_%d_%d.%") PRIUS, m_sDirName.c_str(), a_uIndex, a_Level.m_face, a_Level.m_level, a_pExtension);
+}
+
+bool CGxt::getPngHash(u32 a_uIndex, u64& a_uHash) const
+{
+	u32 uNumFaces = m_vData[a_uIndex].m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+	a_uHash = CHash::s_uFnvOffsetBasis;
+	for (u32 i = 0; i < uNumFaces; i++)
+	{
+		// a missing face still changes the hash so that adding or removing a png is noticed
+		a_uHash = CHash::Fnv1a64(&i, sizeof(i), a_uHash);
+		FILE* fp = UFopen(getPngFileName(a_uIndex, i).c_str(), USTR("rb"));
+		if (fp == nullptr)
+		{
+			continue;
+		}
+		bool bResult = CHash::File(fp, a_uHash);
+		fclose(fp);
+		if (!bResult)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+u64 CGxt::getDataHash(u32 a_uIndex) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u64 uHash = CHash::Fnv1a64(&*data.m_data.begin(), data.m_data.size());
+	if (data.m_palette16 != nullptr)
+	{
+		uHash = CHash::Fnv1a64(data.m_palette16->m_data, sizeof(data.m_palette16->m_data), uHash);
+	}
+	if (data.m_palette256 != nullptr)
+	{
+		uHash = CHash::Fnv1a64(data.m_palette256->m_data, sizeof(data.m_palette256->m_data), uHash);
+	}
+	return uHash;
+}
+
+bool CGxt::isUnchanged(u32 a_uIndex, u64 a_uPngHash) const
+{
+	const SManifest& manifest = m_vManifest[a_uIndex];
+	return manifest.Valid && manifest.PngHash == a_uPngHash && manifest.Format == static_cast<u32>(m_vData[a_uIndex].m_format) && manifest.DataHash == getDataHash(a_uIndex);
+}
+
+void CGxt::updateManifest(u32 a_uIndex, u64 a_uPngHash)
+{
+	SManifest& manifest = m_vManifest[a_uIndex];
+	manifest.Valid = true;
+	manifest.PngHash = a_uPngHash;
+	manifest.Format = m_vData[a_uIndex].m_format;
+	manifest.DataHash = getDataHash(a_uIndex);
+}
+
+void CGxt::loadManifest()
+{
+	SManifest manifest = {};
+	m_vManifest.assign(m_vData.size(), manifest);
+	FILE* fp = UFopen((m_sDirName + USTR("/") + s_sManifestFileName).c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return;
+	}
+	char szLine[256] = {};
+	while (fgets(szLine, sizeof(szLine), fp) != nullptr)
+	{
+		u32 uIndex = 0;
+		u32 uFormat = 0;
+		u32 uPngHash[2] = {};
+		u32 uDataHash[2] = {};
+		if (sscanf(szLine, "%u %08X %08X%08X %08X%08X", &uIndex, &uFormat, &uPngHash[1], &uPngHash[0], &uDataHash[1], &uDataHash[0]) != 6 || uIndex >= m_vManifest.size())
+		{
+			continue;
+		}
+		SManifest& entry = m_vManifest[uIndex];
+		entry.Valid = true;
+		entry.Format = uFormat;
+		entry.PngHash = static_cast<u64>(uPngHash[1]) << 32 | uPngHash[0];
+		entry.DataHash = static_cast<u64>(uDataHash[1]) << 32 | uDataHash[0];
+	}
+	fclose(fp);
+}
+
+bool CGxt::saveManifest() const
+{
+	FILE* fp = UFopen((m_sDirName + USTR("/") + s_sManifestFileName).c_str(), USTR("wb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fprintf(fp, "# index format png_hash data_hash\n");
+	for (u32 i = 0; i < static_cast<u32>(m_vManifest.size()); i++)
+	{
+		const SManifest& manifest = m_vManifest[i];
+		if (manifest.Valid)
+		{
+			fprintf(fp, "%u %08X %08X%08X %08X%08X\n", i, manifest.Format, static_cast<u32>(manifest.PngHash >> 32), static_cast<u32>(manifest.PngHash), static_cast<u32>(manifest.DataHash >> 32), static_cast<u32>(manifest.DataHash));
+		}
+	}
+	fclose(fp);
+	return true;
+}
+
+void CGxt::storeLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const u8* a_pLinear, u8* a_pGxt)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	u8* pLevel = &*data.m_data.begin() + a_Level.m_offset;
+	if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
+	{
+		u32 uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
+		u32 uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
+		if (!sce::Texture::Gxt::isPvr(data.m_format) && (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE))
+		{
+			// the rows come in at the padded pitch, the swizzle only covers the blocks of the level
+			u32 uBlockCountX = (a_Level.m_width + uBlockWidth - 1) / uBlockWidth;
+			u32 uBlockCountY = (a_Level.m_height + uBlockHeight - 1) / uBlockHeight;
+			u32 uBlockSize = uBpp * uBlockWidth * uBlockHeight / 8;
+			u32 uPitch = a_Level.m_widthEx / uBlockWidth * uBlockSize;
+			vector<u8> vTight(uBlockCountX * uBlockCountY * uBlockSize);
+			for (u32 y = 0; y < uBlockCountY; y++)
+			{
+				memcpy(&*vTight.begin() + y * uBlockCountX * uBlockSize, a_pLinear + y * uPitch, uBlockCountX * uBlockSize);
+			}
+			sce::Texture::swizzleLevel(pLevel, &*vTight.begin(), uBlockCountX, uBlockCountY, uBpp * uBlockWidth * uBlockHeight);
+		}
+		else
+		{
+			memcpy(pLevel, a_pLinear, a_Level.m_size);
+		}
+	}
+	else if (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE)
+	{
+		sce::Texture::swizzleLevel(pLevel, a_pLinear, a_Level.m_widthEx, a_Level.m_heightEx, uBpp);
+	}
+	else
+	{
+		memcpy(pLevel, a_pLinear, a_Level.m_size);
+	}
+	memcpy(a_pGxt + m_vTextureDataOffset[a_uIndex] + a_Level.m_offset, pLevel, a_Level.m_size);
+}
+
+void CGxt::loadLinear(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u8* a_pLinear) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, data.m_format);
+	const u8* pLevel = &*data.m_data.begin() + a_Level.m_offset;
+	if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
+	{
+		u32 uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
+		u32 uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
+		if (!sce::Texture::Gxt::isPvr(data.m_format) && (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE))
+		{
+			// the swizzle only covers the blocks of the level, the rows are spread to the padded pitch
+			// every reader expects, the same as a linear level
+			u32 uBlockCountX = (a_Level.m_width + uBlockWidth - 1) / uBlockWidth;
+			u32 uBlockCountY = (a_Level.m_height + uBlockHeight - 1) / uBlockHeight;
+			u32 uBlockSize = uBpp * uBlockWidth * uBlockHeight / 8;
+			u32 uPitch = a_Level.m_widthEx / uBlockWidth * uBlockSize;
+			vector<u8> vTight(uBlockCountX * uBlockCountY * uBlockSize);
+			sce::Texture::deSwizzleLevel(&*vTight.begin(), pLevel, uBlockCountX, uBlockCountY, uBpp * uBlockWidth * uBlockHeight);
+			memset(a_pLinear, 0, a_Level.m_size);
+			for (u32 y = 0; y < uBlockCountY; y++)
+			{
+				memcpy(a_pLinear + y * uPitch, &*vTight.begin() + y * uBlockCountX * uBlockSize, uBlockCountX * uBlockSize);
+			}
+		}
+		else
+		{
+			memcpy(a_pLinear, pLevel, a_Level.m_size);
+		}
+	}
+	else if (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE)
+	{
+		sce::Texture::deSwizzleLevel(a_pLinear, pLevel, a_Level.m_widthEx, a_Level.m_heightEx, uBpp);
+	}
+	else
+	{
+		memcpy(a_pLinear, pLevel, a_Level.m_size);
+	}
+}
+
+bool CGxt::loadLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vRGBA, bool& a_bFound, vector<u8>* a_pIndex, vector<u8>* a_pPalette) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	a_bFound = false;
+	UString sPngFileName = getPngFileName(a_uIndex, a_Level.m_face);
+	FILE* fp = UFopen(sPngFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return true;
+	}
+	if (m_bVerbose)
+	{
+		UPrintf(USTR("load: %") PRIUS USTR("\n"), sPngFileName.c_str());
+	}
+	vector<u8> vRGBA;
+	vector<u8> vIndex;
+	u32 uPngWidth = 0;
+	u32 uPngHeight = 0;
+	bool bResult = readPng(fp, vRGBA, uPngWidth, uPngHeight, a_pIndex != nullptr ? &vIndex : nullptr, a_pPalette);
+	fclose(fp);
+	if (!bResult)
+	{
+		return false;
+	}
+	if (uPngWidth != data.m_width || uPngHeight != data.m_height)
+	{
+		Report(Format(USTR("ERROR: %") PRIUS USTR(" size %ux%u != %ux%u\n\n"), sPngFileName.c_str(), uPngWidth, uPngHeight, data.m_width, data.m_height));
+		return false;
+	}
+	// pad to the stored size by repeating the last column and row
+	a_vRGBA.resize(a_Level.m_widthEx * a_Level.m_heightEx * 4);
+	for (u32 y = 0; y < a_Level.m_heightEx; y++)
+	{
+		u32 uSrcY = std::min<u32>(y, uPngHeight - 1);
+		for (u32 x = 0; x < a_Level.m_widthEx; x++)
+		{
+			u32 uSrcX = std::min<u32>(x, uPngWidth - 1);
+			memcpy(&*a_vRGBA.begin() + (y * a_Level.m_widthEx + x) * 4, &*vRGBA.begin() + (uSrcY * uPngWidth + uSrcX) * 4, 4);
+		}
+	}
+	if (a_pIndex != nullptr)
+	{
+		a_pIndex->clear();
+		if (!vIndex.empty())
+		{
+			a_pIndex->resize(a_Level.m_widthEx * a_Level.m_heightEx);
+			for (u32 y = 0; y < a_Level.m_heightEx; y++)
+			{
+				u32 uSrcY = std::min<u32>(y, uPngHeight - 1);
+				for (u32 x = 0; x < a_Level.m_widthEx; x++)
+				{
+					(*a_pIndex)[y * a_Level.m_widthEx + x] = vIndex[uSrcY * uPngWidth + std::min<u32>(x, uPngWidth - 1)];
+				}
+			}
+		}
+	}
+	a_bFound = true;
+	return true;
+}
+
+bool CGxt::importIndexed(u8* a_pGxt, vector<CPatcher::SRange>& a_vRange)
+{
+	// textures sharing a palette are quantised together, independent palettes run in parallel
+	vector<vector<u32>> vPalette16Texture(m_vPalette16.size());
+	vector<vector<u32>> vPalette256Texture(m_vPalette256.size());
+	for (u32 i = 0; i < static_cast<u32>(m_vData.size()); i++)
+	{
+		sce::Texture::Gxt::Data& data = m_vData[i];
+		if (data.m_palette16 != nullptr)
+		{
+			vPalette16Texture[data.m_palette16 - &*m_vPalette16.begin()].push_back(i);
+		}
+		else if (data.m_palette256 != nullptr)
+		{
+			vPalette256Texture[data.m_palette256 - &*m_vPalette256.begin()].push_back(i);
+		}
+	}
+	u32 uPaletteCount = static_cast<u32>(m_vPalette16.size() + m_vPalette256.size());
+	vector<n32> vResult(uPaletteCount, 0);
+	CThreadPool::ParallelFor(uPaletteCount, [&](u32 a_uPalette)
+	{
+		if (a_uPalette < m_vPalette16.size())
+		{
+			vResult[a_uPalette] = importPalette(a_pGxt, m_vPalette16[a_uPalette].m_data, 16, m_uPalette16Offset + a_uPalette * SCE_GXT_PALETTE_SIZE_P4, vPalette16Texture[a_uPalette]);
+		}
+		else
+		{
+			u32 uPalette = a_uPalette - static_cast<u32>(m_vPalette16.size());
+			vResult[a_uPalette] = importPalette(a_pGxt, m_vPalette256[uPalette].m_data, 256, m_uPalette256Offset + uPalette * SCE_GXT_PALETTE_SIZE_P8, vPalette256Texture[uPalette]);
+		}
+	});
+	for (u32 i = 0; i < uPaletteCount; i++)
+	{
+		if (vResult[i] < 0)
+		{
+			return false;
+		}
+		if (vResult[i] > 0)
+		{
+			const vector<u32>& vTexture = i < m_vPalette16.size() ? vPalette16Texture[i] : vPalette256Texture[i - m_vPalette16.size()];
+			CPatcher::SRange range = {};
+			if (i < m_vPalette16.size())
+			{
+				range.Offset = m_uPalette16Offset + i * SCE_GXT_PALETTE_SIZE_P4;
+				range.Size = SCE_GXT_PALETTE_SIZE_P4;
+			}
+			else
+			{
+				range.Offset = m_uPalette256Offset + (i - static_cast<u32>(m_vPalette16.size())) * SCE_GXT_PALETTE_SIZE_P8;
+				range.Size = SCE_GXT_PALETTE_SIZE_P8;
+			}
+			a_vRange.push_back(range);
+			for (vector<u32>::const_iterator it = vTexture.begin(); it != vTexture.end(); ++it)
+			{
+				range.Offset = m_vTextureDataOffset[*it];
+				range.Size = static_cast<u32>(m_vData[*it].m_data.size());
+				a_vRange.push_back(range);
+			}
+		}
+	}
+	return true;
+}
+
+n32 CGxt::importPalette(u8* a_pGxt, u8* a_pPalette, u32 a_uColorCount, u32 a_uPaletteOffset, const vector<u32>& a_vTexture)
+{
+	struct SImage
+	{
+		u32 Texture;
+		sce::Texture::Gxt::Level Level;
+		vector<u8> RGBA;
+		vector<u8> Index;
+		vector<u8> Palette;
+		bool Changed;
+	};
+	if (a_vTexture.empty())
+	{
+		return 0;
+	}
+	vector<u64> vPngHash(a_vTexture.size(), 0);
+	if (m_bIncremental || m_EncodeCache.IsEnabled())
+	{
+		bool bUnchanged = m_bIncremental;
+		for (u32 i = 0; i < static_cast<u32>(a_vTexture.size()); i++)
+		{
+			if (!getPngHash(a_vTexture[i], vPngHash[i]))
+			{
+				return -1;
+			}
+			if (bUnchanged && !isUnchanged(a_vTexture[i], vPngHash[i]))
+			{
+				bUnchanged = false;
+			}
+		}
+		if (bUnchanged)
+		{
+			return 0;
+		}
+	}
+	// the whole group is cached as one entry: the palette followed by the data of every texture,
+	// the pngs are keyed by file because their own palette steers the index assignment
+	CEncodeCache::CKeyBuilder keyBuilder;
+	CEncodeCache::SKey key = {};
+	if (m_EncodeCache.IsEnabled())
+	{
+		keyBuilder.Add(a_uColorCount);
+		keyBuilder.Add(m_eDither);
+		keyBuilder.Add(a_pPalette, a_uColorCount * 4);
+		size_t uCacheSize = a_uColorCount * 4;
+		for (u32 i = 0; i < static_cast<u32>(a_vTexture.size()); i++)
+		{
+			addKey(keyBuilder, a_vTexture[i]);
+			keyBuilder.Add(&vPngHash[i], sizeof(vPngHash[i]));
+			uCacheSize += m_vData[a_vTexture[i]].m_data.size();
+		}
+		key = keyBuilder.GetKey();
+		vector<u8> vCache;
+		if (m_EncodeCache.Load(key, vCache) && vCache.size() == uCacheSize)
+		{
+			const u8* pCache = &*vCache.begin();
+			memcpy(a_pPalette, pCache, a_uColorCount * 4);
+			memcpy(a_pGxt + a_uPaletteOffset, a_pPalette, a_uColorCount * 4);
+			pCache += a_uColorCount * 4;
+			for (u32 i = 0; i < static_cast<u32>(a_vTexture.size()); i++)
+			{
+				storeData(a_vTexture[i], pCache, a_pGxt);
+				pCache += m_vData[a_vTexture[i]].m_data.size();
+			}
+			if (m_bIncremental)
+			{
+				for (u32 i = 0; i < static_cast<u32>(a_vTexture.size()); i++)
+				{
+					updateManifest(a_vTexture[i], vPngHash[i]);
+				}
+			}
+			return 1;
+		}
+	}
+	// palette entries are stored in the channel order of the texture format, work in RGBA
+	n32 nOrder[4] = {};
+	bool bOpaque = false;
+	if (!getPaletteOrder(m_vData[a_vTexture.front()].m_format, nOrder, bOpaque))
+	{
+		return -1;
+	}
+	vector<u8> vPalette(a_uColorCount * 4);
+	for (u32 i = 0; i < a_uColorCount; i++)
+	{
+		for (n32 j = 0; j < 4; j++)
+		{
+			vPalette[i * 4 + nOrder[j]] = a_pPalette[i * 4 + j];
+		}
+	}
+	vector<SImage> vImage;
+	vector<SImage> vKeep;
+	vector<SImage> vMipmap;
+	for (vector<u32>::const_iterator itTexture = a_vTexture.begin(); itTexture != a_vTexture.end(); ++itTexture)
+	{
+		sce::Texture::Gxt::Data& data = m_vData[*itTexture];
+		u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+		vector<sce::Texture::Gxt::Level> vLevel;
+		if (!sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type))
+		{
+			return -1;
+		}
+		// a texture sharing the palette in another channel order sees other colours,
+		// its pngs are moved into the order of the first texture
+		n32 nTextureOrder[4] = {};
+		bool bTextureOpaque = false;
+		if (!getPaletteOrder(data.m_format, nTextureOrder, bTextureOpaque))
+		{
+			return -1;
+		}
+		// the png of a 1 format shows 0xff for the alpha byte it ignores, which lands in this channel here
+		n32 nIgnored = -1;
+		for (n32 j = 0; bTextureOpaque && j < 4; j++)
+		{
+			if (nTextureOrder[j] == 3)
+			{
+				nIgnored = nOrder[j];
+			}
+		}
+		vector<vector<u8>> vFaceMipmap;
+		for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
+		{
+			SImage image;
+			image.Texture = *itTexture;
+			image.Level = *it;
+			image.Changed = false;
+			bool bFound = false;
+			if (it->m_level == 0)
+			{
+				vFaceMipmap.clear();
+				if (!loadLevel(*itTexture, *it, image.RGBA, bFound, &image.Index, &image.Palette))
+				{
+					return -1;
+				}
+				if (bFound && memcmp(nTextureOrder, nOrder, sizeof(nOrder)) != 0)
+				{
+					for (vector<u8>::iterator itPixel = image.RGBA.begin(); itPixel != image.RGBA.end(); itPixel += 4)
+					{
+						u8 uPixel[4] = {};
+						for (n32 j = 0; j < 4; j++)
+						{
+							uPixel[nOrder[j]] = itPixel[nTextureOrder[j]];
+						}
+						memcpy(&*itPixel, uPixel, 4);
+					}
+				}
+				if (bFound && nIgnored >= 0)
+				{
+					// texels showing the entry of their png index or their old index in the other
+					// channels get the stored byte of that entry back
+					vector<u8> vIndex;
+					getIndex(*itTexture, *it, vIndex);
+					for (u32 uPos = 0; uPos < static_cast<u32>(vIndex.size()); uPos++)
+					{
+						u8* pPixel = &*image.RGBA.begin() + uPos * 4;
+						u32 uEntry[2] = { !image.Index.empty() && image.Index[uPos] < a_uColorCount ? image.Index[uPos] : vIndex[uPos], vIndex[uPos] };
+						for (n32 k = 0; k < 2; k++)
+						{
+							const u8* pEntry = &*vPalette.begin() + uEntry[k] * 4;
+							bool bSame = true;
+							for (n32 j = 0; j < 4; j++)
+							{
+								bSame = bSame && (j == nIgnored || pEntry[j] == pPixel[j]);
+							}
+							if (bSame)
+							{
+								pPixel[nIgnored] = pEntry[nIgnored];
+								break;
+							}
+						}
+					}
+				}
+				if (bFound && m_eMipFilter != CMipmap::kFilterNone)
+				{
+					generateMipmap(*itTexture, vLevel, it->m_face, image.RGBA, vFaceMipmap);
+				}
+			}
+			if (bFound)
+			{
+				vImage.push_back(image);
+			}
+			else if (it->m_level < vFaceMipmap.size())
+			{
+				image.RGBA.swap(vFaceMipmap[it->m_level]);
+				vMipmap.push_back(image);
+			}
+			else
+			{
+				vKeep.push_back(image);
+			}
+		}
+	}
+	if (vImage.empty())
+	{
+		return 0;
+	}
+	// fast path: the new images only use colours of the current palette, texels that still
+	// show the colour of their old index keep it so untouched areas stay byte-identical
+	map<u32, u8> mPaletteIndex;
+	for (u32 i = a_uColorCount; i > 0; i--)
+	{
+		u32 uColor = 0;
+		memcpy(&uColor, &vPalette[(i - 1) * 4], 4);
+		mPaletteIndex[uColor] = static_cast<u8>(i - 1);
+	}
+	bool bExact = true;
+	for (vector<SImage>::iterator it = vImage.begin(); bExact && it != vImage.end(); ++it)
+	{
+		const sce::Texture::Gxt::Data& data = m_vData[it->Texture];
+		vector<u8> vIndex;
+		getIndex(it->Texture, it->Level, vIndex);
+		for (u32 y = 0; bExact && y < data.m_height; y++)
+		{
+			for (u32 x = 0; x < data.m_width; x++)
+			{
+				u32 uPos = y * it->Level.m_widthEx + x;
+				const u8* pPixel = &*it->RGBA.begin() + uPos * 4;
+				if (!it->Index.empty() && it->Index[uPos] < a_uColorCount && memcmp(&vPalette[it->Index[uPos] * 4], pPixel, 4) == 0)
+				{
+					it->Changed = it->Changed || vIndex[uPos] != it->Index[uPos];
+					vIndex[uPos] = it->Index[uPos];
+					continue;
+				}
+				if (memcmp(&vPalette[vIndex[uPos] * 4], pPixel, 4) == 0)
+				{
+					continue;
+				}
+				u32 uColor = 0;
+				memcpy(&uColor, pPixel, 4);
+				map<u32, u8>::iterator itPaletteIndex = mPaletteIndex.find(uColor);
+				if (itPaletteIndex == mPaletteIndex.end())
+				{
+					bExact = false;
+					break;
+				}
+				it->Changed = true;
+				vIndex[uPos] = itPaletteIndex->second;
+			}
+		}
+		it->Index.swap(vIndex);
+	}
+	vector<u8> vNewPalette = vPalette;
+	set<pair<u32, u32>> sChangedFace;
+	if (bExact)
+	{
+		for (vector<SImage>::iterator it = vImage.begin(); it != vImage.end(); ++it)
+		{
+			setIndex(it->Texture, it->Level, it->Index, a_pGxt);
+			if (it->Changed)
+			{
+				sChangedFace.insert(make_pair(it->Texture, it->Level.m_face));
+			}
+		}
+	}
+	else
+	{
+		// histogram of the new images and of the untouched top levels
+		map<u32, u32> mColorCount;
+		for (vector<SImage>::iterator it = vImage.begin(); it != vImage.end(); ++it)
+		{
+			const sce::Texture::Gxt::Data& data = m_vData[it->Texture];
+			for (u32 y = 0; y < data.m_height; y++)
+			{
+				for (u32 x = 0; x < data.m_width; x++)
+				{
+					u32 uColor = 0;
+					memcpy(&uColor, &*it->RGBA.begin() + (y * it->Level.m_widthEx + x) * 4, 4);
+					mColorCount[uColor]++;
+				}
+			}
+		}
+		for (vector<SImage>::iterator it = vKeep.begin(); it != vKeep.end(); ++it)
+		{
+			if (it->Level.m_level != 0)
+			{
+				continue;
+			}
+			vector<u8> vIndex;
+			getIndex(it->Texture, it->Level, vIndex);
+			const sce::Texture::Gxt::Data& data = m_vData[it->Texture];
+			for (u32 y = 0; y < data.m_height; y++)
+			{
+				for (u32 x = 0; x < data.m_width; x++)
+				{
+					u32 uColor = 0;
+					memcpy(&uColor, &vPalette[vIndex[y * it->Level.m_widthEx + x] * 4], 4);
+					mColorCount[uColor]++;
+				}
+			}
+		}
+		vector<u32> vColor;
+		vector<u32> vCount;
+		for (map<u32, u32>::iterator it = mColorCount.begin(); it != mColorCount.end(); ++it)
+		{
+			vColor.push_back(it->first);
+			vCount.push_back(it->second);
+		}
+		CQuantizer::GeneratePalette(vColor, vCount, a_uColorCount, &*vNewPalette.begin());
+		// an exact palette needs no dithering
+		CQuantizer::EDither eDither = vColor.size() <= a_uColorCount ? CQuantizer::kDitherNone : m_eDither;
+		for (vector<SImage>::iterator it = vImage.begin(); it != vImage.end(); ++it)
+		{
+			vector<u8> vIndex(it->Level.m_widthEx * it->Level.m_heightEx);
+			CQuantizer::Map(&*it->RGBA.begin(), it->Level.m_widthEx, it->Level.m_heightEx, &*vNewPalette.begin(), a_uColorCount, eDither, &*vIndex.begin());
+			setIndex(it->Texture, it->Level, vIndex, a_pGxt);
+		}
+		if (vNewPalette != vPalette)
+		{
+			// levels without a new image keep their colours under the new palette
+			vector<u8> vRemap(a_uColorCount);
+			for (u32 i = 0; i < a_uColorCount; i++)
+			{
+				vRemap[i] = static_cast<u8>(CQuantizer::FindNearest(&*vNewPalette.begin(), a_uColorCount, vPalette[i * 4], vPalette[i * 4 + 1], vPalette[i * 4 + 2], vPalette[i * 4 + 3]));
+			}
+			for (vector<SImage>::iterator it = vKeep.begin(); it != vKeep.end(); ++it)
+			{
+				vector<u8> vIndex;
+				getIndex(it->Texture, it->Level, vIndex);
+				for (vector<u8>::iterator itIndex = vIndex.begin(); itIndex != vIndex.end(); ++itIndex)
+				{
+					*itIndex = vRemap[*itIndex];
+				}
+				setIndex(it->Texture, it->Level, vIndex, a_pGxt);
+			}
+			for (u32 i = 0; i < a_uColorCount; i++)
+			{
+				for (n32 j = 0; j < 4; j++)
+				{
+					a_pPalette[i * 4 + j] = vNewPalette[i * 4 + nOrder[j]];
+				}
+			}
+			memcpy(a_pGxt + a_uPaletteOffset, a_pPalette, a_uColorCount * 4);
+		}
+	}
+	for (vector<SImage>::iterator it = vMipmap.begin(); it != vMipmap.end(); ++it)
+	{
+		vector<u8> vIndex(it->Level.m_widthEx * it->Level.m_heightEx);
+		if (bExact)
+		{
+			// the fast path never dithers: a face whose indices did not change keeps its mipmaps,
+			// the others take the palette index of every exact colour and the nearest one otherwise
+			if (sChangedFace.find(make_pair(it->Texture, it->Level.m_face)) == sChangedFace.end())
+			{
+				continue;
+			}
+			CQuantizer::Map(&*it->RGBA.begin(), it->Level.m_widthEx, it->Level.m_heightEx, &*vNewPalette.begin(), a_uColorCount, CQuantizer::kDitherNone, &*vIndex.begin());
+			for (u32 i = 0; i < static_cast<u32>(vIndex.size()); i++)
+			{
+				u32 uColor = 0;
+				memcpy(&uColor, &*it->RGBA.begin() + i * 4, 4);
+				map<u32, u8>::iterator itPaletteIndex = mPaletteIndex.find(uColor);
+				if (itPaletteIndex != mPaletteIndex.end())
+				{
+					vIndex[i] = itPaletteIndex->second;
+				}
+			}
+		}
+		else
+		{
+			CQuantizer::Map(&*it->RGBA.begin(), it->Level.m_widthEx, it->Level.m_heightEx, &*vNewPalette.begin(), a_uColorCount, m_eDither, &*vIndex.begin());
+		}
+		setIndex(it->Texture, it->Level, vIndex, a_pGxt);
+	}
+	if (m_EncodeCache.IsEnabled())
+	{
+		vector<u8> vCache(a_pPalette, a_pPalette + a_uColorCount * 4);
+		for (vector<u32>::const_iterator it = a_vTexture.begin(); it != a_vTexture.end(); ++it)
+		{
+			vCache.insert(vCache.end(), m_vData[*it].m_data.begin(), m_vData[*it].m_data.end());
+		}
+		m_EncodeCache.Store(key, vCache);
+	}
+	if (m_bIncremental)
+	{
+		for (u32 i = 0; i < static_cast<u32>(a_vTexture.size()); i++)
+		{
+			updateManifest(a_vTexture[i], vPngHash[i]);
+		}
+	}
+	return 1;
+}
+
+// byte j of a stored palette entry is channel a_pOrder[j] of the rgba colour, the 1 variants read alpha as 0xff
+bool CGxt::getPaletteOrder(SceGxmTextureFormat a_eFormat, n32* a_pOrder, bool& a_bOpaque)
+{
+	for (n32 i = 0; i < 4; i++)
+	{
+		a_pOrder[i] = i;
+	}
+	switch (a_eFormat)
+	{
+	case SCE_GXM_TEXTURE_FORMAT_P4_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_P4_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_P8_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_P8_1BGR:
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_P4_ARGB:
+	case SCE_GXM_TEXTURE_FORMAT_P4_1RGB:
+	case SCE_GXM_TEXTURE_FORMAT_P8_ARGB:
+	case SCE_GXM_TEXTURE_FORMAT_P8_1RGB:
+		a_pOrder[0] = 2;
+		a_pOrder[2] = 0;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_P4_RGBA:
+	case SCE_GXM_TEXTURE_FORMAT_P4_RGB1:
+	case SCE_GXM_TEXTURE_FORMAT_P8_RGBA:
+	case SCE_GXM_TEXTURE_FORMAT_P8_RGB1:
+		a_pOrder[0] = 3;
+		a_pOrder[1] = 2;
+		a_pOrder[2] = 1;
+		a_pOrder[3] = 0;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_P4_BGRA:
+	case SCE_GXM_TEXTURE_FORMAT_P4_BGR1:
+	case SCE_GXM_TEXTURE_FORMAT_P8_BGRA:
+	case SCE_GXM_TEXTURE_FORMAT_P8_BGR1:
+		a_pOrder[0] = 3;
+		a_pOrder[1] = 0;
+		a_pOrder[2] = 1;
+		a_pOrder[3] = 2;
+		break;
+	default:
+		Report(Format(USTR("ERROR: unsupported palette format %08X\n\n"), a_eFormat));
+		return false;
+	}
+	// the 1 swizzles are the other ones with this bit set
+	a_bOpaque = (a_eFormat & SCE_GXM_TEXTURE_SWIZZLE4_1BGR) != 0;
+	return true;
+}
+
+bool CGxt::getBlockFormat(SceGxmTextureFormat a_eFormat, CBlockFile::EFormat& a_eBlockFormat)
+{
+	switch (sce::Texture::Gxt::getBaseFormat(a_eFormat))
+	{
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
+		a_eBlockFormat = CBlockFile::kFormatBC1;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC2:
+		a_eBlockFormat = CBlockFile::kFormatBC2;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC3:
+		a_eBlockFormat = CBlockFile::kFormatBC3;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC4:
+		a_eBlockFormat = CBlockFile::kFormatBC4;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_SBC4:
+		a_eBlockFormat = CBlockFile::kFormatBC4S;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC5:
+		a_eBlockFormat = CBlockFile::kFormatBC5;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_SBC5:
+		a_eBlockFormat = CBlockFile::kFormatBC5S;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
+		a_eBlockFormat = a_eFormat == SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_1BGR ? CBlockFile::kFormatPvrtc2RGB : CBlockFile::kFormatPvrtc2RGBA;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
+		a_eBlockFormat = a_eFormat == SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_1BGR ? CBlockFile::kFormatPvrtc4RGB : CBlockFile::kFormatPvrtc4RGBA;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
+		a_eBlockFormat = CBlockFile::kFormatPvrtcII2;
+		return true;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
+		a_eBlockFormat = CBlockFile::kFormatPvrtcII4;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// single and dual channel formats that show as gray, or gray and alpha, are exported as gray pngs, unsigned
+// channels keep their stored value, signed ones get their top bit flipped so that zero ends up at mid gray
+bool CGxt::getGrayLayout(SceGxmTextureFormat a_eFormat, u32& a_uChannelCount, n32& a_nBitDepth, bool& a_bSigned)
+{
+	a_uChannelCount = 1;
+	a_nBitDepth = 8;
+	a_bSigned = false;
+	switch (sce::Texture::Gxt::getBaseFormat(a_eFormat))
+	{
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC4:
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_S8:
+		a_bSigned = true;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U16:
+		a_nBitDepth = 16;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_S16:
+		a_nBitDepth = 16;
+		a_bSigned = true;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8:
+		a_uChannelCount = 2;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_S8S8:
+		a_uChannelCount = 2;
+		a_bSigned = true;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U16U16:
+		a_uChannelCount = 2;
+		a_nBitDepth = 16;
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_S16S16:
+		a_uChannelCount = 2;
+		a_nBitDepth = 16;
+		a_bSigned = true;
+		break;
+	default:
+		return false;
+	}
+	// the other swizzles drop, replace or move channels, they go through rgba
+	u32 uSwizzle = a_eFormat & ~SCE_GXM_TEXTURE_BASE_FORMAT_MASK;
+	if (a_uChannelCount == 1)
+	{
+		return uSwizzle == SCE_GXM_TEXTURE_SWIZZLE1_R || uSwizzle == SCE_GXM_TEXTURE_SWIZZLE1_1RRR;
+	}
+	return uSwizzle == SCE_GXM_TEXTURE_SWIZZLE2_GR || uSwizzle == SCE_GXM_TEXTURE_SWIZZLE2_GRRR;
+}
+
+// R is stored first, so U8U8 and U16U16 rows are already gray and alpha pairs
+void CGxt::getGray(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vGray) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uChannelCount = 1;
+	n32 nBitDepth = 8;
+	bool bSigned = false;
+	getGrayLayout(data.m_format, uChannelCount, nBitDepth, bSigned);
+	vector<u8> vLinear(a_Level.m_size);
+	loadLinear(a_uIndex, a_Level, &*vLinear.begin());
+	if (sce::Texture::Gxt::getBaseFormat(data.m_format) == SCE_GXM_TEXTURE_BASE_FORMAT_UBC4)
+	{
+		a_vGray.resize(a_Level.m_widthEx * a_Level.m_heightEx);
+		decodeBC4(&*vLinear.begin(), a_Level.m_widthEx, a_Level.m_heightEx, &*a_vGray.begin());
+		return;
+	}
+	a_vGray.swap(vLinear);
+	// signed values are biased to unsigned so that zero ends up at mid gray
+	if (bSigned)
+	{
+		u32 uSampleSize = nBitDepth / 8;
+		for (u32 i = uSampleSize - 1; i < static_cast<u32>(a_vGray.size()); i += uSampleSize)
+		{
+			a_vGray[i] ^= 0x80;
+		}
+	}
+}
+
+void CGxt::decodeBC4(const u8* a_pBlock, u32 a_uWidth, u32 a_uHeight, u8* a_pGray)
+{
+	for (u32 uBlockY = 0; uBlockY < a_uHeight / 4; uBlockY++)
+	{
+		for (u32 uBlockX = 0; uBlockX < a_uWidth / 4; uBlockX++)
 		{
-			SceGxtTextureInfo& sceGxtTextureInfo = pSceGxtTextureInfo[i];
-			sce::Texture::Gxt::Data data;
-			data.m_format = static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format);
-			data.m_type = static_cast<SceGxmTextureType>(sceGxtTextureInfo.type);
-			data.m_width = sceGxtTextureInfo.width;
-			data.m_height = sceGxtTextureInfo.height;
-			data.m_numLevels = sceGxtTextureInfo.mipCount;
-			data.m_borderSize = 0;
-			u32 uNumFaces = sceGxtTextureInfo.type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
-			u32 uTextureDataSize = 0;
-			if (!sce::Texture::Gxt::getTextureDataSize(uTextureDataSize, data.m_width, data.m_height, sceGxtTextureInfo.mipCount, uNumFaces, static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format), static_cast<SceGxmTextureType>(sceGxtTextureInfo.type)))
-			{
-				bResult = false;
-				break;
-			}
-			data.m_totalSize = data.m_borderSize + uTextureDataSize;
-			u32 uTexDataOffset = sceGxtTextureInfo.dataOffset;
-			if ((sceGxtTextureInfo.flags & SCE_GXT_TEXTURE_FLAG_HAS_BORDER_DATA) != 0)
-			{
-				u32 uBorderDataSize = 0;
-				if (!sce::Texture::Gxt::getBorderDataSize(uBorderDataSize, sceGxtTextureInfo.width, sceGxtTextureInfo.height, static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format)))
-				{
-					bResult = false;
-					break;
-				}
-				uTexDataOffset += uBorderDataSize;
-			}
-			if (uTexDataOffset + data.m_totalSize > uDataEnd)
-			{
-				bResult = false;
-				UPrintf(USTR("ERROR: data size is too small\n\n"));
-				break;
-			}
-			data.m_data.resize(data.m_totalSize);
-			data.m_palette16 = nullptr;
-			data.m_palette256 = nullptr;
-			memcpy(&*data.m_data.begin(), pGxt + uTexDataOffset, data.m_totalSize);
-			if (sce::Texture::Gxt::isIndexed(static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format)))
+			const u8* pBlock = a_pBlock + (uBlockY * (a_uWidth / 4) + uBlockX) * 8;
+			u32 uValue[8] = { pBlock[0], pBlock[1] };
+			for (u32 i = 2; i < 8; i++)
 			{
-				if (sceGxtTextureInfo.paletteIndex == UINT32_MAX)
-				{
-					bResult = false;
-					UPrintf(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
-					break;
-				}
-				u32 uBpp = 0;
-				if (!sce::Texture::Gxt::getBpp(uBpp, static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format)))
+				if (uValue[0] > uValue[1])
 				{
-					bResult = false;
-					break;
+					uValue[i] = (uValue[0] * (8 - i) + uValue[1] * (i - 1)) / 7;
 				}
-				switch (uBpp)
+				else if (i < 6)
 				{
-				case 4:
-					if (sceGxtTextureInfo.paletteIndex >= pSceGxtHeader->numP4Palettes)
-					{
-						bResult = false;
-						UPrintf(USTR("ERROR: palette16 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
-						break;
-					}
-					data.m_palette16 = &*(m_vPalette16.begin() + sceGxtTextureInfo.paletteIndex);
-					break;
-				case 8:
-					if (sceGxtTextureInfo.paletteIndex >= pSceGxtHeader->numP8Palettes)
-					{
-						bResult = false;
-						UPrintf(USTR("ERROR: palette256 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
-						break;
-					}
-					data.m_palette256 = &*(m_vPalette256.begin() + sceGxtTextureInfo.paletteIndex);
-					break;
+					uValue[i] = (uValue[0] * (6 - i) + uValue[1] * (i - 1)) / 5;
 				}
-				if (!bResult)
+				else
 				{
-					break;
+					uValue[i] = i == 6 ? 0 : 0xFF;
 				}
 			}
-			else
+			u64 uIndex = 0;
+			for (n32 i = 0; i < 6; i++)
 			{
-				if (sceGxtTextureInfo.paletteIndex != UINT32_MAX)
-				{
-					bResult = false;
-					UPrintf(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
-					break;
-				}
+				uIndex |= static_cast<u64>(pBlock[2 + i]) << (i * 8);
+			}
+			for (u32 i = 0; i < 16; i++)
+			{
+				a_pGray[(uBlockY * 4 + i / 4) * a_uWidth + uBlockX * 4 + i % 4] = static_cast<u8>(uValue[uIndex >> (i * 3) & 7]);
 			}
-			m_vData.push_back(data);
 		}
-		if (!bResult)
+	}
+}
+
+void CGxt::addKey(CEncodeCache::CKeyBuilder& a_KeyBuilder, u32 a_uIndex) const
+{
+	const sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	a_KeyBuilder.Add(data.m_format);
+	a_KeyBuilder.Add(data.m_type);
+	a_KeyBuilder.Add(data.m_width);
+	a_KeyBuilder.Add(data.m_height);
+	a_KeyBuilder.Add(data.m_numLevels);
+	a_KeyBuilder.Add(m_eMipFilter);
+	// levels without a png keep their old data, so the old data is part of the result
+	a_KeyBuilder.Add(&*data.m_data.begin(), data.m_data.size());
+}
+
+void CGxt::storeData(u32 a_uIndex, const u8* a_pData, u8* a_pGxt)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	memcpy(&*data.m_data.begin(), a_pData, data.m_data.size());
+	memcpy(a_pGxt + m_vTextureDataOffset[a_uIndex], a_pData, data.m_data.size());
+}
+
+void CGxt::getIndex(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vIndex) const
+{
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, m_vData[a_uIndex].m_format);
+	vector<u8> vLinear(a_Level.m_size);
+	loadLinear(a_uIndex, a_Level, &*vLinear.begin());
+	a_vIndex.resize(a_Level.m_widthEx * a_Level.m_heightEx);
+	for (u32 i = 0; i < static_cast<u32>(a_vIndex.size()); i++)
+	{
+		a_vIndex[i] = uBpp == 4 ? (vLinear[i / 2] >> (i % 2 * 4) & 0xF) : vLinear[i];
+	}
+}
+
+void CGxt::setIndex(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, u8* a_pGxt)
+{
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, m_vData[a_uIndex].m_format);
+	vector<u8> vLinear(a_Level.m_size, 0);
+	for (u32 i = 0; i < static_cast<u32>(a_vIndex.size()); i++)
+	{
+		if (uBpp == 4)
 		{
-			break;
+			vLinear[i / 2] |= (a_vIndex[i] & 0xF) << (i % 2 * 4);
 		}
-	} while (false);
+		else
+		{
+			vLinear[i] = a_vIndex[i];
+		}
+	}
+	storeLevel(a_uIndex, a_Level, &*vLinear.begin(), a_pGxt);
+}
+
+bool CGxt::TestPalette()
+{
+	FILE* fp = UFopen(m_sFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	u32 uGxtSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	u8* pGxt = new u8[uGxtSize];
+	fread(pGxt, 1, uGxtSize, fp);
+	fclose(fp);
+	const SceGxtHeader* pSceGxtHeader = reinterpret_cast<const SceGxtHeader*>(pGxt);
+	if (sce::Texture::Gxt::isValidInput(pGxt, uGxtSize) && pSceGxtHeader->numP4Palettes + pSceGxtHeader->numP8Palettes == 0)
+	{
+		delete[] pGxt;
+		Report(USTR("WARN: no palette\n\n"));
+		return true;
+	}
+	bool bResult = parse(pGxt, uGxtSize);
 	delete[] pGxt;
-	if (bResult)
+	n32 nNumTextures = 0;
+	for (u32 i = 0; i < static_cast<u32>(m_vData.size()); i++)
 	{
-		UMkdir(m_sDirName.c_str());
-		for (u32 i = 0; i < static_cast<u32>(m_vData.size()); i++)
+		if (sce::Texture::Gxt::isIndexed(m_vData[i].m_format))
 		{
-			sce::Texture::Gxt::Data& data = m_vData[i];
-			u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
-			u32 uOffset = 0;
-			u32 uBpp = 0;
-			if (!sce::Texture::Gxt::getBpp(uBpp, data.m_format))
+			nNumTextures++;
+		}
+	}
+	if (!bResult || nNumTextures == 0)
+	{
+		return bResult;
+	}
+	UMkdir(m_sDirName.c_str());
+	UString sRankFileName = m_sDirName + USTR("/") + s_sPaletteRankFileName;
+	fp = UFopen(sRankFileName.c_str(), USTR("wb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	if (m_bVerbose)
+	{
+		UPrintf(USTR("save: %") PRIUS USTR("\n"), sRankFileName.c_str());
+	}
+	fprintf(fp, "# texture rank palette score identical_palettes, a lower score is a smoother image\n");
+	// the banks map every palette to the first one with the same colours
+	vector<u32> vPalette16Bank;
+	vector<u32> vPalette256Bank;
+	if (!m_vPalette16.empty())
+	{
+		buildPaletteBank(m_vPalette16.front().m_data, static_cast<u32>(m_vPalette16.size()), sizeof(sce::Texture::Gxt::Palette16), vPalette16Bank);
+	}
+	if (!m_vPalette256.empty())
+	{
+		buildPaletteBank(m_vPalette256.front().m_data, static_cast<u32>(m_vPalette256.size()), sizeof(sce::Texture::Gxt::Palette256), vPalette256Bank);
+	}
+	for (u32 i = 0; i < static_cast<u32>(m_vData.size()) && bResult; i++)
+	{
+		sce::Texture::Gxt::Data& data = m_vData[i];
+		u32 uBpp = 0;
+		if (!sce::Texture::Gxt::isIndexed(data.m_format) || !sce::Texture::Gxt::getBpp(uBpp, data.m_format))
+		{
+			continue;
+		}
+		// getTestPalette reads every candidate in this order
+		n32 nOrder[4] = {};
+		bool bOpaque = false;
+		if (!getPaletteOrder(data.m_format, nOrder, bOpaque))
+		{
+			bResult = false;
+			break;
+		}
+		u32 uColorCount = uBpp == 4 ? 16 : 256;
+		// identical palettes are tried once and listed with the palette that stands for them
+		const vector<u32>& vBank = uBpp == 4 ? vPalette16Bank : vPalette256Bank;
+		vector<u32> vCandidate;
+		vector<vector<u32>> vIdentical(vBank.size());
+		for (u32 j = 0; j < static_cast<u32>(vBank.size()); j++)
+		{
+			if (vBank[j] == j)
 			{
-				bResult = false;
-				break;
+				vCandidate.push_back(j);
 			}
-			u32 uFaceAlignment = (uNumFaces > 1 && data.m_numLevels > 1) ? sce::Texture::Gxt::getFaceAlignment(uBpp, data.m_width) : 1;
-			if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
+			else
 			{
-				u32 uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
-				u32 uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
-				for (u32 j = 0; j < uNumFaces; j++)
-				{
-					u32 uFaceOffset = uOffset;
-					u32 uMipWidth = std::max<u32>(data.m_width, uBlockWidth);
-					u32 uMipHeight = std::max<u32>(data.m_height, uBlockHeight);
-					u32 uMipWidthEx = sce::Texture::enclosingPowerOf2(uMipWidth);
-					u32 uMipHeightEx = sce::Texture::enclosingPowerOf2(uMipHeight);
-					for (u32 k = 0; k < data.m_numLevels; k++)
-					{
-						u32 uMipWidthBlocks = (uMipWidth + uBlockWidth - 1) / uBlockWidth;
-						u32 uMipHeightBlocks = (uMipHeight + uBlockHeight - 1) / uBlockHeight;
-						if (k == 0)
-						{
-							u8* pLinear = new u8[uMipWidthEx * uMipHeightEx * uBpp / 8];
-							if (!sce::Texture::Gxt::isPvr(data.m_format) && (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE))
-							{
-								sce::Texture::deSwizzleLevel(pLinear, &*data.m_data.begin() + uOffset, uMipWidthBlocks, uMipHeightBlocks, uBpp * uBlockWidth * uBlockHeight);
-							}
-							else
-							{
-								memcpy(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx * uMipHeightEx * uBpp / 8);
-							}
-							pvrtexture::CPVRTexture* pPVRTexture = nullptr;
-							if (decode(&data, pLinear, uMipWidthEx, uMipHeightEx, uBpp, &pPVRTexture) == 0)
-							{
-								UString sPngFileName = Format(USTR("%") PRIUS USTR("/%d_%d.png"), m_sDirName.c_str(), i, j);
-								FILE* fpSub = UFopen(sPngFileName.c_str(), USTR("wb"));
-								if (fpSub == nullptr)
-								{
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									break;
-								}
-								if (m_bVerbose)
-								{
-									UPrintf(USTR("save: %") PRIUS USTR("\n"), sPngFileName.c_str());
-								}
-								png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-								if (pPng == nullptr)
-								{
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: png_create_write_struct error\n\n"));
-									break;
-								}
-								png_infop pInfo = png_create_info_struct(pPng);
-								if (pInfo == nullptr)
-								{
-									png_destroy_write_struct(&pPng, nullptr);
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: png_create_info_struct error\n\n"));
-									break;
-								}
-								if (setjmp(png_jmpbuf(pPng)) != 0)
-								{
-									png_destroy_write_struct(&pPng, &pInfo);
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: setjmp error\n\n"));
-									break;
-								}
-								png_init_io(pPng, fpSub);
-								png_set_IHDR(pPng, pInfo, data.m_width, data.m_height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-								u8* pData = static_cast<u8*>(pPVRTexture->getDataPtr());
-								png_bytepp pRowPointers = new png_bytep[data.m_height];
-								for (u32 l = 0; l < data.m_height; l++)
-								{
-									pRowPointers[l] = pData + l * uMipWidthEx * 4;
-								}
-								png_set_rows(pPng, pInfo, pRowPointers);
-								png_write_png(pPng, pInfo, PNG_TRANSFORM_IDENTITY, nullptr);
-								png_destroy_write_struct(&pPng, &pInfo);
-								delete[] pRowPointers;
-								fclose(fpSub);
-								delete pPVRTexture;
-								delete[] pLinear;
-							}
-							else
-							{
-								delete[] pLinear;
-								bResult = false;
-								UPrintf(USTR("ERROR: decode error\n\n"));
-								break;
-							}
-						}
-						u32 uLevelSizeSrc = (uBpp * uMipWidthEx * uMipHeightEx) / 8;
-						uOffset += uLevelSizeSrc;
-						uMipWidth = uMipWidth > uBlockWidth ? uMipWidth / 2 : uBlockWidth;
-						uMipHeight = uMipHeight > uBlockHeight ? uMipHeight / 2 : uBlockHeight;
-						uMipWidthEx = uMipWidthEx > uBlockWidth ? uMipWidthEx / 2 : uBlockWidth;
-						uMipHeightEx = uMipHeightEx > uBlockHeight ? uMipHeightEx / 2 : uBlockHeight;
-					}
-					if (i < uNumFaces - 1)
-					{
-						uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
-					}
-				}
+				vIdentical[vBank[j]].push_back(j);
 			}
-			else
+		}
+		u32 uPaletteCount = static_cast<u32>(vCandidate.size());
+		if (uPaletteCount == 0)
+		{
+			continue;
+		}
+		u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+		vector<sce::Texture::Gxt::Level> vLevel;
+		if (!sce::Texture::Gxt::getLevels(vLevel, data.m_width, data.m_height, data.m_numLevels, uNumFaces, data.m_format, data.m_type))
+		{
+			bResult = false;
+			break;
+		}
+		// the indices are deswizzled once, every palette is then scored on the index statistics alone
+		vector<sce::Texture::Gxt::Level> vFace;
+		vector<vector<u8>> vFaceIndex;
+		vector<f64> vUsage(uColorCount);
+		vector<f64> vPair(uColorCount * uColorCount);
+		for (vector<sce::Texture::Gxt::Level>::iterator it = vLevel.begin(); it != vLevel.end(); ++it)
+		{
+			if (it->m_level == 0)
 			{
-				u32 uWidthAlignment = data.m_type == SCE_GXM_TEXTURE_LINEAR ? SCE_GXM_TEXTURE_IMPLICIT_STRIDE_ALIGNMENT : 1;
-				for (u32 j = 0; j < uNumFaces; j++)
-				{
-					u32 uFaceOffset = uOffset;
-					u32 uMipWidth = data.m_width;
-					u32 uMipHeight = data.m_height;
-					u32 uMipWidthEx = data.m_numLevels > 1 ? sce::Texture::enclosingPowerOf2(data.m_width) : data.m_width;
-					u32 uMipHeightEx = data.m_numLevels > 1 ? sce::Texture::enclosingPowerOf2(data.m_height) : data.m_height;
-					uMipWidthEx = SCE_ALIGN(uMipWidthEx, uWidthAlignment);
-					for (u32 k = 0; k < data.m_numLevels; k++)
-					{
-						if (k == 0)
-						{
-							u8* pLinear = new u8[uMipWidthEx * uMipHeightEx * uBpp / 8];
-							if (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE)
-							{
-								sce::Texture::deSwizzleLevel(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx, uMipHeightEx, uBpp);
-							}
-							else
-							{
-								memcpy(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx * uMipHeightEx * uBpp / 8);
-							}
-							pvrtexture::CPVRTexture* pPVRTexture = nullptr;
-							if (decode(&data, pLinear, uMipWidthEx, uMipHeightEx, uBpp, &pPVRTexture) == 0)
-							{
-								UString sPngFileName = Format(USTR("%") PRIUS USTR("/%d_%d.png"), m_sDirName.c_str(), i, j);
-								FILE* fpSub = UFopen(sPngFileName.c_str(), USTR("wb"));
-								if (fpSub == nullptr)
-								{
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									break;
-								}
-								if (m_bVerbose)
-								{
-									UPrintf(USTR("save: %") PRIUS USTR("\n"), sPngFileName.c_str());
-								}
-								png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-								if (pPng == nullptr)
-								{
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: png_create_write_struct error\n\n"));
-									break;
-								}
-								png_infop pInfo = png_create_info_struct(pPng);
-								if (pInfo == nullptr)
-								{
-									png_destroy_write_struct(&pPng, nullptr);
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: png_create_info_struct error\n\n"));
-									break;
-								}
-								if (setjmp(png_jmpbuf(pPng)) != 0)
-								{
-									png_destroy_write_struct(&pPng, &pInfo);
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: setjmp error\n\n"));
-									break;
-								}
-								png_init_io(pPng, fpSub);
-								png_set_IHDR(pPng, pInfo, data.m_width, data.m_height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-								u8* pData = static_cast<u8*>(pPVRTexture->getDataPtr());
-								png_bytepp pRowPointers = new png_bytep[data.m_height];
-								for (u32 l = 0; l < data.m_height; l++)
-								{
-									pRowPointers[l] = pData + l * uMipWidthEx * 4;
-								}
-								png_set_rows(pPng, pInfo, pRowPointers);
-								png_write_png(pPng, pInfo, PNG_TRANSFORM_IDENTITY, nullptr);
-								png_destroy_write_struct(&pPng, &pInfo);
-								delete[] pRowPointers;
-								fclose(fpSub);
-								delete pPVRTexture;
-								delete[] pLinear;
-							}
-							else
-							{
-								delete[] pLinear;
-								bResult = false;
-								UPrintf(USTR("ERROR: decode error\n\n"));
-								break;
-							}
-						}
-						uOffset += uMipHeightEx * ((uMipWidthEx * uBpp + 7) / 8);
-						uMipWidth = uMipWidth > 1 ? uMipWidth / 2 : 1;
-						uMipHeight = uMipHeight > 1 ? uMipHeight / 2 : 1;
-						uMipWidthEx = uMipWidthEx > 1 ? uMipWidthEx / 2 : 1;
-						uMipHeightEx = uMipHeightEx > 1 ? uMipHeightEx / 2 : 1;
-						uMipWidthEx = SCE_ALIGN(uMipWidthEx, uWidthAlignment);
-					}
-					if (j < uNumFaces - 1)
-					{
-						uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
-					}
-				}
-				if (!bResult)
+				vFace.push_back(*it);
+				vFaceIndex.resize(vFaceIndex.size() + 1);
+				getIndex(i, *it, vFaceIndex.back());
+				addIndexStatistics(vFaceIndex.back(), data.m_width, data.m_height, it->m_widthEx, uColorCount, vUsage, vPair);
+			}
+		}
+		// the statistics are shared read only, so every palette is scored on its own thread
+		vector<SPaletteScore> vScore(uPaletteCount);
+		CThreadPool::ParallelFor(uPaletteCount, [&](u32 a_uCandidate)
+		{
+			vector<u8> vPalette;
+			getTestPalette(i, vCandidate[a_uCandidate], vPalette);
+			vScore[a_uCandidate].Palette = vCandidate[a_uCandidate];
+			vScore[a_uCandidate].Score = scorePalette(&*vPalette.begin(), uColorCount, vUsage, vPair);
+		});
+		stable_sort(vScore.begin(), vScore.end(), [](const SPaletteScore& lhs, const SPaletteScore& rhs)
+		{
+			return lhs.Score < rhs.Score;
+		});
+		for (u32 j = 0; j < uPaletteCount; j++)
+		{
+			fprintf(fp, "%u %u %u %.6f", i, j, vScore[j].Palette, vScore[j].Score);
+			const vector<u32>& vSame = vIdentical[vScore[j].Palette];
+			for (vector<u32>::const_iterator it = vSame.begin(); it != vSame.end(); ++it)
+			{
+				fprintf(fp, "%s%u", it == vSame.begin() ? " " : ",", *it);
+			}
+			fprintf(fp, "\n");
+		}
+		if (m_bVerbose)
+		{
+			UPrintf(USTR("test: texture %u best palette %u score %.6f\n"), i, vScore[0].Palette, vScore[0].Score);
+		}
+		// only the best candidates are worth a png
+		u32 uTestCount = m_uTestTop == 0 ? uPaletteCount : std::min<u32>(m_uTestTop, uPaletteCount);
+		if (m_bTestSheet)
+		{
+			for (u32 j = 0; j < static_cast<u32>(vFace.size()) && bResult; j++)
+			{
+				bResult = writeTestSheet(i, vFace[j], vFaceIndex[j], vScore, uTestCount);
+			}
+		}
+		else
+		{
+			u32 uFaceCount = static_cast<u32>(vFace.size());
+			vector<u8> vResult(uTestCount * uFaceCount, 0);
+			CThreadPool::ParallelFor(static_cast<u32>(vResult.size()), [&](u32 a_uIndex)
+			{
+				u32 uFace = a_uIndex % uFaceCount;
+				vResult[a_uIndex] = writeTestPalette(i, vFace[uFace], vFaceIndex[uFace], vScore[a_uIndex / uFaceCount].Palette) ? 1 : 0;
+			});
+			for (vector<u8>::iterator it = vResult.begin(); it != vResult.end(); ++it)
+			{
+				if (*it == 0)
 				{
-					break;
+					bResult = false;
 				}
 			}
 		}
 	}
-	return bResult;
+	fclose(fp);
+	return bResult;
+}
+
+// counts how often each index is used and how often two indices are neighbours
+void CGxt::addIndexStatistics(const vector<u8>& a_vIndex, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u32 a_uColorCount, vector<f64>& a_vUsage, vector<f64>& a_vPair)
+{
+	for (u32 y = 0; y < a_uHeight; y++)
+	{
+		const u8* pRow = &*a_vIndex.begin() + y * a_uStride;
+		for (u32 x = 0; x < a_uWidth; x++)
+		{
+			a_vUsage[pRow[x]] += 1;
+			if (x + 1 < a_uWidth)
+			{
+				a_vPair[pRow[x] * a_uColorCount + pRow[x + 1]] += 1;
+			}
+			if (y + 1 < a_uHeight)
+			{
+				a_vPair[pRow[x] * a_uColorCount + pRow[x + a_uStride]] += 1;
+			}
+		}
+	}
+}
+
+// the mean colour distance of neighbours relative to the mean distance of two random pixels,
+// the right palette makes neighbours much closer than random pixels, a flat image scores 1
+f64 CGxt::scorePalette(const u8* a_pPalette, u32 a_uColorCount, const vector<f64>& a_vUsage, const vector<f64>& a_vPair)
+{
+	vector<n32> vColor(a_uColorCount * 4);
+	vector<u32> vUsed;
+	for (u32 i = 0; i < a_uColorCount; i++)
+	{
+		// transparent colours are compared premultiplied, their rgb is invisible
+		for (n32 j = 0; j < 3; j++)
+		{
+			vColor[i * 4 + j] = a_pPalette[i * 4 + j] * a_pPalette[i * 4 + 3] / 255;
+		}
+		vColor[i * 4 + 3] = a_pPalette[i * 4 + 3];
+		if (a_vUsage[i] != 0)
+		{
+			vUsed.push_back(i);
+		}
+	}
+	f64 fNeighbour = 0;
+	f64 fRandom = 0;
+	f64 fPairCount = 0;
+	f64 fPixelCount = 0;
+	for (vector<u32>::iterator itA = vUsed.begin(); itA != vUsed.end(); ++itA)
+	{
+		const n32* pA = &*vColor.begin() + *itA * 4;
+		fPixelCount += a_vUsage[*itA];
+		for (vector<u32>::iterator itB = vUsed.begin(); itB != vUsed.end(); ++itB)
+		{
+			const n32* pB = &*vColor.begin() + *itB * 4;
+			n32 nDistance = abs(pA[0] - pB[0]) + abs(pA[1] - pB[1]) + abs(pA[2] - pB[2]) + abs(pA[3] - pB[3]);
+			f64 fPair = a_vPair[*itA * a_uColorCount + *itB];
+			fPairCount += fPair;
+			fNeighbour += fPair * nDistance;
+			fRandom += a_vUsage[*itA] * a_vUsage[*itB] * nDistance;
+		}
+	}
+	if (fPairCount == 0 || fRandom == 0)
+	{
+		return 1;
+	}
+	return (fNeighbour / fPairCount) / (fRandom / (fPixelCount * fPixelCount));
 }
 
-bool CGxt::ImportFile()
+// palette a_uPalette of the pool texture a_uIndex indexes into, as rgba in the order of its format
+void CGxt::getTestPalette(u32 a_uIndex, u32 a_uPalette, vector<u8>& a_vPalette) const
 {
-	return false;
+	u32 uBpp = 0;
+	sce::Texture::Gxt::getBpp(uBpp, m_vData[a_uIndex].m_format);
+	u32 uColorCount = uBpp == 4 ? 16 : 256;
+	const u8* pPalette = uBpp == 4 ? m_vPalette16[a_uPalette].m_data : m_vPalette256[a_uPalette].m_data;
+	// the callers have checked the format
+	n32 nOrder[4] = {};
+	bool bOpaque = false;
+	getPaletteOrder(m_vData[a_uIndex].m_format, nOrder, bOpaque);
+	a_vPalette.resize(uColorCount * 4);
+	for (u32 i = 0; i < uColorCount; i++)
+	{
+		for (n32 j = 0; j < 4; j++)
+		{
+			a_vPalette[i * 4 + nOrder[j]] = pPalette[i * 4 + j];
+		}
+		if (bOpaque)
+		{
+			a_vPalette[i * 4 + 3] = 0xFF;
+		}
+	}
 }
 
-bool CGxt::TestPalette()
+bool CGxt::writeTestPalette(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, u32 a_uPalette)
 {
-	bool bResult = true;
-	FILE* fp = UFopen(m_sFileName.c_str(), USTR("rb"));
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	vector<u8> vPalette;
+	getTestPalette(a_uIndex, a_uPalette, vPalette);
+	u32 uColorCount = static_cast<u32>(vPalette.size() / 4);
+	UString sPngFileName = Format(USTR("%") PRIUS USTR("/%d_%d_test_p%d.png"), m_sDirName.c_str(), a_uIndex, a_Level.m_face, a_uPalette);
+	FILE* fp = openOutput(sPngFileName);
 	if (fp == nullptr)
 	{
 		return false;
 	}
-	fseek(fp, 0, SEEK_END);
-	u32 uGxtSize = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-	u8* pGxt = new u8[uGxtSize];
-	fread(pGxt, 1, uGxtSize, fp);
-	fclose(fp);
-	SceGxtHeader* pSceGxtHeader = reinterpret_cast<SceGxtHeader*>(pGxt);
-	n32 nNumTextures = 0;
-	do
+	bool bResult = m_PngWriter.WriteIndexed(fp, &*a_vIndex.begin(), data.m_width, data.m_height, a_Level.m_widthEx, &*vPalette.begin(), uColorCount);
+	return closeOutput(fp, sPngFileName, bResult);
+}
+
+// the candidates in rank order, row by row, in one rgba image per face
+bool CGxt::writeTestSheet(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, const vector<SPaletteScore>& a_vScore, u32 a_uTestCount)
+{
+	sce::Texture::Gxt::Data& data = m_vData[a_uIndex];
+	u32 uColumnCount = 1;
+	while (uColumnCount * uColumnCount < a_uTestCount)
+	{
+		uColumnCount++;
+	}
+	u32 uRowCount = (a_uTestCount + uColumnCount - 1) / uColumnCount;
+	u32 uCellWidth = data.m_width + s_uTestSheetSpacing;
+	u32 uCellHeight = data.m_height + s_uTestSheetSpacing;
+	u32 uSheetWidth = uColumnCount * uCellWidth - s_uTestSheetSpacing;
+	u32 uSheetHeight = uRowCount * uCellHeight - s_uTestSheetSpacing;
+	vector<u8> vSheet(static_cast<size_t>(uSheetWidth) * uSheetHeight * 4, 0);
+	// every candidate fills its own cell
+	CThreadPool::ParallelFor(a_uTestCount, [&](u32 a_uRank)
 	{
-		if (!sce::Texture::Gxt::isValidInput(pGxt, uGxtSize))
+		vector<u8> vPalette;
+		getTestPalette(a_uIndex, a_vScore[a_uRank].Palette, vPalette);
+		for (u32 y = 0; y < data.m_height; y++)
 		{
-			bResult = false;
-			UPrintf(USTR("ERROR: unknown version %08X\n\n"), pSceGxtHeader->version);
-			break;
+			const u8* pIndex = &*a_vIndex.begin() + y * a_Level.m_widthEx;
+			u8* pCell = &*vSheet.begin() + ((static_cast<size_t>(a_uRank / uColumnCount) * uCellHeight + y) * uSheetWidth + a_uRank % uColumnCount * uCellWidth) * 4;
+			for (u32 x = 0; x < data.m_width; x++)
+			{
+				memcpy(pCell + x * 4, &*vPalette.begin() + pIndex[x] * 4, 4);
+			}
 		}
-		if (pSceGxtHeader->numP4Palettes + pSceGxtHeader->numP8Palettes == 0)
+	});
+	return writePng(Format(USTR("%") PRIUS USTR("/%d_%d_test_sheet.png"), m_sDirName.c_str(), a_uIndex, a_Level.m_face), &*vSheet.begin(), uSheetWidth, uSheetHeight, uSheetWidth * 4);
+}
+
+bool CGxt::parse(const u8* a_pGxt, u32 a_uGxtSize)
+{
+	bool bResult = true;
+	const SceGxtHeader* pSceGxtHeader = reinterpret_cast<const SceGxtHeader*>(a_pGxt);
+	do
+	{
+		if (!sce::Texture::Gxt::isValidInput(a_pGxt, a_uGxtSize))
 		{
-			UPrintf(USTR("WARN: no palette\n\n"));
+			bResult = false;
+			Report(Format(USTR("ERROR: unknown version %08X\n\n"), pSceGxtHeader->version));
 			break;
 		}
-		if (pSceGxtHeader->numP4Palettes * SCE_GXT_PALETTE_SIZE_P4 + pSceGxtHeader->numP8Palettes * SCE_GXT_PALETTE_SIZE_P8 > pSceGxtHeader->dataSize)
+		// the header is not trusted, every range is checked against the buffer in 64 bits
+		u64 uInfoEnd = sizeof(SceGxtHeader) + static_cast<u64>(pSceGxtHeader->numTextures) * sizeof(SceGxtTextureInfo);
+		u64 uFileDataEnd = static_cast<u64>(pSceGxtHeader->dataOffset) + pSceGxtHeader->dataSize;
+		u64 uPaletteSize = static_cast<u64>(pSceGxtHeader->numP4Palettes) * SCE_GXT_PALETTE_SIZE_P4 + static_cast<u64>(pSceGxtHeader->numP8Palettes) * SCE_GXT_PALETTE_SIZE_P8;
+		if (uInfoEnd > a_uGxtSize || uFileDataEnd > a_uGxtSize || uPaletteSize > pSceGxtHeader->dataSize)
 		{
 			bResult = false;
-			UPrintf(USTR("ERROR: data size is too small\n\n"));
+			Report(USTR("ERROR: data size is too small\n\n"));
 			break;
 		}
-		u32 uDataEnd = pSceGxtHeader->dataOffset + pSceGxtHeader->dataSize;
+		u32 uDataEnd = static_cast<u32>(uFileDataEnd);
 		u32 uPal256Offset = uDataEnd - pSceGxtHeader->numP8Palettes * SCE_GXT_PALETTE_SIZE_P8;
 		u32 uPal16Offset = uPal256Offset - pSceGxtHeader->numP4Palettes * SCE_GXT_PALETTE_SIZE_P4;
+		m_uPalette16Offset = uPal16Offset;
+		m_uPalette256Offset = uPal256Offset;
 		for (u32 i = 0; i < pSceGxtHeader->numP4Palettes; i++)
 		{
 			sce::Texture::Gxt::Palette16 palette16;
-			memcpy(palette16.m_data, pGxt + uPal16Offset + i * SCE_GXT_PALETTE_SIZE_P4, SCE_GXT_PALETTE_SIZE_P4);
+			memcpy(palette16.m_data, a_pGxt + uPal16Offset + i * SCE_GXT_PALETTE_SIZE_P4, SCE_GXT_PALETTE_SIZE_P4);
 			m_vPalette16.push_back(palette16);
 		}
 		for (u32 i = 0; i < pSceGxtHeader->numP8Palettes; i++)
 		{
 			sce::Texture::Gxt::Palette256 palette256;
-			memcpy(palette256.m_data, pGxt + uPal256Offset + i * SCE_GXT_PALETTE_SIZE_P8, SCE_GXT_PALETTE_SIZE_P8);
+			memcpy(palette256.m_data, a_pGxt + uPal256Offset + i * SCE_GXT_PALETTE_SIZE_P8, SCE_GXT_PALETTE_SIZE_P8);
 			m_vPalette256.push_back(palette256);
 		}
+		if (m_bVerbose)
+		{
+			vector<u32> vPalette16Bank;
+			vector<u32> vPalette256Bank;
+			buildPaletteBank(a_pGxt + uPal16Offset, pSceGxtHeader->numP4Palettes, SCE_GXT_PALETTE_SIZE_P4, vPalette16Bank);
+			buildPaletteBank(a_pGxt + uPal256Offset, pSceGxtHeader->numP8Palettes, SCE_GXT_PALETTE_SIZE_P8, vPalette256Bank);
+			UPrintf(USTR("palette: %u unique of %u p4, %u unique of %u p8\n"), countPaletteBank(vPalette16Bank), pSceGxtHeader->numP4Palettes, countPaletteBank(vPalette256Bank), pSceGxtHeader->numP8Palettes);
+		}
 		uDataEnd = uPal16Offset;
-		u32 uDataBegin = pSceGxtHeader->dataOffset;
-		if (uDataBegin + pSceGxtHeader->numTextures * sizeof(SceGxtTextureInfo) > uDataEnd)
+		if (pSceGxtHeader->dataOffset + static_cast<u64>(pSceGxtHeader->numTextures) * sizeof(SceGxtTextureInfo) > uDataEnd)
 		{
 			bResult = false;
-			UPrintf(USTR("ERROR: data size is too small\n\n"));
+			Report(USTR("ERROR: data size is too small\n\n"));
 			break;
 		}
-		uDataBegin += pSceGxtHeader->numTextures * sizeof(SceGxtTextureInfo);
-		SceGxtTextureInfo* pSceGxtTextureInfo = reinterpret_cast<SceGxtTextureInfo*>(pSceGxtHeader + 1);
+		const SceGxtTextureInfo* pSceGxtTextureInfo = reinterpret_cast<const SceGxtTextureInfo*>(pSceGxtHeader + 1);
 		for (u32 i = 0; i < pSceGxtHeader->numTextures; i++)
 		{
-			SceGxtTextureInfo& sceGxtTextureInfo = pSceGxtTextureInfo[i];
+			const SceGxtTextureInfo& sceGxtTextureInfo = pSceGxtTextureInfo[i];
 			sce::Texture::Gxt::Data data;
 			data.m_format = static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format);
 			data.m_type = static_cast<SceGxmTextureType>(sceGxtTextureInfo.type);
@@ -948,6 +3269,12 @@ bool CGxt::TestPalette()
 			data.m_height = sceGxtTextureInfo.height;
 			data.m_numLevels = sceGxtTextureInfo.mipCount;
 			data.m_borderSize = 0;
+			if (data.m_width == 0 || data.m_height == 0 || data.m_numLevels == 0)
+			{
+				bResult = false;
+				Report(Format(USTR("ERROR: texture %u size %ux%u levels %u error\n\n"), i, data.m_width, data.m_height, data.m_numLevels));
+				break;
+			}
 			u32 uNumFaces = sceGxtTextureInfo.type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
 			u32 uTextureDataSize = 0;
 			if (!sce::Texture::Gxt::getTextureDataSize(uTextureDataSize, data.m_width, data.m_height, sceGxtTextureInfo.mipCount, uNumFaces, static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format), static_cast<SceGxmTextureType>(sceGxtTextureInfo.type)))
@@ -956,7 +3283,7 @@ bool CGxt::TestPalette()
 				break;
 			}
 			data.m_totalSize = data.m_borderSize + uTextureDataSize;
-			u32 uTexDataOffset = sceGxtTextureInfo.dataOffset;
+			u64 uTexDataOffset = sceGxtTextureInfo.dataOffset;
 			if ((sceGxtTextureInfo.flags & SCE_GXT_TEXTURE_FLAG_HAS_BORDER_DATA) != 0)
 			{
 				u32 uBorderDataSize = 0;
@@ -970,20 +3297,19 @@ bool CGxt::TestPalette()
 			if (uTexDataOffset + data.m_totalSize > uDataEnd)
 			{
 				bResult = false;
-				UPrintf(USTR("ERROR: data size is too small\n\n"));
+				Report(USTR("ERROR: data size is too small\n\n"));
 				break;
 			}
 			data.m_data.resize(data.m_totalSize);
 			data.m_palette16 = nullptr;
 			data.m_palette256 = nullptr;
-			memcpy(&*data.m_data.begin(), pGxt + uTexDataOffset, data.m_totalSize);
+			memcpy(&*data.m_data.begin(), a_pGxt + uTexDataOffset, data.m_totalSize);
 			if (sce::Texture::Gxt::isIndexed(static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format)))
 			{
-				nNumTextures++;
 				if (sceGxtTextureInfo.paletteIndex == UINT32_MAX)
 				{
 					bResult = false;
-					UPrintf(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
+					Report(Format(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex)));
 					break;
 				}
 				u32 uBpp = 0;
@@ -998,7 +3324,7 @@ bool CGxt::TestPalette()
 					if (sceGxtTextureInfo.paletteIndex >= pSceGxtHeader->numP4Palettes)
 					{
 						bResult = false;
-						UPrintf(USTR("ERROR: palette16 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
+						Report(Format(USTR("ERROR: palette16 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex)));
 						break;
 					}
 					data.m_palette16 = &*(m_vPalette16.begin() + sceGxtTextureInfo.paletteIndex);
@@ -1007,7 +3333,7 @@ bool CGxt::TestPalette()
 					if (sceGxtTextureInfo.paletteIndex >= pSceGxtHeader->numP8Palettes)
 					{
 						bResult = false;
-						UPrintf(USTR("ERROR: palette256 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
+						Report(Format(USTR("ERROR: palette256 index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex)));
 						break;
 					}
 					data.m_palette256 = &*(m_vPalette256.begin() + sceGxtTextureInfo.paletteIndex);
@@ -1023,296 +3349,58 @@ bool CGxt::TestPalette()
 				if (sceGxtTextureInfo.paletteIndex != UINT32_MAX)
 				{
 					bResult = false;
-					UPrintf(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex));
+					Report(Format(USTR("ERROR: palette index %08X error\n\n"), static_cast<n32>(sceGxtTextureInfo.paletteIndex)));
 					break;
 				}
 			}
 			m_vData.push_back(data);
+			m_vTextureDataOffset.push_back(static_cast<u32>(uTexDataOffset));
 		}
 		if (!bResult)
 		{
 			break;
 		}
 	} while (false);
-	delete[] pGxt;
-	if (bResult && nNumTextures != 0)
+	return bResult;
+}
+
+// a_vBank maps every palette to the first palette with the same colours, hashed first and compared on a match
+void CGxt::buildPaletteBank(const u8* a_pPalette, u32 a_uCount, u32 a_uSize, vector<u32>& a_vBank)
+{
+	multimap<u64, u32> mHash;
+	a_vBank.resize(a_uCount);
+	for (u32 i = 0; i < a_uCount; i++)
 	{
-		UMkdir(m_sDirName.c_str());
-		for (u32 i = 0; i < static_cast<u32>(m_vData.size()); i++)
+		const u8* pPalette = a_pPalette + i * a_uSize;
+		u64 uHash = CHash::Fnv1a64(pPalette, a_uSize);
+		a_vBank[i] = i;
+		pair<multimap<u64, u32>::iterator, multimap<u64, u32>::iterator> range = mHash.equal_range(uHash);
+		for (multimap<u64, u32>::iterator it = range.first; it != range.second; ++it)
 		{
-			sce::Texture::Gxt::Data& data = m_vData[i];
-			if (!sce::Texture::Gxt::isIndexed(data.m_format))
+			if (memcmp(a_pPalette + it->second * a_uSize, pPalette, a_uSize) == 0)
 			{
-				continue;
-			}
-			u32 uPaletteCount = 0;
-			if (data.m_palette16 != nullptr)
-			{
-				uPaletteCount = static_cast<u32>(m_vPalette16.size());
-			}
-			if (data.m_palette256 != nullptr)
-			{
-				uPaletteCount = static_cast<u32>(m_vPalette256.size());
-			}
-			u32 uNumFaces = data.m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
-			u32 uOffset = 0;
-			u32 uBpp = 0;
-			if (!sce::Texture::Gxt::getBpp(uBpp, data.m_format))
-			{
-				bResult = false;
+				a_vBank[i] = it->second;
 				break;
 			}
-			u32 uFaceAlignment = (uNumFaces > 1 && data.m_numLevels > 1) ? sce::Texture::Gxt::getFaceAlignment(uBpp, data.m_width) : 1;
-			if (sce::Texture::Gxt::isBlockCompressed(data.m_format))
-			{
-				u32 uBlockWidth = sce::Texture::Gxt::getBlockWidth(data.m_format);
-				u32 uBlockHeight = sce::Texture::Gxt::getBlockHeight(data.m_format);
-				for (u32 j = 0; j < uNumFaces; j++)
-				{
-					u32 uFaceOffset = uOffset;
-					u32 uMipWidth = std::max<u32>(data.m_width, uBlockWidth);
-					u32 uMipHeight = std::max<u32>(data.m_height, uBlockHeight);
-					u32 uMipWidthEx = sce::Texture::enclosingPowerOf2(uMipWidth);
-					u32 uMipHeightEx = sce::Texture::enclosingPowerOf2(uMipHeight);
-					for (u32 k = 0; k < data.m_numLevels; k++)
-					{
-						u32 uMipWidthBlocks = (uMipWidth + uBlockWidth - 1) / uBlockWidth;
-						u32 uMipHeightBlocks = (uMipHeight + uBlockHeight - 1) / uBlockHeight;
-						if (k == 0)
-						{
-							u8* pLinear = new u8[uMipWidthEx * uMipHeightEx * uBpp / 8];
-							if (!sce::Texture::Gxt::isPvr(data.m_format) && (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE))
-							{
-								sce::Texture::deSwizzleLevel(pLinear, &*data.m_data.begin() + uOffset, uMipWidthBlocks, uMipHeightBlocks, uBpp * uBlockWidth * uBlockHeight);
-							}
-							else
-							{
-								memcpy(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx * uMipHeightEx * uBpp / 8);
-							}
-							for (u32 uTestCount = 0; uTestCount < uPaletteCount; uTestCount++)
-							{
-								if (data.m_palette16 != nullptr)
-								{
-									data.m_palette16 = &*(m_vPalette16.begin() + uTestCount);
-								}
-								if (data.m_palette256 != nullptr)
-								{
-									data.m_palette256 = &*(m_vPalette256.begin() + uTestCount);
-								}
-								pvrtexture::CPVRTexture* pPVRTexture = nullptr;
-								if (decode(&data, pLinear, uMipWidthEx, uMipHeightEx, uBpp, &pPVRTexture) == 0)
-								{
-									UString sPngFileName = Format(USTR("%") PRIUS USTR("/%d_%d_test_p%d.png"), m_sDirName.c_str(), i, j, uTestCount);
-									FILE* fpSub = UFopen(sPngFileName.c_str(), USTR("wb"));
-									if (fpSub == nullptr)
-									{
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										break;
-									}
-									if (m_bVerbose)
-									{
-										UPrintf(USTR("save: %") PRIUS USTR("\n"), sPngFileName.c_str());
-									}
-									png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-									if (pPng == nullptr)
-									{
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: png_create_write_struct error\n\n"));
-										break;
-									}
-									png_infop pInfo = png_create_info_struct(pPng);
-									if (pInfo == nullptr)
-									{
-										png_destroy_write_struct(&pPng, nullptr);
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: png_create_info_struct error\n\n"));
-										break;
-									}
-									if (setjmp(png_jmpbuf(pPng)) != 0)
-									{
-										png_destroy_write_struct(&pPng, &pInfo);
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: setjmp error\n\n"));
-										break;
-									}
-									png_init_io(pPng, fpSub);
-									png_set_IHDR(pPng, pInfo, data.m_width, data.m_height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-									u8* pData = static_cast<u8*>(pPVRTexture->getDataPtr());
-									png_bytepp pRowPointers = new png_bytep[data.m_height];
-									for (u32 l = 0; l < data.m_height; l++)
-									{
-										pRowPointers[l] = pData + l * uMipWidthEx * 4;
-									}
-									png_set_rows(pPng, pInfo, pRowPointers);
-									png_write_png(pPng, pInfo, PNG_TRANSFORM_IDENTITY, nullptr);
-									png_destroy_write_struct(&pPng, &pInfo);
-									delete[] pRowPointers;
-									fclose(fpSub);
-									delete pPVRTexture;
-									delete[] pLinear;
-								}
-								else
-								{
-									delete[] pLinear;
-									bResult = false;
-									UPrintf(USTR("ERROR: decode error\n\n"));
-									break;
-								}
-							}
-						}
-						u32 uLevelSizeSrc = (uBpp * uMipWidthEx * uMipHeightEx) / 8;
-						uOffset += uLevelSizeSrc;
-						uMipWidth = uMipWidth > uBlockWidth ? uMipWidth / 2 : uBlockWidth;
-						uMipHeight = uMipHeight > uBlockHeight ? uMipHeight / 2 : uBlockHeight;
-						uMipWidthEx = uMipWidthEx > uBlockWidth ? uMipWidthEx / 2 : uBlockWidth;
-						uMipHeightEx = uMipHeightEx > uBlockHeight ? uMipHeightEx / 2 : uBlockHeight;
-					}
-					if (i < uNumFaces - 1)
-					{
-						uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
-					}
-				}
-			}
-			else
-			{
-				u32 uWidthAlignment = data.m_type == SCE_GXM_TEXTURE_LINEAR ? SCE_GXM_TEXTURE_IMPLICIT_STRIDE_ALIGNMENT : 1;
-				for (u32 j = 0; j < uNumFaces; j++)
-				{
-					u32 uFaceOffset = uOffset;
-					u32 uMipWidth = data.m_width;
-					u32 uMipHeight = data.m_height;
-					u32 uMipWidthEx = data.m_numLevels > 1 ? sce::Texture::enclosingPowerOf2(data.m_width) : data.m_width;
-					u32 uMipHeightEx = data.m_numLevels > 1 ? sce::Texture::enclosingPowerOf2(data.m_height) : data.m_height;
-					uMipWidthEx = SCE_ALIGN(uMipWidthEx, uWidthAlignment);
-					for (u32 k = 0; k < data.m_numLevels; k++)
-					{
-						if (k == 0)
-						{
-							u8* pLinear = new u8[uMipWidthEx * uMipHeightEx * uBpp / 8];
-							if (data.m_type == SCE_GXM_TEXTURE_SWIZZLED || data.m_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY || data.m_type == SCE_GXM_TEXTURE_CUBE)
-							{
-								sce::Texture::deSwizzleLevel(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx, uMipHeightEx, uBpp);
-							}
-							else
-							{
-								memcpy(pLinear, &*data.m_data.begin() + uOffset, uMipWidthEx * uMipHeightEx * uBpp / 8);
-							}
-							for (u32 uTestCount = 0; uTestCount < uPaletteCount; uTestCount++)
-							{
-								if (data.m_palette16 != nullptr)
-								{
-									data.m_palette16 = &*(m_vPalette16.begin() + uTestCount);
-								}
-								if (data.m_palette256 != nullptr)
-								{
-									data.m_palette256 = &*(m_vPalette256.begin() + uTestCount);
-								}
-								pvrtexture::CPVRTexture* pPVRTexture = nullptr;
-								if (decode(&data, pLinear, uMipWidthEx, uMipHeightEx, uBpp, &pPVRTexture) == 0)
-								{
-									UString sPngFileName = Format(USTR("%") PRIUS USTR("/%d_%d_test_p%d.png"), m_sDirName.c_str(), i, j, uTestCount);
-									FILE* fpSub = UFopen(sPngFileName.c_str(), USTR("wb"));
-									if (fpSub == nullptr)
-									{
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										break;
-									}
-									if (m_bVerbose)
-									{
-										UPrintf(USTR("save: %") PRIUS USTR("\n"), sPngFileName.c_str());
-									}
-									png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-									if (pPng == nullptr)
-									{
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: png_create_write_struct error\n\n"));
-										break;
-									}
-									png_infop pInfo = png_create_info_struct(pPng);
-									if (pInfo == nullptr)
-									{
-										png_destroy_write_struct(&pPng, nullptr);
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: png_create_info_struct error\n\n"));
-										break;
-									}
-									if (setjmp(png_jmpbuf(pPng)) != 0)
-									{
-										png_destroy_write_struct(&pPng, &pInfo);
-										fclose(fpSub);
-										delete pPVRTexture;
-										delete[] pLinear;
-										bResult = false;
-										UPrintf(USTR("ERROR: setjmp error\n\n"));
-										break;
-									}
-									png_init_io(pPng, fpSub);
-									png_set_IHDR(pPng, pInfo, data.m_width, data.m_height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-									u8* pData = static_cast<u8*>(pPVRTexture->getDataPtr());
-									png_bytepp pRowPointers = new png_bytep[data.m_height];
-									for (u32 l = 0; l < data.m_height; l++)
-									{
-										pRowPointers[l] = pData + l * uMipWidthEx * 4;
-									}
-									png_set_rows(pPng, pInfo, pRowPointers);
-									png_write_png(pPng, pInfo, PNG_TRANSFORM_IDENTITY, nullptr);
-									png_destroy_write_struct(&pPng, &pInfo);
-									delete[] pRowPointers;
-									fclose(fpSub);
-									delete pPVRTexture;
-								}
-								else
-								{
-									bResult = false;
-									UPrintf(USTR("ERROR: decode error\n\n"));
-									break;
-								}
-							}
-							delete[] pLinear;
-							if (!bResult)
-							{
-								break;
-							}
-						}
-						uOffset += uMipHeightEx * ((uMipWidthEx * uBpp + 7) / 8);
-						uMipWidth = uMipWidth > 1 ? uMipWidth / 2 : 1;
-						uMipHeight = uMipHeight > 1 ? uMipHeight / 2 : 1;
-						uMipWidthEx = uMipWidthEx > 1 ? uMipWidthEx / 2 : 1;
-						uMipHeightEx = uMipHeightEx > 1 ? uMipHeightEx / 2 : 1;
-						uMipWidthEx = SCE_ALIGN(uMipWidthEx, uWidthAlignment);
-					}
-					if (j < uNumFaces - 1)
-					{
-						uOffset = uFaceOffset + SCE_ALIGN(uOffset - uFaceOffset, uFaceAlignment);
-					}
-				}
-				if (!bResult)
-				{
-					break;
-				}
-			}
+		}
+		if (a_vBank[i] == i)
+		{
+			mHash.insert(make_pair(uHash, i));
 		}
 	}
-	return bResult;
+}
+
+u32 CGxt::countPaletteBank(const vector<u32>& a_vBank)
+{
+	u32 uCount = 0;
+	for (u32 i = 0; i < static_cast<u32>(a_vBank.size()); i++)
+	{
+		if (a_vBank[i] == i)
+		{
+			uCount++;
+		}
+	}
+	return uCount;
 }
 
 bool CGxt::IsGxtFile(const UString& a_sFileName)
@@ -1336,6 +3424,436 @@ bool CGxt::IsGxtFile(const UString& a_sFileName)
 	return sceGxtHeader.tag == SCE_GXT_TAG;
 }
 
+// reads the header and the texture infos only, the texture data is never loaded
+bool CGxt::GetInfo(const UString& a_sFileName, UString& a_sInfo)
+{
+	a_sInfo.clear();
+	FILE* fp = UFopen(a_sFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	Fseek(fp, 0, SEEK_END);
+	u64 uFileSize = Ftell(fp);
+	Fseek(fp, 0, SEEK_SET);
+	SceGxtHeader sceGxtHeader = {};
+	if (uFileSize < sizeof(sceGxtHeader) || fread(&sceGxtHeader, sizeof(sceGxtHeader), 1, fp) != 1 || !sce::Texture::Gxt::isValidInput(reinterpret_cast<const u8*>(&sceGxtHeader), sizeof(sceGxtHeader)))
+	{
+		fclose(fp);
+		Report(Format(USTR("ERROR: %") PRIUS USTR(" is not a gxt file\n\n"), a_sFileName.c_str()));
+		return false;
+	}
+	if (sizeof(sceGxtHeader) + static_cast<u64>(sceGxtHeader.numTextures) * sizeof(SceGxtTextureInfo) > uFileSize)
+	{
+		fclose(fp);
+		Report(USTR("ERROR: data size is too small\n\n"));
+		return false;
+	}
+	vector<SceGxtTextureInfo> vSceGxtTextureInfo(sceGxtHeader.numTextures);
+	if (!vSceGxtTextureInfo.empty() && fread(&*vSceGxtTextureInfo.begin(), sizeof(SceGxtTextureInfo), vSceGxtTextureInfo.size(), fp) != vSceGxtTextureInfo.size())
+	{
+		fclose(fp);
+		Report(USTR("ERROR: read file failed\n\n"));
+		return false;
+	}
+	fclose(fp);
+	UString sFileName;
+	for (UString::const_iterator it = a_sFileName.begin(); it != a_sFileName.end(); ++it)
+	{
+		if (*it == USTR('\\') || *it == USTR('"'))
+		{
+			sFileName += USTR('\\');
+		}
+		else if (static_cast<u32>(*it) < 0x20)
+		{
+			sFileName += Format(USTR("\\u%04X"), static_cast<u32>(*it));
+			continue;
+		}
+		sFileName += *it;
+	}
+	a_sInfo += Format(USTR("{\n\t\"file\": \"%") PRIUS USTR("\",\n"), sFileName.c_str());
+	a_sInfo += Format(USTR("\t\"version\": \"0x%08X\",\n"), sceGxtHeader.version);
+	a_sInfo += Format(USTR("\t\"data_offset\": %u,\n\t\"data_size\": %u,\n"), sceGxtHeader.dataOffset, sceGxtHeader.dataSize);
+	a_sInfo += Format(USTR("\t\"p4_palettes\": %u,\n\t\"p8_palettes\": %u,\n"), sceGxtHeader.numP4Palettes, sceGxtHeader.numP8Palettes);
+	a_sInfo += USTR("\t\"textures\":\n\t[");
+	for (u32 i = 0; i < static_cast<u32>(vSceGxtTextureInfo.size()); i++)
+	{
+		const SceGxtTextureInfo& sceGxtTextureInfo = vSceGxtTextureInfo[i];
+		SceGxmTextureFormat eFormat = static_cast<SceGxmTextureFormat>(sceGxtTextureInfo.format);
+		SceGxmTextureType eType = static_cast<SceGxmTextureType>(sceGxtTextureInfo.type);
+		u32 uNumFaces = eType == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+		bool bBorder = (sceGxtTextureInfo.flags & SCE_GXT_TEXTURE_FLAG_HAS_BORDER_DATA) != 0;
+		a_sInfo += Format(USTR("%") PRIUS USTR("\n\t\t{ \"index\": %u"), i == 0 ? USTR("") : USTR(","), i);
+		a_sInfo += Format(USTR(", \"format\": \"%") PRIUS USTR("\", \"format_value\": \"0x%08X\""), getFormatName(eFormat), sceGxtTextureInfo.format);
+		a_sInfo += Format(USTR(", \"type\": \"%") PRIUS USTR("\""), getTypeName(eType));
+		a_sInfo += Format(USTR(", \"width\": %u, \"height\": %u, \"mips\": %u, \"faces\": %u"), sceGxtTextureInfo.width, sceGxtTextureInfo.height, sceGxtTextureInfo.mipCount, uNumFaces);
+		a_sInfo += Format(USTR(", \"palette_index\": %d"), sceGxtTextureInfo.paletteIndex == UINT32_MAX ? -1 : static_cast<n32>(sceGxtTextureInfo.paletteIndex));
+		a_sInfo += Format(USTR(", \"data_offset\": %u, \"data_size\": %u"), sceGxtTextureInfo.dataOffset, sceGxtTextureInfo.dataSize);
+		// derived from the layout, null when the format or the size is not supported,
+		// both are checked first so that no error message ends up in the json
+		u32 uBpp = 0;
+		bool bKnownFormat = sce::Texture::Gxt::lookupBpp(uBpp, eFormat);
+		bool bValidSize = sceGxtTextureInfo.width <= SCE_GXM_TEXTURE_MAX_SIZE && sceGxtTextureInfo.height <= SCE_GXM_TEXTURE_MAX_SIZE && ((eType != SCE_GXM_TEXTURE_SWIZZLED && eType != SCE_GXM_TEXTURE_CUBE) || (SCE_IS_POW2(sceGxtTextureInfo.width) && SCE_IS_POW2(sceGxtTextureInfo.height)));
+		u32 uTextureDataSize = 0;
+		if (bKnownFormat && bValidSize && sce::Texture::Gxt::getTextureDataSize(uTextureDataSize, sceGxtTextureInfo.width, sceGxtTextureInfo.height, sceGxtTextureInfo.mipCount, uNumFaces, eFormat, eType))
+		{
+			a_sInfo += Format(USTR(", \"texture_data_size\": %u"), uTextureDataSize);
+		}
+		else
+		{
+			a_sInfo += USTR(", \"texture_data_size\": null");
+		}
+		a_sInfo += Format(USTR(", \"border\": %") PRIUS, bBorder ? USTR("true") : USTR("false"));
+		u32 uBorderDataSize = 0;
+		if (!bBorder)
+		{
+			a_sInfo += USTR(", \"border_data_size\": 0");
+		}
+		else if (bKnownFormat && sce::Texture::Gxt::supportsBorderData(eFormat) && sce::Texture::Gxt::getBorderDataSize(uBorderDataSize, sceGxtTextureInfo.width, sceGxtTextureInfo.height, eFormat))
+		{
+			a_sInfo += Format(USTR(", \"border_data_size\": %u"), uBorderDataSize);
+		}
+		else
+		{
+			a_sInfo += USTR(", \"border_data_size\": null");
+		}
+		a_sInfo += USTR(" }");
+	}
+	a_sInfo += USTR("\n\t]\n}\n");
+	return true;
+}
+
+bool CGxt::PrintInfo(const UString& a_sFileName)
+{
+	UString sInfo;
+	if (!GetInfo(a_sFileName, sInfo))
+	{
+		return false;
+	}
+	UPrintf(USTR("%") PRIUS, sInfo.c_str());
+	return true;
+}
+
+const UChar* CGxt::getFormatName(SceGxmTextureFormat a_eFormat)
+{
+#define GXTTOOL_FORMAT_NAME(a_Name) { SCE_GXM_TEXTURE_FORMAT_##a_Name, USTR(#a_Name) }
+	static const struct
+	{
+		SceGxmTextureFormat Format;
+		const UChar* Name;
+	} c_FormatName[] =
+	{
+		GXTTOOL_FORMAT_NAME(U8_000R),
+		GXTTOOL_FORMAT_NAME(U8_111R),
+		GXTTOOL_FORMAT_NAME(U8_RRRR),
+		GXTTOOL_FORMAT_NAME(U8_0RRR),
+		GXTTOOL_FORMAT_NAME(U8_1RRR),
+		GXTTOOL_FORMAT_NAME(U8_R000),
+		GXTTOOL_FORMAT_NAME(U8_R111),
+		GXTTOOL_FORMAT_NAME(U8_R),
+		GXTTOOL_FORMAT_NAME(S8_000R),
+		GXTTOOL_FORMAT_NAME(S8_111R),
+		GXTTOOL_FORMAT_NAME(S8_RRRR),
+		GXTTOOL_FORMAT_NAME(S8_0RRR),
+		GXTTOOL_FORMAT_NAME(S8_1RRR),
+		GXTTOOL_FORMAT_NAME(S8_R000),
+		GXTTOOL_FORMAT_NAME(S8_R111),
+		GXTTOOL_FORMAT_NAME(S8_R),
+		GXTTOOL_FORMAT_NAME(U4U4U4U4_ABGR),
+		GXTTOOL_FORMAT_NAME(U4U4U4U4_ARGB),
+		GXTTOOL_FORMAT_NAME(U4U4U4U4_RGBA),
+		GXTTOOL_FORMAT_NAME(U4U4U4U4_BGRA),
+		GXTTOOL_FORMAT_NAME(X4U4U4U4_1BGR),
+		GXTTOOL_FORMAT_NAME(X4U4U4U4_1RGB),
+		GXTTOOL_FORMAT_NAME(U4U4U4X4_RGB1),
+		GXTTOOL_FORMAT_NAME(U4U4U4X4_BGR1),
+		GXTTOOL_FORMAT_NAME(U8U3U3U2_ARGB),
+		GXTTOOL_FORMAT_NAME(U1U5U5U5_ABGR),
+		GXTTOOL_FORMAT_NAME(U1U5U5U5_ARGB),
+		GXTTOOL_FORMAT_NAME(U5U5U5U1_RGBA),
+		GXTTOOL_FORMAT_NAME(U5U5U5U1_BGRA),
+		GXTTOOL_FORMAT_NAME(X1U5U5U5_1BGR),
+		GXTTOOL_FORMAT_NAME(X1U5U5U5_1RGB),
+		GXTTOOL_FORMAT_NAME(U5U5U5X1_RGB1),
+		GXTTOOL_FORMAT_NAME(U5U5U5X1_BGR1),
+		GXTTOOL_FORMAT_NAME(U5U6U5_BGR),
+		GXTTOOL_FORMAT_NAME(U5U6U5_RGB),
+		GXTTOOL_FORMAT_NAME(U6S5S5_BGR),
+		GXTTOOL_FORMAT_NAME(S5S5U6_RGB),
+		GXTTOOL_FORMAT_NAME(U8U8_00GR),
+		GXTTOOL_FORMAT_NAME(U8U8_GRRR),
+		GXTTOOL_FORMAT_NAME(U8U8_RGGG),
+		GXTTOOL_FORMAT_NAME(U8U8_GRGR),
+		GXTTOOL_FORMAT_NAME(U8U8_00RG),
+		GXTTOOL_FORMAT_NAME(U8U8_GR),
+		GXTTOOL_FORMAT_NAME(S8S8_00GR),
+		GXTTOOL_FORMAT_NAME(S8S8_GRRR),
+		GXTTOOL_FORMAT_NAME(S8S8_RGGG),
+		GXTTOOL_FORMAT_NAME(S8S8_GRGR),
+		GXTTOOL_FORMAT_NAME(S8S8_00RG),
+		GXTTOOL_FORMAT_NAME(S8S8_GR),
+		GXTTOOL_FORMAT_NAME(U16_000R),
+		GXTTOOL_FORMAT_NAME(U16_111R),
+		GXTTOOL_FORMAT_NAME(U16_RRRR),
+		GXTTOOL_FORMAT_NAME(U16_0RRR),
+		GXTTOOL_FORMAT_NAME(U16_1RRR),
+		GXTTOOL_FORMAT_NAME(U16_R000),
+		GXTTOOL_FORMAT_NAME(U16_R111),
+		GXTTOOL_FORMAT_NAME(U16_R),
+		GXTTOOL_FORMAT_NAME(S16_000R),
+		GXTTOOL_FORMAT_NAME(S16_111R),
+		GXTTOOL_FORMAT_NAME(S16_RRRR),
+		GXTTOOL_FORMAT_NAME(S16_0RRR),
+		GXTTOOL_FORMAT_NAME(S16_1RRR),
+		GXTTOOL_FORMAT_NAME(S16_R000),
+		GXTTOOL_FORMAT_NAME(S16_R111),
+		GXTTOOL_FORMAT_NAME(S16_R),
+		GXTTOOL_FORMAT_NAME(F16_000R),
+		GXTTOOL_FORMAT_NAME(F16_111R),
+		GXTTOOL_FORMAT_NAME(F16_RRRR),
+		GXTTOOL_FORMAT_NAME(F16_0RRR),
+		GXTTOOL_FORMAT_NAME(F16_1RRR),
+		GXTTOOL_FORMAT_NAME(F16_R000),
+		GXTTOOL_FORMAT_NAME(F16_R111),
+		GXTTOOL_FORMAT_NAME(F16_R),
+		GXTTOOL_FORMAT_NAME(U8U8U8U8_ABGR),
+		GXTTOOL_FORMAT_NAME(U8U8U8U8_ARGB),
+		GXTTOOL_FORMAT_NAME(U8U8U8U8_RGBA),
+		GXTTOOL_FORMAT_NAME(U8U8U8U8_BGRA),
+		GXTTOOL_FORMAT_NAME(X8U8U8U8_1BGR),
+		GXTTOOL_FORMAT_NAME(X8U8U8U8_1RGB),
+		GXTTOOL_FORMAT_NAME(U8U8U8X8_RGB1),
+		GXTTOOL_FORMAT_NAME(U8U8U8X8_BGR1),
+		GXTTOOL_FORMAT_NAME(S8S8S8S8_ABGR),
+		GXTTOOL_FORMAT_NAME(S8S8S8S8_ARGB),
+		GXTTOOL_FORMAT_NAME(S8S8S8S8_RGBA),
+		GXTTOOL_FORMAT_NAME(S8S8S8S8_BGRA),
+		GXTTOOL_FORMAT_NAME(X8S8S8S8_1BGR),
+		GXTTOOL_FORMAT_NAME(X8S8S8S8_1RGB),
+		GXTTOOL_FORMAT_NAME(S8S8S8X8_RGB1),
+		GXTTOOL_FORMAT_NAME(S8S8S8X8_BGR1),
+		GXTTOOL_FORMAT_NAME(U2U10U10U10_ABGR),
+		GXTTOOL_FORMAT_NAME(U2U10U10U10_ARGB),
+		GXTTOOL_FORMAT_NAME(U10U10U10U2_RGBA),
+		GXTTOOL_FORMAT_NAME(U10U10U10U2_BGRA),
+		GXTTOOL_FORMAT_NAME(X2U10U10U10_1BGR),
+		GXTTOOL_FORMAT_NAME(X2U10U10U10_1RGB),
+		GXTTOOL_FORMAT_NAME(U10U10U10X2_RGB1),
+		GXTTOOL_FORMAT_NAME(U10U10U10X2_BGR1),
+		GXTTOOL_FORMAT_NAME(U16U16_00GR),
+		GXTTOOL_FORMAT_NAME(U16U16_GRRR),
+		GXTTOOL_FORMAT_NAME(U16U16_RGGG),
+		GXTTOOL_FORMAT_NAME(U16U16_GRGR),
+		GXTTOOL_FORMAT_NAME(U16U16_00RG),
+		GXTTOOL_FORMAT_NAME(U16U16_GR),
+		GXTTOOL_FORMAT_NAME(S16S16_00GR),
+		GXTTOOL_FORMAT_NAME(S16S16_GRRR),
+		GXTTOOL_FORMAT_NAME(S16S16_RGGG),
+		GXTTOOL_FORMAT_NAME(S16S16_GRGR),
+		GXTTOOL_FORMAT_NAME(S16S16_00RG),
+		GXTTOOL_FORMAT_NAME(S16S16_GR),
+		GXTTOOL_FORMAT_NAME(F16F16_00GR),
+		GXTTOOL_FORMAT_NAME(F16F16_GRRR),
+		GXTTOOL_FORMAT_NAME(F16F16_RGGG),
+		GXTTOOL_FORMAT_NAME(F16F16_GRGR),
+		GXTTOOL_FORMAT_NAME(F16F16_00RG),
+		GXTTOOL_FORMAT_NAME(F16F16_GR),
+		GXTTOOL_FORMAT_NAME(F32_000R),
+		GXTTOOL_FORMAT_NAME(F32_111R),
+		GXTTOOL_FORMAT_NAME(F32_RRRR),
+		GXTTOOL_FORMAT_NAME(F32_0RRR),
+		GXTTOOL_FORMAT_NAME(F32_1RRR),
+		GXTTOOL_FORMAT_NAME(F32_R000),
+		GXTTOOL_FORMAT_NAME(F32_R111),
+		GXTTOOL_FORMAT_NAME(F32_R),
+		GXTTOOL_FORMAT_NAME(F32M_000R),
+		GXTTOOL_FORMAT_NAME(F32M_111R),
+		GXTTOOL_FORMAT_NAME(F32M_RRRR),
+		GXTTOOL_FORMAT_NAME(F32M_0RRR),
+		GXTTOOL_FORMAT_NAME(F32M_1RRR),
+		GXTTOOL_FORMAT_NAME(F32M_R000),
+		GXTTOOL_FORMAT_NAME(F32M_R111),
+		GXTTOOL_FORMAT_NAME(F32M_R),
+		GXTTOOL_FORMAT_NAME(X8S8S8U8_1BGR),
+		GXTTOOL_FORMAT_NAME(X8U8S8S8_1RGB),
+		GXTTOOL_FORMAT_NAME(X8U24_SD),
+		GXTTOOL_FORMAT_NAME(U24X8_DS),
+		GXTTOOL_FORMAT_NAME(U32_000R),
+		GXTTOOL_FORMAT_NAME(U32_111R),
+		GXTTOOL_FORMAT_NAME(U32_RRRR),
+		GXTTOOL_FORMAT_NAME(U32_0RRR),
+		GXTTOOL_FORMAT_NAME(U32_1RRR),
+		GXTTOOL_FORMAT_NAME(U32_R000),
+		GXTTOOL_FORMAT_NAME(U32_R111),
+		GXTTOOL_FORMAT_NAME(U32_R),
+		GXTTOOL_FORMAT_NAME(S32_000R),
+		GXTTOOL_FORMAT_NAME(S32_111R),
+		GXTTOOL_FORMAT_NAME(S32_RRRR),
+		GXTTOOL_FORMAT_NAME(S32_0RRR),
+		GXTTOOL_FORMAT_NAME(S32_1RRR),
+		GXTTOOL_FORMAT_NAME(S32_R000),
+		GXTTOOL_FORMAT_NAME(S32_R111),
+		GXTTOOL_FORMAT_NAME(S32_R),
+		GXTTOOL_FORMAT_NAME(SE5M9M9M9_BGR),
+		GXTTOOL_FORMAT_NAME(SE5M9M9M9_RGB),
+		GXTTOOL_FORMAT_NAME(F10F11F11_BGR),
+		GXTTOOL_FORMAT_NAME(F11F11F10_RGB),
+		GXTTOOL_FORMAT_NAME(F16F16F16F16_ABGR),
+		GXTTOOL_FORMAT_NAME(F16F16F16F16_ARGB),
+		GXTTOOL_FORMAT_NAME(F16F16F16F16_RGBA),
+		GXTTOOL_FORMAT_NAME(F16F16F16F16_BGRA),
+		GXTTOOL_FORMAT_NAME(X16F16F16F16_1BGR),
+		GXTTOOL_FORMAT_NAME(X16F16F16F16_1RGB),
+		GXTTOOL_FORMAT_NAME(F16F16F16X16_RGB1),
+		GXTTOOL_FORMAT_NAME(F16F16F16X16_BGR1),
+		GXTTOOL_FORMAT_NAME(U16U16U16U16_ABGR),
+		GXTTOOL_FORMAT_NAME(U16U16U16U16_ARGB),
+		GXTTOOL_FORMAT_NAME(U16U16U16U16_RGBA),
+		GXTTOOL_FORMAT_NAME(U16U16U16U16_BGRA),
+		GXTTOOL_FORMAT_NAME(X16U16U16U16_1BGR),
+		GXTTOOL_FORMAT_NAME(X16U16U16U16_1RGB),
+		GXTTOOL_FORMAT_NAME(U16U16U16X16_RGB1),
+		GXTTOOL_FORMAT_NAME(U16U16U16X16_BGR1),
+		GXTTOOL_FORMAT_NAME(S16S16S16S16_ABGR),
+		GXTTOOL_FORMAT_NAME(S16S16S16S16_ARGB),
+		GXTTOOL_FORMAT_NAME(S16S16S16S16_RGBA),
+		GXTTOOL_FORMAT_NAME(S16S16S16S16_BGRA),
+		GXTTOOL_FORMAT_NAME(X16S16S16S16_1BGR),
+		GXTTOOL_FORMAT_NAME(X16S16S16S16_1RGB),
+		GXTTOOL_FORMAT_NAME(S16S16S16X16_RGB1),
+		GXTTOOL_FORMAT_NAME(S16S16S16X16_BGR1),
+		GXTTOOL_FORMAT_NAME(F32F32_00GR),
+		GXTTOOL_FORMAT_NAME(F32F32_GRRR),
+		GXTTOOL_FORMAT_NAME(F32F32_RGGG),
+		GXTTOOL_FORMAT_NAME(F32F32_GRGR),
+		GXTTOOL_FORMAT_NAME(F32F32_00RG),
+		GXTTOOL_FORMAT_NAME(F32F32_GR),
+		GXTTOOL_FORMAT_NAME(U32U32_00GR),
+		GXTTOOL_FORMAT_NAME(U32U32_GRRR),
+		GXTTOOL_FORMAT_NAME(U32U32_RGGG),
+		GXTTOOL_FORMAT_NAME(U32U32_GRGR),
+		GXTTOOL_FORMAT_NAME(U32U32_00RG),
+		GXTTOOL_FORMAT_NAME(U32U32_GR),
+		GXTTOOL_FORMAT_NAME(PVRT2BPP_ABGR),
+		GXTTOOL_FORMAT_NAME(PVRT2BPP_1BGR),
+		GXTTOOL_FORMAT_NAME(PVRT4BPP_ABGR),
+		GXTTOOL_FORMAT_NAME(PVRT4BPP_1BGR),
+		GXTTOOL_FORMAT_NAME(PVRTII2BPP_ABGR),
+		GXTTOOL_FORMAT_NAME(PVRTII2BPP_1BGR),
+		GXTTOOL_FORMAT_NAME(PVRTII4BPP_ABGR),
+		GXTTOOL_FORMAT_NAME(PVRTII4BPP_1BGR),
+		GXTTOOL_FORMAT_NAME(UBC1_ABGR),
+		GXTTOOL_FORMAT_NAME(UBC1_1BGR),
+		GXTTOOL_FORMAT_NAME(UBC2_ABGR),
+		GXTTOOL_FORMAT_NAME(UBC2_1BGR),
+		GXTTOOL_FORMAT_NAME(UBC3_ABGR),
+		GXTTOOL_FORMAT_NAME(UBC3_1BGR),
+		GXTTOOL_FORMAT_NAME(UBC4_000R),
+		GXTTOOL_FORMAT_NAME(UBC4_111R),
+		GXTTOOL_FORMAT_NAME(UBC4_RRRR),
+		GXTTOOL_FORMAT_NAME(UBC4_0RRR),
+		GXTTOOL_FORMAT_NAME(UBC4_1RRR),
+		GXTTOOL_FORMAT_NAME(UBC4_R000),
+		GXTTOOL_FORMAT_NAME(UBC4_R111),
+		GXTTOOL_FORMAT_NAME(UBC4_R),
+		GXTTOOL_FORMAT_NAME(SBC4_000R),
+		GXTTOOL_FORMAT_NAME(SBC4_111R),
+		GXTTOOL_FORMAT_NAME(SBC4_RRRR),
+		GXTTOOL_FORMAT_NAME(SBC4_0RRR),
+		GXTTOOL_FORMAT_NAME(SBC4_1RRR),
+		GXTTOOL_FORMAT_NAME(SBC4_R000),
+		GXTTOOL_FORMAT_NAME(SBC4_R111),
+		GXTTOOL_FORMAT_NAME(SBC4_R),
+		GXTTOOL_FORMAT_NAME(UBC5_00GR),
+		GXTTOOL_FORMAT_NAME(UBC5_GRRR),
+		GXTTOOL_FORMAT_NAME(UBC5_RGGG),
+		GXTTOOL_FORMAT_NAME(UBC5_GRGR),
+		GXTTOOL_FORMAT_NAME(UBC5_00RG),
+		GXTTOOL_FORMAT_NAME(UBC5_GR),
+		GXTTOOL_FORMAT_NAME(SBC5_00GR),
+		GXTTOOL_FORMAT_NAME(SBC5_GRRR),
+		GXTTOOL_FORMAT_NAME(SBC5_RGGG),
+		GXTTOOL_FORMAT_NAME(SBC5_GRGR),
+		GXTTOOL_FORMAT_NAME(SBC5_00RG),
+		GXTTOOL_FORMAT_NAME(SBC5_GR),
+		GXTTOOL_FORMAT_NAME(YUV420P2_CSC0),
+		GXTTOOL_FORMAT_NAME(YVU420P2_CSC0),
+		GXTTOOL_FORMAT_NAME(YUV420P2_CSC1),
+		GXTTOOL_FORMAT_NAME(YVU420P2_CSC1),
+		GXTTOOL_FORMAT_NAME(YUV420P3_CSC0),
+		GXTTOOL_FORMAT_NAME(YVU420P3_CSC0),
+		GXTTOOL_FORMAT_NAME(YUV420P3_CSC1),
+		GXTTOOL_FORMAT_NAME(YVU420P3_CSC1),
+		GXTTOOL_FORMAT_NAME(YUYV422_CSC0),
+		GXTTOOL_FORMAT_NAME(YVYU422_CSC0),
+		GXTTOOL_FORMAT_NAME(UYVY422_CSC0),
+		GXTTOOL_FORMAT_NAME(VYUY422_CSC0),
+		GXTTOOL_FORMAT_NAME(YUYV422_CSC1),
+		GXTTOOL_FORMAT_NAME(YVYU422_CSC1),
+		GXTTOOL_FORMAT_NAME(UYVY422_CSC1),
+		GXTTOOL_FORMAT_NAME(VYUY422_CSC1),
+		GXTTOOL_FORMAT_NAME(P4_ABGR),
+		GXTTOOL_FORMAT_NAME(P4_ARGB),
+		GXTTOOL_FORMAT_NAME(P4_RGBA),
+		GXTTOOL_FORMAT_NAME(P4_BGRA),
+		GXTTOOL_FORMAT_NAME(P4_1BGR),
+		GXTTOOL_FORMAT_NAME(P4_1RGB),
+		GXTTOOL_FORMAT_NAME(P4_RGB1),
+		GXTTOOL_FORMAT_NAME(P4_BGR1),
+		GXTTOOL_FORMAT_NAME(P8_ABGR),
+		GXTTOOL_FORMAT_NAME(P8_ARGB),
+		GXTTOOL_FORMAT_NAME(P8_RGBA),
+		GXTTOOL_FORMAT_NAME(P8_BGRA),
+		GXTTOOL_FORMAT_NAME(P8_1BGR),
+		GXTTOOL_FORMAT_NAME(P8_1RGB),
+		GXTTOOL_FORMAT_NAME(P8_RGB1),
+		GXTTOOL_FORMAT_NAME(P8_BGR1),
+		GXTTOOL_FORMAT_NAME(U8U8U8_BGR),
+		GXTTOOL_FORMAT_NAME(U8U8U8_RGB),
+		GXTTOOL_FORMAT_NAME(S8S8S8_BGR),
+		GXTTOOL_FORMAT_NAME(S8S8S8_RGB),
+		GXTTOOL_FORMAT_NAME(U2F10F10F10_ABGR),
+		GXTTOOL_FORMAT_NAME(U2F10F10F10_ARGB),
+		GXTTOOL_FORMAT_NAME(F10F10F10U2_RGBA),
+		GXTTOOL_FORMAT_NAME(F10F10F10U2_BGRA),
+		GXTTOOL_FORMAT_NAME(X2F10F10F10_1BGR),
+		GXTTOOL_FORMAT_NAME(X2F10F10F10_1RGB),
+		GXTTOOL_FORMAT_NAME(F10F10F10X2_RGB1),
+		GXTTOOL_FORMAT_NAME(F10F10F10X2_BGR1)
+	};
+#undef GXTTOOL_FORMAT_NAME
+	for (u32 i = 0; i < SDW_ARRAY_COUNT(c_FormatName); i++)
+	{
+		if (c_FormatName[i].Format == a_eFormat)
+		{
+			return c_FormatName[i].Name;
+		}
+	}
+	return USTR("unknown");
+}
+
+const UChar* CGxt::getTypeName(SceGxmTextureType a_eType)
+{
+	switch (a_eType)
+	{
+	case SCE_GXM_TEXTURE_SWIZZLED:
+		return USTR("swizzled");
+	case SCE_GXM_TEXTURE_CUBE:
+		return USTR("cube");
+	case SCE_GXM_TEXTURE_LINEAR:
+		return USTR("linear");
+	case SCE_GXM_TEXTURE_TILED:
+		return USTR("tiled");
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		return USTR("swizzled_arbitrary");
+	case SCE_GXM_TEXTURE_LINEAR_STRIDED:
+		return USTR("linear_strided");
+	case SCE_GXM_TEXTURE_CUBE_ARBITRARY:
+		return USTR("cube_arbitrary");
+	}
+	return USTR("unknown");
+}
+
 int CGxt::decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth, n32 a_nHeight, u32 a_uBpp, pvrtexture::CPVRTexture** a_pPVRTexture)
 {
 	u8* pRGBA = nullptr;
@@ -1352,6 +3870,14 @@ int CGxt::decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth,
 	case SCE_GXM_TEXTURE_FORMAT_P8_ARGB:
 	case SCE_GXM_TEXTURE_FORMAT_P8_RGBA:
 	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_1BGR:
 		break;
 	default:
 		return 1;
@@ -1366,8 +3892,8 @@ int CGxt::decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth,
 		pRGBA = new u8[a_nWidth * a_nHeight * 4];
 		for (n32 i = 0; i < a_nWidth / 2 * a_nHeight; i++)
 		{
-			*reinterpret_cast<u32*>(pRGBA + i * 4) = *reinterpret_cast<u32*>(a_pData->m_palette16->m_data + (*(a_pLinear + i) & 0xF) * 4);
-			*reinterpret_cast<u32*>(pRGBA + (i + 1) * 4) = *reinterpret_cast<u32*>(a_pData->m_palette16->m_data + (*(a_pLinear + i) >> 4 & 0xF) * 4);
+			*reinterpret_cast<u32*>(pRGBA + i * 2 * 4) = *reinterpret_cast<u32*>(a_pData->m_palette16->m_data + (*(a_pLinear + i) & 0xF) * 4);
+			*reinterpret_cast<u32*>(pRGBA + (i * 2 + 1) * 4) = *reinterpret_cast<u32*>(a_pData->m_palette16->m_data + (*(a_pLinear + i) >> 4 & 0xF) * 4);
 		}
 		break;
 	case SCE_GXM_TEXTURE_FORMAT_P8_ABGR:
@@ -1423,6 +3949,26 @@ int CGxt::decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth,
 	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB:
 		pvrTextureHeaderV3.u64PixelFormat = pvrtexture::PixelType('b', 'g', 'r', 0, 8, 8, 8, 0).PixelTypeID;
 		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_ABGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCI_2bpp_RGBA;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_1BGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCI_2bpp_RGB;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_ABGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCI_4bpp_RGBA;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_1BGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCI_4bpp_RGB;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_1BGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCII_2bpp;
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_1BGR:
+		pvrTextureHeaderV3.u64PixelFormat = ePVRTPF_PVRTCII_4bpp;
+		break;
 	default:
 		break;
 	}
@@ -1452,3 +3998,177 @@ int CGxt::decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth,
 	}
 	return 0;
 }
+
+int CGxt::encode(sce::Texture::Gxt::Data* a_pData, const u8* a_pRGBA, n32 a_nWidth, n32 a_nHeight, u32 a_uBpp, u8* a_pLinear)
+{
+	bool bFast = m_eQuality == kQualityFast;
+	switch (a_pData->m_format)
+	{
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII2BPP_1BGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_PVRTII4BPP_1BGR:
+		{
+			SceGxmTextureBaseFormat eBaseFormat = static_cast<SceGxmTextureBaseFormat>(a_pData->m_format & SCE_GXM_TEXTURE_BASE_FORMAT_MASK);
+			bool bPvrtII = eBaseFormat == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP || eBaseFormat == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP;
+			bool bOpaque = (a_pData->m_format & ~SCE_GXM_TEXTURE_BASE_FORMAT_MASK) == SCE_GXM_TEXTURE_SWIZZLE4_1BGR;
+			return CPvrtc::Encode(a_pRGBA, a_nWidth, a_nHeight, a_uBpp, bPvrtII, bOpaque, bFast, a_pLinear) ? 0 : 1;
+		}
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ARGB:
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_RGBA:
+	case SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB:
+		break;
+	default:
+		return 1;
+	}
+	pvrtexture::PixelType pixelType;
+	switch (a_pData->m_format)
+	{
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR:
+		pixelType = pvrtexture::PixelType('r', 'g', 'b', 'a', 8, 8, 8, 8);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ARGB:
+		pixelType = pvrtexture::PixelType('b', 'g', 'r', 'a', 8, 8, 8, 8);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_RGBA:
+		pixelType = pvrtexture::PixelType('a', 'b', 'g', 'r', 8, 8, 8, 8);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR:
+		pixelType = pvrtexture::PixelType(ePVRTPF_BC1);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR:
+		pixelType = pvrtexture::PixelType(ePVRTPF_BC2);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR:
+		pixelType = pvrtexture::PixelType(ePVRTPF_BC3);
+		break;
+	case SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB:
+		pixelType = pvrtexture::PixelType('b', 'g', 'r', 0, 8, 8, 8, 0);
+		break;
+	default:
+		break;
+	}
+	PVRTextureHeaderV3 pvrTextureHeaderV3;
+	pvrTextureHeaderV3.u64PixelFormat = pvrtexture::PVRStandard8PixelType.PixelTypeID;
+	pvrTextureHeaderV3.u32Height = a_nHeight;
+	pvrTextureHeaderV3.u32Width = a_nWidth;
+	MetaDataBlock metaDataBlock;
+	metaDataBlock.DevFOURCC = PVRTEX3_IDENT;
+	metaDataBlock.u32Key = ePVRTMetaDataTextureOrientation;
+	metaDataBlock.u32DataSize = 3;
+	metaDataBlock.Data = new PVRTuint8[metaDataBlock.u32DataSize];
+	metaDataBlock.Data[0] = ePVRTOrientRight;
+	metaDataBlock.Data[1] = ePVRTOrientUp;
+	metaDataBlock.Data[2] = ePVRTOrientIn;
+	pvrtexture::CPVRTextureHeader pvrTextureHeader(pvrTextureHeaderV3, 1, &metaDataBlock);
+	pvrtexture::CPVRTexture pvrTexture(pvrTextureHeader, a_pRGBA);
+	if (!pvrtexture::Transcode(pvrTexture, pixelType, ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacelRGB, bFast ? pvrtexture::ePVRTCFast : pvrtexture::ePVRTCHigh))
+	{
+		return 1;
+	}
+	memcpy(a_pLinear, pvrTexture.getDataPtr(), a_nWidth * a_nHeight * a_uBpp / 8);
+	return 0;
+}
+
+bool CGxt::readPng(FILE* a_fp, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight, vector<u8>* a_pIndex, vector<u8>* a_pPalette)
+{
+	png_structp pPng = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (pPng == nullptr)
+	{
+		Report(USTR("ERROR: png_create_read_struct error\n\n"));
+		return false;
+	}
+	png_infop pInfo = png_create_info_struct(pPng);
+	if (pInfo == nullptr)
+	{
+		png_destroy_read_struct(&pPng, nullptr, nullptr);
+		Report(USTR("ERROR: png_create_info_struct error\n\n"));
+		return false;
+	}
+	png_bytepp pRowPointers = nullptr;
+	if (setjmp(png_jmpbuf(pPng)) != 0)
+	{
+		delete[] pRowPointers;
+		png_destroy_read_struct(&pPng, &pInfo, nullptr);
+		Report(USTR("ERROR: setjmp error\n\n"));
+		return false;
+	}
+	png_init_io(pPng, a_fp);
+	png_read_info(pPng, pInfo);
+	a_uWidth = png_get_image_width(pPng, pInfo);
+	a_uHeight = png_get_image_height(pPng, pInfo);
+	n32 nColorType = png_get_color_type(pPng, pInfo);
+	if (a_pIndex != nullptr)
+	{
+		a_pIndex->clear();
+	}
+	if (a_pIndex != nullptr && a_pPalette != nullptr && nColorType == PNG_COLOR_TYPE_PALETTE)
+	{
+		// keep the raw indices of an indexed png, the rgba image is expanded from its palette
+		png_colorp pPalette = nullptr;
+		n32 nPaletteCount = 0;
+		png_get_PLTE(pPng, pInfo, &pPalette, &nPaletteCount);
+		png_bytep pTrans = nullptr;
+		n32 nTransCount = 0;
+		if (png_get_valid(pPng, pInfo, PNG_INFO_tRNS) != 0)
+		{
+			png_get_tRNS(pPng, pInfo, &pTrans, &nTransCount, nullptr);
+		}
+		a_pPalette->assign(256 * 4, 0);
+		for (n32 i = 0; i < nPaletteCount && i < 256; i++)
+		{
+			(*a_pPalette)[i * 4] = pPalette[i].red;
+			(*a_pPalette)[i * 4 + 1] = pPalette[i].green;
+			(*a_pPalette)[i * 4 + 2] = pPalette[i].blue;
+			(*a_pPalette)[i * 4 + 3] = i < nTransCount ? pTrans[i] : 0xFF;
+		}
+		png_set_packing(pPng);
+		png_read_update_info(pPng, pInfo);
+		a_pIndex->resize(a_uWidth * a_uHeight);
+		pRowPointers = new png_bytep[a_uHeight];
+		for (u32 i = 0; i < a_uHeight; i++)
+		{
+			pRowPointers[i] = &*a_pIndex->begin() + i * a_uWidth;
+		}
+		png_read_image(pPng, pRowPointers);
+		png_read_end(pPng, pInfo);
+		png_destroy_read_struct(&pPng, &pInfo, nullptr);
+		delete[] pRowPointers;
+		a_vRGBA.resize(a_uWidth * a_uHeight * 4);
+		for (u32 i = 0; i < a_uWidth * a_uHeight; i++)
+		{
+			memcpy(&*a_vRGBA.begin() + i * 4, &*a_pPalette->begin() + (*a_pIndex)[i] * 4, 4);
+		}
+		return true;
+	}
+	png_set_expand(pPng);
+	png_set_strip_16(pPng);
+	if (nColorType == PNG_COLOR_TYPE_GRAY || nColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+	{
+		png_set_gray_to_rgb(pPng);
+	}
+	if ((nColorType & PNG_COLOR_MASK_ALPHA) == 0 && png_get_valid(pPng, pInfo, PNG_INFO_tRNS) == 0)
+	{
+		png_set_add_alpha(pPng, 0xFF, PNG_FILLER_AFTER);
+	}
+	png_read_update_info(pPng, pInfo);
+	a_vRGBA.resize(a_uWidth * a_uHeight * 4);
+	pRowPointers = new png_bytep[a_uHeight];
+	for (u32 i = 0; i < a_uHeight; i++)
+	{
+		pRowPointers[i] = &*a_vRGBA.begin() + i * a_uWidth * 4;
+	}
+	png_read_image(pPng, pRowPointers);
+	png_read_end(pPng, pInfo);
+	png_destroy_read_struct(&pPng, &pInfo, nullptr);
+	delete[] pRowPointers;
+	return true;
+}
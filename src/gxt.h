@@ -2,6 +2,14 @@
 #define GXT_H_
 
 #include <sdw.h>
+#include <mutex>
+#include "archive.h"
+#include "blockfile.h"
+#include "encodecache.h"
+#include "mipmap.h"
+#include "patcher.h"
+#include "pngwriter.h"
+#include "quantizer.h"
 
 namespace pvrtexture
 {
@@ -719,8 +727,12 @@ namespace sce
 
 		// /host_tools/graphics/src/sce_texture/texture_libraries/sce_texture_core/common/swizzle.h
 
+		u32 getMortonNumber(u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight);
+
 		void deSwizzleLevel(u8* a_pTgt, const u8* a_pSrc, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp);
 
+		void swizzleLevel(u8* a_pTgt, const u8* a_pSrc, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp);
+
 		namespace Gxt
 		{
 
@@ -728,10 +740,30 @@ namespace sce
 
 			bool getTextureDataSize(u32& a_uSize, u32 a_uWidth, u32 a_uHeight, u32 a_uNumLevels, u32 a_uNumFaces, SceGxmTextureFormat a_eFormat, SceGxmTextureType a_eType);
 
+			struct Level
+			{
+				u32 m_face;
+				u32 m_level;
+				u32 m_offset;
+				u32 m_width;
+				u32 m_height;
+				u32 m_widthEx;
+				u32 m_heightEx;
+				u32 m_size;
+			};
+
+			bool getLevels(vector<Level>& a_vLevel, u32 a_uWidth, u32 a_uHeight, u32 a_uNumLevels, u32 a_uNumFaces, SceGxmTextureFormat a_eFormat, SceGxmTextureType a_eType);
+
+			u32 getBlockWidth(SceGxmTextureFormat a_eFormat);
+
+			u32 getBlockHeight(SceGxmTextureFormat a_eFormat);
+
 			bool getBorderDataSize(u32& a_uSize, u32 a_uWidth, u32 a_uHeight, SceGxmTextureFormat a_eFormat);
 
 			bool getBpp(u32& a_uBpp, SceGxmTextureFormat a_eFormat);
 
+			bool lookupBpp(u32& a_uBpp, SceGxmTextureFormat a_eFormat);
+
 			bool isPvr(SceGxmTextureFormat a_eFormat);
 
 			bool isUbc(SceGxmTextureFormat a_eFormat);
@@ -779,23 +811,174 @@ namespace sce
 class CGxt
 {
 public:
+	enum EQuality
+	{
+		kQualityFast,
+		kQualityHigh
+	};
+	enum EFormat
+	{
+		kFormatPng,
+		kFormatDds,
+		kFormatKtx,
+		kFormatPvr,
+		kFormatRaw
+	};
+	enum EArchive
+	{
+		kArchiveNone,
+		kArchiveTar,
+		kArchiveZip
+	};
 	CGxt();
 	~CGxt();
 	void SetFileName(const UString& a_sFileName);
 	void SetDirName(const UString& a_sDirName);
 	void SetVerbose(bool a_bVerbose);
+	void SetQuality(EQuality a_eQuality);
+	void SetDither(CQuantizer::EDither a_eDither);
+	void SetMipFilter(CMipmap::EFilter a_eMipFilter);
+	void SetIncremental(bool a_bIncremental);
+	void SetCacheDirName(const UString& a_sCacheDirName);
+	void SetCacheMaxSize(u64 a_uCacheMaxSize);
+	void SetPatch(bool a_bPatch);
+	void SetAllLevels(bool a_bAllLevels);
+	void SetPngRGBA(bool a_bPngRGBA);
+	void SetFormat(EFormat a_eFormat);
+	void SetRawPack(bool a_bRawPack);
+	void SetArchive(EArchive a_eArchive);
+	void SetRect(u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight);
+	void SetThumbnail(u32 a_uThumbnail);
+	void SetTestTop(u32 a_uTestTop);
+	void SetTestSheet(bool a_bTestSheet);
+	void SetPngEncoder(CPngWriter::EEncoder a_ePngEncoder);
+	void SetPngLevel(n32 a_nPngLevel);
+	void SetPngFilter(CPngWriter::EFilter a_ePngFilter);
+	void SetPngStrategy(CPngWriter::EStrategy a_ePngStrategy);
 	bool ExportFile();
 	bool ImportFile();
 	bool TestPalette();
 	static bool IsGxtFile(const UString& a_sFileName);
+	static bool PrintInfo(const UString& a_sFileName);
+	static bool GetInfo(const UString& a_sFileName, UString& a_sInfo);
+	bool ParseBuffer(const u8* a_pGxt, u32 a_uGxtSize);
+	u32 GetTextureCount() const;
+	const sce::Texture::Gxt::Data* GetTexture(u32 a_uIndex) const;
+	bool GetLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, sce::Texture::Gxt::Level& a_Level) const;
+	bool DecodeLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, u8* a_pRGBA, u32 a_uStride);
+	bool EncodeLevel(u32 a_uIndex, u32 a_uFace, u32 a_uLevel, const u8* a_pRGBA, u32 a_uStride);
+	const vector<u8>& GetGxt() const;
+	bool GetThumbnail(u32 a_uIndex, u32 a_uThumbnail, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight);
+	bool GetRect(u32 a_uIndex, u32 a_uFace, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, vector<u8>& a_vRGBA, u32& a_uRectWidth, u32& a_uRectHeight);
+	static void SetErrorSink(string* a_pErrorSink);
+	static void Report(const UString& a_sMessage);
 private:
+	struct SManifest
+	{
+		bool Valid;
+		u32 Format;
+		u64 PngHash;
+		u64 DataHash;
+	};
+	struct SPaletteScore
+	{
+		u32 Palette;
+		f64 Score;
+	};
+	bool parse(const u8* a_pGxt, u32 a_uGxtSize);
+	static const UChar* getFormatName(SceGxmTextureFormat a_eFormat);
+	static const UChar* getTypeName(SceGxmTextureType a_eType);
+	static void buildPaletteBank(const u8* a_pPalette, u32 a_uCount, u32 a_uSize, vector<u32>& a_vBank);
+	static u32 countPaletteBank(const vector<u32>& a_vBank);
+	int encode(sce::Texture::Gxt::Data* a_pData, const u8* a_pRGBA, n32 a_nWidth, n32 a_nHeight, u32 a_uBpp, u8* a_pLinear);
 	static int decode(sce::Texture::Gxt::Data* a_pData, u8* a_pLinear, n32 a_nWidth, n32 a_nHeight, u32 a_uBpp, pvrtexture::CPVRTexture** a_pPVRTexture);
+	bool exportTextures();
+	bool openExport();
+	bool exportThumbnail();
+	bool writeThumbnail(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level);
+	static u32 getThumbnailLevel(u32 a_uWidth, u32 a_uHeight, u32 a_uNumLevels, u32 a_uThumbnail);
+	bool makeThumbnail(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uThumbnail, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight);
+	bool exportLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level);
+	bool exportRaw(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u64 a_uOffset);
+	void writeRawJson(FILE* a_fp, u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const char* a_pSeparator) const;
+	bool decodeLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vRGBA);
+	bool decodeRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, vector<u8>& a_vRGBA);
+	void loadLinearRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u32 a_uX, u32 a_uY, u32 a_uWidth, u32 a_uHeight, u8* a_pLinear) const;
+	bool exportRect(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level);
+	bool exportBlock(u32 a_uIndex, CBlockFile::EContainer a_eContainer, CBlockFile::EFormat a_eBlockFormat);
+	static bool getBlockFormat(SceGxmTextureFormat a_eFormat, CBlockFile::EFormat& a_eBlockFormat);
+	UString getLevelFileName(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const UChar* a_pExtension) const;
+	bool writePng(const UString& a_sPngFileName, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride);
+	FILE* openOutput(const UString& a_sFileName);
+	bool closeOutput(FILE* a_fp, const UString& a_sFileName, bool a_bResult, u64 a_uSize = UINT64_MAX);
+	static bool readPng(FILE* a_fp, vector<u8>& a_vRGBA, u32& a_uWidth, u32& a_uHeight, vector<u8>* a_pIndex = nullptr, vector<u8>* a_pPalette = nullptr);
+	bool loadLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vRGBA, bool& a_bFound, vector<u8>* a_pIndex = nullptr, vector<u8>* a_pPalette = nullptr) const;
+	void loadLinear(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, u8* a_pLinear) const;
+	UString getPngFileName(u32 a_uIndex, u32 a_uFace) const;
+	bool getPngHash(u32 a_uIndex, u64& a_uHash) const;
+	u64 getDataHash(u32 a_uIndex) const;
+	bool isUnchanged(u32 a_uIndex, u64 a_uPngHash) const;
+	void updateManifest(u32 a_uIndex, u64 a_uPngHash);
+	void loadManifest();
+	bool saveManifest() const;
+	bool writeGxt(const u8* a_pGxt, u32 a_uGxtSize) const;
+	void storeLevel(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const u8* a_pLinear, u8* a_pGxt);
+	void getIndex(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vIndex) const;
+	void setIndex(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, u8* a_pGxt);
+	static bool getPaletteOrder(SceGxmTextureFormat a_eFormat, n32* a_pOrder, bool& a_bOpaque);
+	static bool getGrayLayout(SceGxmTextureFormat a_eFormat, u32& a_uChannelCount, n32& a_nBitDepth, bool& a_bSigned);
+	void getGray(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, vector<u8>& a_vGray) const;
+	static void addIndexStatistics(const vector<u8>& a_vIndex, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u32 a_uColorCount, vector<f64>& a_vUsage, vector<f64>& a_vPair);
+	static f64 scorePalette(const u8* a_pPalette, u32 a_uColorCount, const vector<f64>& a_vUsage, const vector<f64>& a_vPair);
+	void getTestPalette(u32 a_uIndex, u32 a_uPalette, vector<u8>& a_vPalette) const;
+	bool writeTestPalette(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, u32 a_uPalette);
+	bool writeTestSheet(u32 a_uIndex, const sce::Texture::Gxt::Level& a_Level, const vector<u8>& a_vIndex, const vector<SPaletteScore>& a_vScore, u32 a_uTestCount);
+	static void decodeBC4(const u8* a_pBlock, u32 a_uWidth, u32 a_uHeight, u8* a_pGray);
+	void addKey(CEncodeCache::CKeyBuilder& a_KeyBuilder, u32 a_uIndex) const;
+	void storeData(u32 a_uIndex, const u8* a_pData, u8* a_pGxt);
+	n32 importTexture(u8* a_pGxt, u32 a_uIndex);
+	void generateMipmap(u32 a_uIndex, const vector<sce::Texture::Gxt::Level>& a_vLevel, u32 a_uFace, const vector<u8>& a_vRGBA, vector<vector<u8>>& a_vMipmap) const;
+	bool importIndexed(u8* a_pGxt, vector<CPatcher::SRange>& a_vRange);
+	n32 importPalette(u8* a_pGxt, u8* a_pPalette, u32 a_uColorCount, u32 a_uPaletteOffset, const vector<u32>& a_vTexture);
 	UString m_sFileName;
 	UString m_sDirName;
 	bool m_bVerbose;
+	EQuality m_eQuality;
+	CQuantizer::EDither m_eDither;
+	CMipmap::EFilter m_eMipFilter;
+	bool m_bIncremental;
+	bool m_bPatch;
+	bool m_bAllLevels;
+	bool m_bPngRGBA;
+	EFormat m_eFormat;
+	bool m_bRawPack;
+	FILE* m_fpRawPack;
+	mutex m_RawPackMutex;
+	EArchive m_eArchive;
+	CArchive m_Archive;
+	u32 m_uTestTop;
+	bool m_bTestSheet;
+	bool m_bRect;
+	u32 m_uRectX;
+	u32 m_uRectY;
+	u32 m_uRectWidth;
+	u32 m_uRectHeight;
+	u32 m_uThumbnail;
+	vector<u8> m_vGxt;
 	vector<sce::Texture::Gxt::Data> m_vData;
+	vector<u32> m_vTextureDataOffset;
 	vector<sce::Texture::Gxt::Palette16> m_vPalette16;
 	vector<sce::Texture::Gxt::Palette256> m_vPalette256;
+	u32 m_uPalette16Offset;
+	u32 m_uPalette256Offset;
+	vector<SManifest> m_vManifest;
+	CEncodeCache m_EncodeCache;
+	CPngWriter m_PngWriter;
+	static const UString s_sManifestFileName;
+	static const UString s_sRawPackFileName;
+	static const u32 s_uRawPackAlignment;
+	static const UString s_sPaletteRankFileName;
+	static const u32 s_uTestSheetSpacing;
 };
 
 #endif	// GXT_H_
@@ -1,14 +1,41 @@
 #include "gxttool.h"
-#include "gxt.h"
+#include "carver.h"
+#include "server.h"
+#include "threadpool.h"
 
 CGxtTool::SOption CGxtTool::s_Option[] =
 {
 	{ USTR("export"), USTR('e'), USTR("export from the target file") },
 	{ USTR("import"), USTR('i'), USTR("import to the target file") },
 	{ USTR("check"), USTR('c'), USTR("check if the target file is a gxt file") },
-	{ USTR("test-palette"), 0, USTR("test all palette") },
+	{ USTR("info"), 0, USTR("print the header and texture infos of the target file as json, the texture data is not read") },
+	{ USTR("carve"), 0, USTR("find every gxt embedded in the target file and extract each to the dir as offset.gxt") },
+	{ USTR("serve"), 0, USTR("serve info, export, thumbnail and rect requests on the unix socket until a stop request, parsed files stay cached between requests") },
+	{ USTR("serve-jobs"), 0, USTR("the number of requests served at the same time, 0 for all cores, default 0") },
+	{ USTR("test-palette"), 0, USTR("test all palette, every palette is ranked in palette_rank.txt and only the best are saved as i_f_test_pn.png") },
+	{ USTR("test-top"), 0, USTR("the number of best palettes saved for each texture by test-palette, 0 for all, default 3") },
+	{ USTR("test-sheet"), 0, USTR("save the best palettes of each texture face in one contact sheet i_f_test_sheet.png, in rank order row by row") },
 	{ USTR("file"), USTR('f'), USTR("the target file") },
 	{ USTR("dir"), USTR('d'), USTR("the dir for the target file") },
+	{ USTR("format"), 0, USTR("the export format, png, dds, ktx, pvr or raw, dds, ktx and pvr save each block compressed texture as i.dds, i.ktx or i.pvr with every level and face and other textures as png, raw saves each level as tightly packed rgba8 in i_f.rgba with an i_f.json sidecar, default png") },
+	{ USTR("raw-pack"), 0, USTR("save every raw level in one textures.rgba with the offset table in textures.json, levels are 64-byte aligned") },
+	{ USTR("rect"), 0, USTR("export only the rect x,y,w,h of level 0 of every texture as an rgba i_f_rect.png, the rect is clipped to each texture") },
+	{ USTR("thumbnail"), 0, USTR("export only a thumbnail of every texture as an rgba i_thumbnail.png whose longer side is at most n, made from the smallest mip level not below n, only that level is read") },
+	{ USTR("archive"), 0, USTR("save the export as one outputdir.tar or outputdir.zip instead of a dir, tar or zip") },
+	{ USTR("all-levels"), 0, USTR("export every mip level, level n of face f of texture i is saved as i_f_n.png") },
+	{ USTR("png-rgba"), 0, USTR("export every texture as an rgba png, indexed textures are saved as palette pngs and single or dual channel textures as gray pngs by default") },
+	{ USTR("png-encoder"), 0, USTR("the png encoder for export, libpng or fast, fast ignores the other png options, default libpng") },
+	{ USTR("png-level"), 0, USTR("the zlib level for export, 0 to 9, default 6") },
+	{ USTR("png-filter"), 0, USTR("the png row filter for export, none, sub, up, average, paeth or adaptive, default adaptive") },
+	{ USTR("png-strategy"), 0, USTR("the zlib strategy for export, default, filtered, huffman, rle or fixed, default default") },
+	{ USTR("quality"), 0, USTR("the encode quality for import, fast or high, default high") },
+	{ USTR("dither"), 0, USTR("the dither for palette import, none, ordered or diffusion, default none") },
+	{ USTR("mip-filter"), 0, USTR("the filter to rebuild the mipmaps of every imported level 0 on import, none, box, kaiser or lanczos, none keeps the stored mipmaps, default none") },
+	{ USTR("incremental"), 0, USTR("only import textures whose png changed since the last import, tracked in the dir") },
+	{ USTR("patch"), 0, USTR("write only the changed ranges in place, guarded by a journal") },
+	{ USTR("cache-dir"), 0, USTR("the dir of the encode cache shared between imports, disabled by default") },
+	{ USTR("cache-size"), 0, USTR("the size limit of the encode cache in MB, 0 for no limit, default 1024") },
+	{ USTR("threads"), 0, USTR("the number of worker threads, 0 for all cores, default 0") },
 	{ USTR("verbose"), USTR('v'), USTR("show the info") },
 	{ USTR("help"), USTR('h'), USTR("show this help") },
 	{ nullptr, 0, nullptr }
@@ -16,6 +43,31 @@ CGxtTool::SOption CGxtTool::s_Option[] =
 
 CGxtTool::CGxtTool()
 	: m_eAction(kActionNone)
+	, m_eQuality(CGxt::kQualityHigh)
+	, m_eDither(CQuantizer::kDitherNone)
+	, m_eMipFilter(CMipmap::kFilterNone)
+	, m_uThreadCount(0)
+	, m_uCacheSize(1024)
+	, m_bIncremental(false)
+	, m_bPatch(false)
+	, m_bAllLevels(false)
+	, m_bPngRGBA(false)
+	, m_eFormat(CGxt::kFormatPng)
+	, m_bRawPack(false)
+	, m_eArchive(CGxt::kArchiveNone)
+	, m_uTestTop(3)
+	, m_bTestSheet(false)
+	, m_bRect(false)
+	, m_uRectX(0)
+	, m_uRectY(0)
+	, m_uRectWidth(0)
+	, m_uRectHeight(0)
+	, m_uThumbnail(0)
+	, m_uServeJobCount(0)
+	, m_ePngEncoder(CPngWriter::kEncoderLibpng)
+	, m_nPngLevel(6)
+	, m_ePngFilter(CPngWriter::kFilterAdaptive)
+	, m_ePngStrategy(CPngWriter::kStrategyDefault)
 	, m_bVerbose(false)
 {
 }
@@ -92,21 +144,21 @@ int CGxtTool::CheckOptions()
 		UPrintf(USTR("ERROR: nothing to do\n\n"));
 		return 1;
 	}
-	if (m_eAction != kActionHelp)
+	if (m_eAction != kActionHelp && m_eAction != kActionServe)
 	{
 		if (m_sFileName.empty())
 		{
 			UPrintf(USTR("ERROR: no --file option\n\n"));
 			return 1;
 		}
-		if (m_eAction != kActionCheck)
+		if (m_eAction != kActionCheck && m_eAction != kActionInfo)
 		{
 			if (m_sDirName.empty())
 			{
 				UPrintf(USTR("ERROR: no --dir option\n\n"));
 				return 1;
 			}
-			if (!CGxt::IsGxtFile(m_sFileName))
+			if (m_eAction != kActionCarve && !CGxt::IsGxtFile(m_sFileName))
 			{
 				UPrintf(USTR("ERROR: %") PRIUS USTR(" is not a gxt file\n\n"), m_sFileName.c_str());
 				return 1;
@@ -122,9 +174,26 @@ int CGxtTool::Help()
 	UPrintf(USTR("usage: gxttool [option...] [option]...\n"));
 	UPrintf(USTR("sample:\n"));
 	UPrintf(USTR("  gxttool -evfd input.gxt outputdir\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --all-levels\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --png-level 1 --png-filter up\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --png-encoder fast\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --format dds\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --format raw --raw-pack --all-levels\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --all-levels --archive zip\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --rect 64,64,128,128\n"));
+	UPrintf(USTR("  gxttool -evfd input.gxt outputdir --thumbnail 128\n"));
 	UPrintf(USTR("  gxttool -ivfd output.gxt inputdir\n"));
+	UPrintf(USTR("  gxttool -ivfd output.gxt inputdir --quality fast --threads 4\n"));
+	UPrintf(USTR("  gxttool -ivfd output.gxt inputdir --mip-filter box\n"));
+	UPrintf(USTR("  gxttool -ivfd output.gxt inputdir --cache-dir cachedir\n"));
+	UPrintf(USTR("  gxttool -ivfd output.gxt inputdir --incremental --patch\n"));
 	UPrintf(USTR("  gxttool -cf input.bin\n"));
+	UPrintf(USTR("  gxttool --info -f input.gxt\n"));
+	UPrintf(USTR("  gxttool --carve -vfd input.bin outputdir\n"));
+	UPrintf(USTR("  gxttool --serve /tmp/gxttool.sock -v --serve-jobs 4\n"));
 	UPrintf(USTR("  gxttool --test-palette -vfd input.gxt testdir\n"));
+	UPrintf(USTR("  gxttool --test-palette -vfd input.gxt testdir --test-top 10\n"));
+	UPrintf(USTR("  gxttool --test-palette -vfd input.gxt testdir --test-top 0 --test-sheet\n"));
 	UPrintf(USTR("\n"));
 	UPrintf(USTR("option:\n"));
 	SOption* pOption = s_Option;
@@ -159,6 +228,7 @@ int CGxtTool::Help()
 
 int CGxtTool::Action()
 {
+	CThreadPool::SetThreadCount(m_uThreadCount);
 	if (m_eAction == kActionExport)
 	{
 		if (!exportFile())
@@ -182,6 +252,33 @@ int CGxtTool::Action()
 			return 1;
 		}
 	}
+	if (m_eAction == kActionInfo)
+	{
+		if (!CGxt::PrintInfo(m_sFileName))
+		{
+			return 1;
+		}
+	}
+	if (m_eAction == kActionCarve)
+	{
+		if (!CCarver::Extract(m_sFileName, m_sDirName, m_bVerbose))
+		{
+			UPrintf(USTR("ERROR: carve file failed\n\n"));
+			return 1;
+		}
+	}
+	if (m_eAction == kActionServe)
+	{
+		CServer server;
+		server.SetSocketName(m_sSocketName);
+		server.SetJobCount(m_uServeJobCount);
+		server.SetVerbose(m_bVerbose);
+		if (!server.Run())
+		{
+			UPrintf(USTR("ERROR: serve failed\n\n"));
+			return 1;
+		}
+	}
 	if (m_eAction == kActionTestPalette)
 	{
 		if (!testPalette())
@@ -232,6 +329,52 @@ CGxtTool::EParseOptionReturn CGxtTool::parseOptions(const UChar* a_pName, int& a
 			return kParseOptionReturnOptionConflict;
 		}
 	}
+	else if (UCscmp(a_pName, USTR("info")) == 0)
+	{
+		if (m_eAction == kActionNone)
+		{
+			m_eAction = kActionInfo;
+		}
+		else if (m_eAction != kActionInfo && m_eAction != kActionHelp)
+		{
+			return kParseOptionReturnOptionConflict;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("carve")) == 0)
+	{
+		if (m_eAction == kActionNone)
+		{
+			m_eAction = kActionCarve;
+		}
+		else if (m_eAction != kActionCarve && m_eAction != kActionHelp)
+		{
+			return kParseOptionReturnOptionConflict;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("serve")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		if (m_eAction == kActionNone)
+		{
+			m_eAction = kActionServe;
+		}
+		else if (m_eAction != kActionServe && m_eAction != kActionHelp)
+		{
+			return kParseOptionReturnOptionConflict;
+		}
+		m_sSocketName = a_pArgv[++a_nIndex];
+	}
+	else if (UCscmp(a_pName, USTR("serve-jobs")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_uServeJobCount = SToU32(a_pArgv[++a_nIndex]);
+	}
 	else if (UCscmp(a_pName, USTR("test-palette")) == 0)
 	{
 		if (m_eAction == kActionNone)
@@ -259,6 +402,327 @@ CGxtTool::EParseOptionReturn CGxtTool::parseOptions(const UChar* a_pName, int& a
 		}
 		m_sDirName = a_pArgv[++a_nIndex];
 	}
+	else if (UCscmp(a_pName, USTR("format")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sFormat = a_pArgv[++a_nIndex];
+		if (sFormat == USTR("png"))
+		{
+			m_eFormat = CGxt::kFormatPng;
+		}
+		else if (sFormat == USTR("dds"))
+		{
+			m_eFormat = CGxt::kFormatDds;
+		}
+		else if (sFormat == USTR("ktx"))
+		{
+			m_eFormat = CGxt::kFormatKtx;
+		}
+		else if (sFormat == USTR("pvr"))
+		{
+			m_eFormat = CGxt::kFormatPvr;
+		}
+		else if (sFormat == USTR("raw"))
+		{
+			m_eFormat = CGxt::kFormatRaw;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("raw-pack")) == 0)
+	{
+		m_bRawPack = true;
+	}
+	else if (UCscmp(a_pName, USTR("test-top")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_uTestTop = SToU32(a_pArgv[++a_nIndex]);
+	}
+	else if (UCscmp(a_pName, USTR("test-sheet")) == 0)
+	{
+		m_bTestSheet = true;
+	}
+	else if (UCscmp(a_pName, USTR("rect")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sRect = a_pArgv[++a_nIndex];
+		u32 uRect[4] = {};
+		UString::size_type uPos = 0;
+		for (n32 i = 0; i < 4; i++)
+		{
+			UString::size_type uEnd = i < 3 ? sRect.find(USTR(','), uPos) : sRect.size();
+			if (uEnd == UString::npos || uEnd == uPos || sRect.find_first_not_of(USTR("0123456789"), uPos) < uEnd)
+			{
+				return kParseOptionReturnIllegalOption;
+			}
+			uRect[i] = SToU32(sRect.substr(uPos, uEnd - uPos));
+			uPos = uEnd + 1;
+		}
+		if (uRect[2] == 0 || uRect[3] == 0)
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+		m_bRect = true;
+		m_uRectX = uRect[0];
+		m_uRectY = uRect[1];
+		m_uRectWidth = uRect[2];
+		m_uRectHeight = uRect[3];
+	}
+	else if (UCscmp(a_pName, USTR("thumbnail")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_uThumbnail = SToU32(a_pArgv[++a_nIndex]);
+		if (m_uThumbnail == 0)
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("archive")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sArchive = a_pArgv[++a_nIndex];
+		if (sArchive == USTR("tar"))
+		{
+			m_eArchive = CGxt::kArchiveTar;
+		}
+		else if (sArchive == USTR("zip"))
+		{
+			m_eArchive = CGxt::kArchiveZip;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("all-levels")) == 0)
+	{
+		m_bAllLevels = true;
+	}
+	else if (UCscmp(a_pName, USTR("png-rgba")) == 0)
+	{
+		m_bPngRGBA = true;
+	}
+	else if (UCscmp(a_pName, USTR("png-encoder")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sPngEncoder = a_pArgv[++a_nIndex];
+		if (sPngEncoder == USTR("libpng"))
+		{
+			m_ePngEncoder = CPngWriter::kEncoderLibpng;
+		}
+		else if (sPngEncoder == USTR("fast"))
+		{
+			m_ePngEncoder = CPngWriter::kEncoderFast;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("png-level")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_nPngLevel = SToN32(a_pArgv[++a_nIndex]);
+		if (m_nPngLevel < 0 || m_nPngLevel > 9)
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("png-filter")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sPngFilter = a_pArgv[++a_nIndex];
+		if (sPngFilter == USTR("none"))
+		{
+			m_ePngFilter = CPngWriter::kFilterNone;
+		}
+		else if (sPngFilter == USTR("sub"))
+		{
+			m_ePngFilter = CPngWriter::kFilterSub;
+		}
+		else if (sPngFilter == USTR("up"))
+		{
+			m_ePngFilter = CPngWriter::kFilterUp;
+		}
+		else if (sPngFilter == USTR("average"))
+		{
+			m_ePngFilter = CPngWriter::kFilterAverage;
+		}
+		else if (sPngFilter == USTR("paeth"))
+		{
+			m_ePngFilter = CPngWriter::kFilterPaeth;
+		}
+		else if (sPngFilter == USTR("adaptive"))
+		{
+			m_ePngFilter = CPngWriter::kFilterAdaptive;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("png-strategy")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sPngStrategy = a_pArgv[++a_nIndex];
+		if (sPngStrategy == USTR("default"))
+		{
+			m_ePngStrategy = CPngWriter::kStrategyDefault;
+		}
+		else if (sPngStrategy == USTR("filtered"))
+		{
+			m_ePngStrategy = CPngWriter::kStrategyFiltered;
+		}
+		else if (sPngStrategy == USTR("huffman"))
+		{
+			m_ePngStrategy = CPngWriter::kStrategyHuffmanOnly;
+		}
+		else if (sPngStrategy == USTR("rle"))
+		{
+			m_ePngStrategy = CPngWriter::kStrategyRle;
+		}
+		else if (sPngStrategy == USTR("fixed"))
+		{
+			m_ePngStrategy = CPngWriter::kStrategyFixed;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("quality")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sQuality = a_pArgv[++a_nIndex];
+		if (sQuality == USTR("fast"))
+		{
+			m_eQuality = CGxt::kQualityFast;
+		}
+		else if (sQuality == USTR("high"))
+		{
+			m_eQuality = CGxt::kQualityHigh;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("dither")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sDither = a_pArgv[++a_nIndex];
+		if (sDither == USTR("none"))
+		{
+			m_eDither = CQuantizer::kDitherNone;
+		}
+		else if (sDither == USTR("ordered"))
+		{
+			m_eDither = CQuantizer::kDitherOrdered;
+		}
+		else if (sDither == USTR("diffusion"))
+		{
+			m_eDither = CQuantizer::kDitherDiffusion;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("mip-filter")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		UString sMipFilter = a_pArgv[++a_nIndex];
+		if (sMipFilter == USTR("none"))
+		{
+			m_eMipFilter = CMipmap::kFilterNone;
+		}
+		else if (sMipFilter == USTR("box"))
+		{
+			m_eMipFilter = CMipmap::kFilterBox;
+		}
+		else if (sMipFilter == USTR("kaiser"))
+		{
+			m_eMipFilter = CMipmap::kFilterKaiser;
+		}
+		else if (sMipFilter == USTR("lanczos"))
+		{
+			m_eMipFilter = CMipmap::kFilterLanczos;
+		}
+		else
+		{
+			return kParseOptionReturnIllegalOption;
+		}
+	}
+	else if (UCscmp(a_pName, USTR("incremental")) == 0)
+	{
+		m_bIncremental = true;
+	}
+	else if (UCscmp(a_pName, USTR("patch")) == 0)
+	{
+		m_bPatch = true;
+	}
+	else if (UCscmp(a_pName, USTR("cache-dir")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_sCacheDirName = a_pArgv[++a_nIndex];
+	}
+	else if (UCscmp(a_pName, USTR("cache-size")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_uCacheSize = SToU32(a_pArgv[++a_nIndex]);
+	}
+	else if (UCscmp(a_pName, USTR("threads")) == 0)
+	{
+		if (a_nIndex + 1 >= a_nArgc)
+		{
+			return kParseOptionReturnNoArgument;
+		}
+		m_uThreadCount = SToU32(a_pArgv[++a_nIndex]);
+	}
 	else if (UCscmp(a_pName, USTR("verbose")) == 0)
 	{
 		m_bVerbose = true;
@@ -288,6 +752,20 @@ bool CGxtTool::exportFile()
 	gxt.SetFileName(m_sFileName);
 	gxt.SetDirName(m_sDirName);
 	gxt.SetVerbose(m_bVerbose);
+	gxt.SetAllLevels(m_bAllLevels);
+	gxt.SetPngRGBA(m_bPngRGBA);
+	gxt.SetFormat(m_eFormat);
+	gxt.SetRawPack(m_bRawPack);
+	gxt.SetArchive(m_eArchive);
+	if (m_bRect)
+	{
+		gxt.SetRect(m_uRectX, m_uRectY, m_uRectWidth, m_uRectHeight);
+	}
+	gxt.SetThumbnail(m_uThumbnail);
+	gxt.SetPngEncoder(m_ePngEncoder);
+	gxt.SetPngLevel(m_nPngLevel);
+	gxt.SetPngFilter(m_ePngFilter);
+	gxt.SetPngStrategy(m_ePngStrategy);
 	return gxt.ExportFile();
 }
 
@@ -297,6 +775,13 @@ bool CGxtTool::importFile()
 	gxt.SetFileName(m_sFileName);
 	gxt.SetDirName(m_sDirName);
 	gxt.SetVerbose(m_bVerbose);
+	gxt.SetQuality(m_eQuality);
+	gxt.SetDither(m_eDither);
+	gxt.SetMipFilter(m_eMipFilter);
+	gxt.SetIncremental(m_bIncremental);
+	gxt.SetPatch(m_bPatch);
+	gxt.SetCacheDirName(m_sCacheDirName);
+	gxt.SetCacheMaxSize(static_cast<u64>(m_uCacheSize) * 1024 * 1024);
 	return gxt.ImportFile();
 }
 
@@ -306,6 +791,8 @@ bool CGxtTool::testPalette()
 	gxt.SetFileName(m_sFileName);
 	gxt.SetDirName(m_sDirName);
 	gxt.SetVerbose(m_bVerbose);
+	gxt.SetTestTop(m_uTestTop);
+	gxt.SetTestSheet(m_bTestSheet);
 	return gxt.TestPalette();
 }
 
@@ -2,6 +2,7 @@
 #define GXTTOOL_H_
 
 #include <sdw.h>
+#include "gxt.h"
 
 class CGxtTool
 {
@@ -20,6 +21,9 @@ public:
 		kActionImport,
 		kActionCheck,
 		kActionTestPalette,
+		kActionInfo,
+		kActionCarve,
+		kActionServe,
 		kActionHelp
 	};
 	struct SOption
@@ -44,6 +48,33 @@ private:
 	EAction m_eAction;
 	UString m_sFileName;
 	UString m_sDirName;
+	CGxt::EQuality m_eQuality;
+	CQuantizer::EDither m_eDither;
+	CMipmap::EFilter m_eMipFilter;
+	u32 m_uThreadCount;
+	UString m_sCacheDirName;
+	u32 m_uCacheSize;
+	bool m_bIncremental;
+	bool m_bPatch;
+	bool m_bAllLevels;
+	bool m_bPngRGBA;
+	CGxt::EFormat m_eFormat;
+	bool m_bRawPack;
+	CGxt::EArchive m_eArchive;
+	u32 m_uTestTop;
+	bool m_bTestSheet;
+	bool m_bRect;
+	u32 m_uRectX;
+	u32 m_uRectY;
+	u32 m_uRectWidth;
+	u32 m_uRectHeight;
+	u32 m_uThumbnail;
+	UString m_sSocketName;
+	u32 m_uServeJobCount;
+	CPngWriter::EEncoder m_ePngEncoder;
+	n32 m_nPngLevel;
+	CPngWriter::EFilter m_ePngFilter;
+	CPngWriter::EStrategy m_ePngStrategy;
 	bool m_bVerbose;
 };
 
@@ -0,0 +1,30 @@
+#include "hash.h"
+
+const u64 CHash::s_uFnvOffsetBasis = 0xCBF29CE484222325ULL;
+const u64 CHash::s_uFnvPrime = 0x100000001B3ULL;
+
+u64 CHash::Fnv1a64(const void* a_pData, size_t a_uSize, u64 a_uHash)
+{
+	const u8* pData = static_cast<const u8*>(a_pData);
+	for (size_t i = 0; i < a_uSize; i++)
+	{
+		a_uHash ^= pData[i];
+		a_uHash *= s_uFnvPrime;
+	}
+	return a_uHash;
+}
+
+bool CHash::File(FILE* a_fp, u64& a_uHash)
+{
+	static const size_t c_uBufferSize = 0x10000;
+	vector<u8> vBuffer(c_uBufferSize);
+	fseek(a_fp, 0, SEEK_SET);
+	size_t uSize = 0;
+	while ((uSize = fread(&*vBuffer.begin(), 1, c_uBufferSize, a_fp)) != 0)
+	{
+		a_uHash = Fnv1a64(&*vBuffer.begin(), uSize, a_uHash);
+	}
+	bool bResult = ferror(a_fp) == 0;
+	fseek(a_fp, 0, SEEK_SET);
+	return bResult;
+}
@@ -0,0 +1,15 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <sdw.h>
+
+class CHash
+{
+public:
+	static u64 Fnv1a64(const void* a_pData, size_t a_uSize, u64 a_uHash = s_uFnvOffsetBasis);
+	static bool File(FILE* a_fp, u64& a_uHash);
+	static const u64 s_uFnvOffsetBasis;
+	static const u64 s_uFnvPrime;
+};
+
+#endif	// HASH_H_
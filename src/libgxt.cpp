@@ -0,0 +1,172 @@
+#include "libgxt.h"
+#include "gxt.h"
+
+struct gxt_context
+{
+	CGxt Gxt;
+	mutable string Error;
+};
+
+// the messages of one call replace the ones of the previous call
+struct SErrorScope
+{
+	SErrorScope(const gxt_context* a_pContext)
+	{
+		if (a_pContext != nullptr)
+		{
+			a_pContext->Error.clear();
+			CGxt::SetErrorSink(&a_pContext->Error);
+		}
+	}
+	~SErrorScope()
+	{
+		CGxt::SetErrorSink(nullptr);
+	}
+};
+
+static gxt_result checkBuffer(const gxt_context* a_pContext, uint32_t a_uTexture, uint32_t a_uFace, uint32_t a_uLevel, const void* a_pRGBA, uint32_t a_uStride, size_t a_uSize, sce::Texture::Gxt::Level& a_Level)
+{
+	if (a_pContext == nullptr || a_pRGBA == nullptr)
+	{
+		return GXT_ERROR_ARGUMENT;
+	}
+	if (!a_pContext->Gxt.GetLevel(a_uTexture, a_uFace, a_uLevel, a_Level))
+	{
+		return GXT_ERROR_RANGE;
+	}
+	const sce::Texture::Gxt::Data* pData = a_pContext->Gxt.GetTexture(a_uTexture);
+	u64 uWidth = std::max<u32>(pData->m_width >> a_uLevel, 1);
+	u64 uHeight = std::max<u32>(pData->m_height >> a_uLevel, 1);
+	if (a_uStride < uWidth * 4 || a_uSize < (uHeight - 1) * a_uStride + uWidth * 4)
+	{
+		return GXT_ERROR_BUFFER;
+	}
+	return GXT_OK;
+}
+
+gxt_result gxt_open(const void* data, size_t size, gxt_context** context)
+{
+	if (data == nullptr || context == nullptr || size > UINT32_MAX)
+	{
+		return GXT_ERROR_ARGUMENT;
+	}
+	*context = nullptr;
+	gxt_context* pContext = new (nothrow) gxt_context;
+	if (pContext == nullptr)
+	{
+		return GXT_ERROR_MEMORY;
+	}
+	// the context is returned even when the parsing fails, it keeps the reason
+	*context = pContext;
+	SErrorScope errorScope(pContext);
+	return pContext->Gxt.ParseBuffer(static_cast<const u8*>(data), static_cast<u32>(size)) ? GXT_OK : GXT_ERROR_PARSE;
+}
+
+void gxt_close(gxt_context* context)
+{
+	delete context;
+}
+
+uint32_t gxt_get_texture_count(const gxt_context* context)
+{
+	return context != nullptr ? context->Gxt.GetTextureCount() : 0;
+}
+
+gxt_result gxt_get_texture_info(const gxt_context* context, uint32_t texture, gxt_texture_info* info)
+{
+	SErrorScope errorScope(context);
+	if (context == nullptr || info == nullptr)
+	{
+		return GXT_ERROR_ARGUMENT;
+	}
+	const sce::Texture::Gxt::Data* pData = context->Gxt.GetTexture(texture);
+	if (pData == nullptr)
+	{
+		return GXT_ERROR_RANGE;
+	}
+	const SceGxtHeader* pSceGxtHeader = reinterpret_cast<const SceGxtHeader*>(&*context->Gxt.GetGxt().begin());
+	const SceGxtTextureInfo* pSceGxtTextureInfo = reinterpret_cast<const SceGxtTextureInfo*>(pSceGxtHeader + 1) + texture;
+	info->format = pData->m_format;
+	info->type = pData->m_type;
+	info->width = pData->m_width;
+	info->height = pData->m_height;
+	info->levels = pData->m_numLevels;
+	info->faces = pData->m_type == SCE_GXM_TEXTURE_CUBE ? 6 : 1;
+	info->palette_index = pSceGxtTextureInfo->paletteIndex == UINT32_MAX ? -1 : static_cast<int32_t>(pSceGxtTextureInfo->paletteIndex);
+	info->data_offset = pSceGxtTextureInfo->dataOffset;
+	info->data_size = pSceGxtTextureInfo->dataSize;
+	return GXT_OK;
+}
+
+gxt_result gxt_get_level_info(const gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, gxt_level_info* info)
+{
+	SErrorScope errorScope(context);
+	if (context == nullptr || info == nullptr)
+	{
+		return GXT_ERROR_ARGUMENT;
+	}
+	sce::Texture::Gxt::Level sceLevel;
+	if (!context->Gxt.GetLevel(texture, face, level, sceLevel))
+	{
+		return GXT_ERROR_RANGE;
+	}
+	const sce::Texture::Gxt::Data* pData = context->Gxt.GetTexture(texture);
+	info->width = std::max<u32>(pData->m_width >> level, 1);
+	info->height = std::max<u32>(pData->m_height >> level, 1);
+	info->stored_width = sceLevel.m_widthEx;
+	info->stored_height = sceLevel.m_heightEx;
+	info->offset = sceLevel.m_offset;
+	info->size = sceLevel.m_size;
+	return GXT_OK;
+}
+
+gxt_result gxt_decode_level(gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, void* rgba, uint32_t stride, size_t size)
+{
+	SErrorScope errorScope(context);
+	sce::Texture::Gxt::Level sceLevel;
+	gxt_result eResult = checkBuffer(context, texture, face, level, rgba, stride, size, sceLevel);
+	if (eResult != GXT_OK)
+	{
+		return eResult;
+	}
+	return context->Gxt.DecodeLevel(texture, face, level, static_cast<u8*>(rgba), stride) ? GXT_OK : GXT_ERROR_DECODE;
+}
+
+gxt_result gxt_encode_level(gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, const void* rgba, uint32_t stride, size_t size)
+{
+	SErrorScope errorScope(context);
+	sce::Texture::Gxt::Level sceLevel;
+	gxt_result eResult = checkBuffer(context, texture, face, level, rgba, stride, size, sceLevel);
+	if (eResult != GXT_OK)
+	{
+		return eResult;
+	}
+	return context->Gxt.EncodeLevel(texture, face, level, static_cast<const u8*>(rgba), stride) ? GXT_OK : GXT_ERROR_ENCODE;
+}
+
+gxt_result gxt_set_quality(gxt_context* context, int quality)
+{
+	SErrorScope errorScope(context);
+	if (context == nullptr || (quality != 0 && quality != 1))
+	{
+		return GXT_ERROR_ARGUMENT;
+	}
+	context->Gxt.SetQuality(quality == 0 ? CGxt::kQualityFast : CGxt::kQualityHigh);
+	return GXT_OK;
+}
+
+const void* gxt_get_data(const gxt_context* context, size_t* size)
+{
+	if (context == nullptr || size == nullptr)
+	{
+		return nullptr;
+	}
+	const vector<u8>& vGxt = context->Gxt.GetGxt();
+	*size = vGxt.size();
+	return &*vGxt.begin();
+}
+
+const char* gxt_get_error(const gxt_context* context)
+{
+	return context != nullptr ? context->Error.c_str() : "";
+}
@@ -0,0 +1,88 @@
+#ifndef LIBGXT_H_
+#define LIBGXT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(LIBGXT_EXPORTS)
+#define GXT_API __declspec(dllexport)
+#elif defined(LIBGXT_SHARED)
+#define GXT_API __declspec(dllimport)
+#else
+#define GXT_API
+#endif
+#elif defined(__GNUC__) && __GNUC__ >= 4
+#define GXT_API __attribute__((visibility("default")))
+#else
+#define GXT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a context owns a copy of one gxt file, it is not shared between threads
+typedef struct gxt_context gxt_context;
+
+typedef enum gxt_result
+{
+	GXT_OK = 0,
+	GXT_ERROR_ARGUMENT = 1,
+	GXT_ERROR_PARSE = 2,
+	GXT_ERROR_RANGE = 3,
+	GXT_ERROR_BUFFER = 4,
+	GXT_ERROR_DECODE = 5,
+	GXT_ERROR_ENCODE = 6,
+	GXT_ERROR_MEMORY = 7
+} gxt_result;
+
+typedef struct gxt_texture_info
+{
+	uint32_t format;
+	uint32_t type;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t faces;
+	// -1 when the texture is not indexed
+	int32_t palette_index;
+	uint32_t data_offset;
+	uint32_t data_size;
+} gxt_texture_info;
+
+typedef struct gxt_level_info
+{
+	uint32_t width;
+	uint32_t height;
+	// the padded size the level is stored with
+	uint32_t stored_width;
+	uint32_t stored_height;
+	// relative to the data offset of the texture
+	uint32_t offset;
+	uint32_t size;
+} gxt_level_info;
+
+// data is copied, it can be freed as soon as gxt_open returns
+// on GXT_ERROR_PARSE the context is still returned for gxt_get_error, close it as usual
+GXT_API gxt_result gxt_open(const void* data, size_t size, gxt_context** context);
+GXT_API void gxt_close(gxt_context* context);
+GXT_API uint32_t gxt_get_texture_count(const gxt_context* context);
+GXT_API gxt_result gxt_get_texture_info(const gxt_context* context, uint32_t texture, gxt_texture_info* info);
+GXT_API gxt_result gxt_get_level_info(const gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, gxt_level_info* info);
+// rgba8 rows of width * 4 bytes, stride bytes apart, size is the size of the whole buffer
+GXT_API gxt_result gxt_decode_level(gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, void* rgba, uint32_t stride, size_t size);
+// indexed levels are mapped to the palette of the texture, the other levels are encoded to the texture format
+GXT_API gxt_result gxt_encode_level(gxt_context* context, uint32_t texture, uint32_t face, uint32_t level, const void* rgba, uint32_t stride, size_t size);
+// 0 for fast, 1 for high, the default is high
+GXT_API gxt_result gxt_set_quality(gxt_context* context, int quality);
+// the file with every encoded level, valid until the next encode or close
+GXT_API const void* gxt_get_data(const gxt_context* context, size_t* size);
+// the messages of the last call on the context, empty when it reported none, valid until the next call
+GXT_API const char* gxt_get_error(const gxt_context* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// LIBGXT_H_
@@ -0,0 +1,269 @@
+#include "mipmap.h"
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIPMAP_USE_SSE 1
+#else
+#define MIPMAP_USE_SSE 0
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_USE_SSE2 1
+#else
+#define MIPMAP_USE_SSE2 0
+#endif
+
+f32 CMipmap::s_fToLinear[256];
+u8 CMipmap::s_uToSRGB[4096];
+bool CMipmap::s_bTableReady = CMipmap::initTable();
+
+static const f32 s_fPi = 3.14159265358979f;
+
+static f32 sinc(f32 a_fX)
+{
+	if (fabs(a_fX) < 1e-6f)
+	{
+		return 1.0f;
+	}
+	return sin(s_fPi * a_fX) / (s_fPi * a_fX);
+}
+
+static f32 besselI0(f32 a_fX)
+{
+	f32 fSum = 1.0f;
+	f32 fTerm = 1.0f;
+	for (n32 i = 1; i < 32; i++)
+	{
+		fTerm *= (a_fX * 0.5f / i) * (a_fX * 0.5f / i);
+		fSum += fTerm;
+		if (fTerm < fSum * 1e-7f)
+		{
+			break;
+		}
+	}
+	return fSum;
+}
+
+void CMipmap::Resize(const u8* a_pSrc, u32 a_uSrcWidth, u32 a_uSrcHeight, u8* a_pDst, u32 a_uDstWidth, u32 a_uDstHeight, EFilter a_eFilter)
+{
+	vector<SContribution> vContributionX;
+	vector<SContribution> vContributionY;
+	getContribution(a_uSrcWidth, a_uDstWidth, a_eFilter, vContributionX);
+	getContribution(a_uSrcHeight, a_uDstHeight, a_eFilter, vContributionY);
+	// filter premultiplied linear light, one pixel is one 4-float vector
+	vector<f32> vSrc(a_uSrcWidth * a_uSrcHeight * 4);
+	for (u32 i = 0; i < a_uSrcWidth * a_uSrcHeight; i++)
+	{
+		f32 fAlpha = a_pSrc[i * 4 + 3] / 255.0f;
+		vSrc[i * 4] = s_fToLinear[a_pSrc[i * 4]] * fAlpha;
+		vSrc[i * 4 + 1] = s_fToLinear[a_pSrc[i * 4 + 1]] * fAlpha;
+		vSrc[i * 4 + 2] = s_fToLinear[a_pSrc[i * 4 + 2]] * fAlpha;
+		vSrc[i * 4 + 3] = fAlpha;
+	}
+	vector<f32> vTemp(a_uDstWidth * a_uSrcHeight * 4);
+	for (u32 y = 0; y < a_uSrcHeight; y++)
+	{
+		const f32* pRow = &*vSrc.begin() + y * a_uSrcWidth * 4;
+		for (u32 x = 0; x < a_uDstWidth; x++)
+		{
+			const SContribution& contribution = vContributionX[x];
+			f32* pTemp = &*vTemp.begin() + (y * a_uDstWidth + x) * 4;
+#if MIPMAP_USE_SSE
+			__m128 vSum = _mm_setzero_ps();
+			for (u32 i = 0; i < static_cast<u32>(contribution.Weight.size()); i++)
+			{
+				vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_set1_ps(contribution.Weight[i]), _mm_loadu_ps(pRow + (contribution.Begin + i) * 4)));
+			}
+			_mm_storeu_ps(pTemp, vSum);
+#else
+			f32 fSum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (u32 i = 0; i < static_cast<u32>(contribution.Weight.size()); i++)
+			{
+				for (n32 j = 0; j < 4; j++)
+				{
+					fSum[j] += contribution.Weight[i] * pRow[(contribution.Begin + i) * 4 + j];
+				}
+			}
+			memcpy(pTemp, fSum, sizeof(fSum));
+#endif
+		}
+	}
+	for (u32 y = 0; y < a_uDstHeight; y++)
+	{
+		const SContribution& contribution = vContributionY[y];
+		for (u32 x = 0; x < a_uDstWidth; x++)
+		{
+			f32 fSum[4];
+#if MIPMAP_USE_SSE
+			__m128 vSum = _mm_setzero_ps();
+			for (u32 i = 0; i < static_cast<u32>(contribution.Weight.size()); i++)
+			{
+				vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_set1_ps(contribution.Weight[i]), _mm_loadu_ps(&*vTemp.begin() + ((contribution.Begin + i) * a_uDstWidth + x) * 4)));
+			}
+			_mm_storeu_ps(fSum, vSum);
+#else
+			fSum[0] = fSum[1] = fSum[2] = fSum[3] = 0.0f;
+			for (u32 i = 0; i < static_cast<u32>(contribution.Weight.size()); i++)
+			{
+				for (n32 j = 0; j < 4; j++)
+				{
+					fSum[j] += contribution.Weight[i] * vTemp[((contribution.Begin + i) * a_uDstWidth + x) * 4 + j];
+				}
+			}
+#endif
+			u8* pDst = a_pDst + (y * a_uDstWidth + x) * 4;
+			f32 fAlpha = std::min<f32>(std::max<f32>(fSum[3], 0.0f), 1.0f);
+			for (n32 j = 0; j < 3; j++)
+			{
+				f32 fValue = fAlpha > 0.0f ? fSum[j] / fAlpha : 0.0f;
+				fValue = std::min<f32>(std::max<f32>(fValue, 0.0f), 1.0f);
+				pDst[j] = s_uToSRGB[static_cast<u32>(fValue * 4095.0f + 0.5f)];
+			}
+			pDst[3] = static_cast<u8>(fAlpha * 255.0f + 0.5f);
+		}
+	}
+}
+
+// a plain 2x2 box in gamma space, the destination is max(w / 2, 1) by max(h / 2, 1),
+// an odd last row or column is dropped and a single one is used twice
+void CMipmap::Halve(const u8* a_pSrc, u32 a_uSrcWidth, u32 a_uSrcHeight, u8* a_pDst)
+{
+	u32 uDstWidth = std::max<u32>(a_uSrcWidth / 2, 1);
+	u32 uDstHeight = std::max<u32>(a_uSrcHeight / 2, 1);
+	for (u32 y = 0; y < uDstHeight; y++)
+	{
+		const u8* pRow0 = a_pSrc + std::min<u32>(y * 2, a_uSrcHeight - 1) * a_uSrcWidth * 4;
+		const u8* pRow1 = a_pSrc + std::min<u32>(y * 2 + 1, a_uSrcHeight - 1) * a_uSrcWidth * 4;
+		u8* pDst = a_pDst + y * uDstWidth * 4;
+		u32 x = 0;
+#if MIPMAP_USE_SSE2
+		// 4 source pixels of both rows to 2 destination pixels, summed in 16 bits
+		const __m128i nZero = _mm_setzero_si128();
+		const __m128i nRound = _mm_set1_epi16(2);
+		for (; a_uSrcWidth > 1 && x + 2 <= uDstWidth; x += 2)
+		{
+			__m128i nRow0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 8));
+			__m128i nRow1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 8));
+			__m128i nLow = _mm_add_epi16(_mm_unpacklo_epi8(nRow0, nZero), _mm_unpacklo_epi8(nRow1, nZero));
+			__m128i nHigh = _mm_add_epi16(_mm_unpackhi_epi8(nRow0, nZero), _mm_unpackhi_epi8(nRow1, nZero));
+			nLow = _mm_add_epi16(nLow, _mm_srli_si128(nLow, 8));
+			nHigh = _mm_add_epi16(nHigh, _mm_srli_si128(nHigh, 8));
+			__m128i nSum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(nLow, nHigh), nRound), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + x * 4), _mm_packus_epi16(nSum, nZero));
+		}
+#endif
+		for (; x < uDstWidth; x++)
+		{
+			u32 uX0 = std::min<u32>(x * 2, a_uSrcWidth - 1) * 4;
+			u32 uX1 = std::min<u32>(x * 2 + 1, a_uSrcWidth - 1) * 4;
+			for (n32 i = 0; i < 4; i++)
+			{
+				pDst[x * 4 + i] = static_cast<u8>((pRow0[uX0 + i] + pRow0[uX1 + i] + pRow1[uX0 + i] + pRow1[uX1 + i] + 2) / 4);
+			}
+		}
+	}
+}
+
+bool CMipmap::initTable()
+{
+	for (n32 i = 0; i < 256; i++)
+	{
+		f32 fValue = i / 255.0f;
+		s_fToLinear[i] = fValue <= 0.04045f ? fValue / 12.92f : pow((fValue + 0.055f) / 1.055f, 2.4f);
+	}
+	for (n32 i = 0; i < 4096; i++)
+	{
+		f32 fValue = i / 4095.0f;
+		fValue = fValue <= 0.0031308f ? fValue * 12.92f : 1.055f * pow(fValue, 1.0f / 2.4f) - 0.055f;
+		s_uToSRGB[i] = static_cast<u8>(std::min<f32>(std::max<f32>(fValue, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+	return true;
+}
+
+f32 CMipmap::filter(EFilter a_eFilter, f32 a_fX)
+{
+	f32 fRadius = getRadius(a_eFilter);
+	a_fX = fabs(a_fX);
+	if (a_fX >= fRadius)
+	{
+		return 0.0f;
+	}
+	switch (a_eFilter)
+	{
+	case kFilterKaiser:
+		{
+			static const f32 c_fAlpha = 4.0f;
+			f32 fT = a_fX / fRadius;
+			return sinc(a_fX) * besselI0(c_fAlpha * sqrt(1.0f - fT * fT)) / besselI0(c_fAlpha);
+		}
+	case kFilterLanczos:
+		return sinc(a_fX) * sinc(a_fX / fRadius);
+	default:
+		return 1.0f;
+	}
+}
+
+f32 CMipmap::getRadius(EFilter a_eFilter)
+{
+	switch (a_eFilter)
+	{
+	case kFilterKaiser:
+	case kFilterLanczos:
+		return 3.0f;
+	default:
+		return 0.5f;
+	}
+}
+
+void CMipmap::getContribution(u32 a_uSrcSize, u32 a_uDstSize, EFilter a_eFilter, vector<SContribution>& a_vContribution)
+{
+	f32 fScale = static_cast<f32>(a_uSrcSize) / a_uDstSize;
+	f32 fStretch = std::max<f32>(fScale, 1.0f);
+	f32 fSupport = getRadius(a_eFilter) * fStretch;
+	a_vContribution.resize(a_uDstSize);
+	for (u32 i = 0; i < a_uDstSize; i++)
+	{
+		f32 fCenter = (i + 0.5f) * fScale;
+		n32 nBegin = static_cast<n32>(floor(fCenter - fSupport));
+		n32 nEnd = static_cast<n32>(ceil(fCenter + fSupport));
+		// taps outside the image are clamped to the edge texel
+		n32 nLow = std::max<n32>(std::min<n32>(nBegin, a_uSrcSize - 1), 0);
+		n32 nHigh = std::min<n32>(std::max<n32>(nEnd, 0), a_uSrcSize - 1);
+		vector<f32> vWeight(nHigh - nLow + 1, 0.0f);
+		f32 fTotal = 0.0f;
+		for (n32 j = nBegin; j <= nEnd; j++)
+		{
+			f32 fWeight = filter(a_eFilter, (j + 0.5f - fCenter) / fStretch);
+			if (fWeight == 0.0f)
+			{
+				continue;
+			}
+			n32 nIndex = std::min<n32>(std::max<n32>(j, nLow), nHigh);
+			vWeight[nIndex - nLow] += fWeight;
+			fTotal += fWeight;
+		}
+		if (fTotal == 0.0f)
+		{
+			n32 nIndex = std::min<n32>(std::max<n32>(static_cast<n32>(fCenter), nLow), nHigh);
+			vWeight[nIndex - nLow] = 1.0f;
+			fTotal = 1.0f;
+		}
+		n32 nFirst = 0;
+		n32 nLast = nHigh - nLow;
+		while (nFirst < nLast && vWeight[nFirst] == 0.0f)
+		{
+			nFirst++;
+		}
+		while (nLast > nFirst && vWeight[nLast] == 0.0f)
+		{
+			nLast--;
+		}
+		SContribution& contribution = a_vContribution[i];
+		contribution.Begin = nLow + nFirst;
+		contribution.Weight.assign(vWeight.begin() + nFirst, vWeight.begin() + nLast + 1);
+		for (vector<f32>::iterator it = contribution.Weight.begin(); it != contribution.Weight.end(); ++it)
+		{
+			*it /= fTotal;
+		}
+	}
+}
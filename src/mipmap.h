@@ -0,0 +1,33 @@
+#ifndef MIPMAP_H_
+#define MIPMAP_H_
+
+#include <sdw.h>
+
+class CMipmap
+{
+public:
+	enum EFilter
+	{
+		kFilterNone,
+		kFilterBox,
+		kFilterKaiser,
+		kFilterLanczos
+	};
+	static void Resize(const u8* a_pSrc, u32 a_uSrcWidth, u32 a_uSrcHeight, u8* a_pDst, u32 a_uDstWidth, u32 a_uDstHeight, EFilter a_eFilter);
+	static void Halve(const u8* a_pSrc, u32 a_uSrcWidth, u32 a_uSrcHeight, u8* a_pDst);
+private:
+	struct SContribution
+	{
+		n32 Begin;
+		vector<f32> Weight;
+	};
+	static bool initTable();
+	static f32 filter(EFilter a_eFilter, f32 a_fX);
+	static f32 getRadius(EFilter a_eFilter);
+	static void getContribution(u32 a_uSrcSize, u32 a_uDstSize, EFilter a_eFilter, vector<SContribution>& a_vContribution);
+	static f32 s_fToLinear[256];
+	static u8 s_uToSRGB[4096];
+	static bool s_bTableReady;
+};
+
+#endif	// MIPMAP_H_
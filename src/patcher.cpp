@@ -0,0 +1,278 @@
+#include "patcher.h"
+#include "hash.h"
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const u32 CPatcher::s_uSignature = SDW_CONVERT_ENDIAN32('GXTJ');
+
+// differences closer than this are written as one span
+const u32 CPatcher::s_uMergeGap = 64;
+
+bool CPatcher::Patch(const UString& a_sFileName, const u8* a_pData, u32 a_uDataSize, vector<SRange>& a_vRange, bool a_bVerbose)
+{
+	FILE* fp = UFopen(a_sFileName.c_str(), USTR("r+b"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	u32 uFileSize = ftell(fp);
+	if (uFileSize != a_uDataSize)
+	{
+		fclose(fp);
+		UPrintf(USTR("ERROR: file size changed during import\n\n"));
+		return false;
+	}
+	sort(a_vRange.begin(), a_vRange.end(), [](const SRange& a_Lhs, const SRange& a_Rhs)
+	{
+		return a_Lhs.Offset < a_Rhs.Offset;
+	});
+	// compare against the bytes on disk and keep only the spans that really differ, the old
+	// bytes of each span go to the undo journal
+	vector<SSpan> vSpan;
+	vector<u8> vOld;
+	for (vector<SRange>::iterator it = a_vRange.begin(); it != a_vRange.end(); ++it)
+	{
+		if (it->Size == 0 || it->Offset + it->Size > a_uDataSize)
+		{
+			continue;
+		}
+		vOld.resize(it->Size);
+		fseek(fp, it->Offset, SEEK_SET);
+		if (fread(&*vOld.begin(), 1, it->Size, fp) != it->Size)
+		{
+			fclose(fp);
+			return false;
+		}
+		const u8* pNew = a_pData + it->Offset;
+		u32 uPos = 0;
+		while (uPos < it->Size)
+		{
+			if (vOld[uPos] == pNew[uPos])
+			{
+				uPos++;
+				continue;
+			}
+			u32 uBegin = uPos;
+			u32 uEnd = uPos + 1;
+			for (uPos = uEnd; uPos < it->Size && uPos < uEnd + s_uMergeGap; uPos++)
+			{
+				if (vOld[uPos] != pNew[uPos])
+				{
+					uEnd = uPos + 1;
+				}
+			}
+			uPos = uEnd;
+			u32 uOffset = it->Offset + uBegin;
+			if (!vSpan.empty() && vSpan.back().Offset + vSpan.back().Data.size() >= uOffset)
+			{
+				// overlapping ranges, extend the previous span with the bytes it does not cover yet
+				SSpan& span = vSpan.back();
+				u32 uSpanEnd = span.Offset + static_cast<u32>(span.Data.size());
+				if (it->Offset + uEnd > uSpanEnd)
+				{
+					span.Data.insert(span.Data.end(), vOld.begin() + (uSpanEnd - it->Offset), vOld.begin() + uEnd);
+				}
+				continue;
+			}
+			SSpan span;
+			span.Offset = uOffset;
+			span.Data.assign(vOld.begin() + uBegin, vOld.begin() + uEnd);
+			vSpan.push_back(span);
+		}
+	}
+	if (vSpan.empty())
+	{
+		fclose(fp);
+		return true;
+	}
+	UString sJournalFileName = getJournalFileName(a_sFileName);
+	if (!writeJournal(sJournalFileName, vSpan))
+	{
+		fclose(fp);
+		UPrintf(USTR("ERROR: write journal %") PRIUS USTR(" failed\n\n"), sJournalFileName.c_str());
+		return false;
+	}
+	u32 uPatchSize = 0;
+	bool bResult = true;
+	for (vector<SSpan>::iterator it = vSpan.begin(); it != vSpan.end(); ++it)
+	{
+		u32 uSize = static_cast<u32>(it->Data.size());
+		fseek(fp, it->Offset, SEEK_SET);
+		if (fwrite(a_pData + it->Offset, 1, uSize, fp) != uSize)
+		{
+			bResult = false;
+			break;
+		}
+		uPatchSize += uSize;
+	}
+	bResult = sync(fp) && bResult;
+	fclose(fp);
+	if (!bResult)
+	{
+		// leave the journal behind, the next import rolls the file back
+		UPrintf(USTR("ERROR: patch %") PRIUS USTR(" failed\n\n"), a_sFileName.c_str());
+		return false;
+	}
+	removeJournal(sJournalFileName);
+	if (a_bVerbose)
+	{
+		UPrintf(USTR("patch %u bytes in %u spans\n"), uPatchSize, static_cast<u32>(vSpan.size()));
+	}
+	return true;
+}
+
+bool CPatcher::Recover(const UString& a_sFileName)
+{
+	UString sJournalFileName = getJournalFileName(a_sFileName);
+	FILE* fp = UFopen(sJournalFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return true;
+	}
+	fclose(fp);
+	vector<SSpan> vSpan;
+	if (!readJournal(sJournalFileName, vSpan))
+	{
+		// the journal was not complete, so the file has not been touched yet
+		removeJournal(sJournalFileName);
+		return true;
+	}
+	fp = UFopen(a_sFileName.c_str(), USTR("r+b"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = true;
+	for (vector<SSpan>::iterator it = vSpan.begin(); it != vSpan.end(); ++it)
+	{
+		fseek(fp, it->Offset, SEEK_SET);
+		if (fwrite(&*it->Data.begin(), 1, it->Data.size(), fp) != it->Data.size())
+		{
+			bResult = false;
+			break;
+		}
+	}
+	bResult = sync(fp) && bResult;
+	fclose(fp);
+	if (!bResult)
+	{
+		UPrintf(USTR("ERROR: roll back %") PRIUS USTR(" failed\n\n"), a_sFileName.c_str());
+		return false;
+	}
+	removeJournal(sJournalFileName);
+	UPrintf(USTR("WARN: rolled back an interrupted patch of %") PRIUS USTR("\n\n"), a_sFileName.c_str());
+	return true;
+}
+
+UString CPatcher::getJournalFileName(const UString& a_sFileName)
+{
+	return a_sFileName + USTR(".journal");
+}
+
+void CPatcher::removeJournal(const UString& a_sJournalFileName)
+{
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	_wremove(a_sJournalFileName.c_str());
+#else
+	remove(a_sJournalFileName.c_str());
+#endif
+}
+
+bool CPatcher::sync(FILE* a_fp)
+{
+	if (fflush(a_fp) != 0)
+	{
+		return false;
+	}
+#if SDW_PLATFORM == SDW_PLATFORM_WINDOWS
+	return _commit(_fileno(a_fp)) == 0;
+#else
+	return fsync(fileno(a_fp)) == 0;
+#endif
+}
+
+// layout: signature, span count, spans of (offset, size, old bytes), then the signature and
+// the hash of everything before it, so a torn journal is recognised and ignored
+bool CPatcher::writeJournal(const UString& a_sJournalFileName, const vector<SSpan>& a_vSpan)
+{
+	vector<u8> vJournal;
+	u32 uHeader[2] = { s_uSignature, static_cast<u32>(a_vSpan.size()) };
+	vJournal.insert(vJournal.end(), reinterpret_cast<u8*>(uHeader), reinterpret_cast<u8*>(uHeader) + sizeof(uHeader));
+	for (vector<SSpan>::const_iterator it = a_vSpan.begin(); it != a_vSpan.end(); ++it)
+	{
+		u32 uSpan[2] = { it->Offset, static_cast<u32>(it->Data.size()) };
+		vJournal.insert(vJournal.end(), reinterpret_cast<u8*>(uSpan), reinterpret_cast<u8*>(uSpan) + sizeof(uSpan));
+		vJournal.insert(vJournal.end(), it->Data.begin(), it->Data.end());
+	}
+	u64 uHash = CHash::Fnv1a64(&*vJournal.begin(), vJournal.size());
+	vJournal.insert(vJournal.end(), reinterpret_cast<const u8*>(&s_uSignature), reinterpret_cast<const u8*>(&s_uSignature) + sizeof(s_uSignature));
+	vJournal.insert(vJournal.end(), reinterpret_cast<u8*>(&uHash), reinterpret_cast<u8*>(&uHash) + sizeof(uHash));
+	FILE* fp = UFopen(a_sJournalFileName.c_str(), USTR("wb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	bool bResult = fwrite(&*vJournal.begin(), 1, vJournal.size(), fp) == vJournal.size();
+	bResult = sync(fp) && bResult;
+	fclose(fp);
+	if (!bResult)
+	{
+		removeJournal(a_sJournalFileName);
+	}
+	return bResult;
+}
+
+bool CPatcher::readJournal(const UString& a_sJournalFileName, vector<SSpan>& a_vSpan)
+{
+	FILE* fp = UFopen(a_sJournalFileName.c_str(), USTR("rb"));
+	if (fp == nullptr)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	u32 uJournalSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	vector<u8> vJournal(uJournalSize);
+	bool bResult = uJournalSize >= 8 + 12 && fread(&*vJournal.begin(), 1, uJournalSize, fp) == uJournalSize;
+	fclose(fp);
+	if (!bResult)
+	{
+		return false;
+	}
+	u32 uBodySize = uJournalSize - 12;
+	u32 uSignature = 0;
+	u64 uHash = 0;
+	memcpy(&uSignature, &vJournal[uBodySize], sizeof(uSignature));
+	memcpy(&uHash, &vJournal[uBodySize + 4], sizeof(uHash));
+	u32 uHeader[2] = {};
+	memcpy(uHeader, &*vJournal.begin(), sizeof(uHeader));
+	if (uSignature != s_uSignature || uHeader[0] != s_uSignature || uHash != CHash::Fnv1a64(&*vJournal.begin(), uBodySize))
+	{
+		return false;
+	}
+	u32 uPos = sizeof(uHeader);
+	for (u32 i = 0; i < uHeader[1]; i++)
+	{
+		u32 uSpan[2] = {};
+		if (uPos + sizeof(uSpan) > uBodySize)
+		{
+			return false;
+		}
+		memcpy(uSpan, &vJournal[uPos], sizeof(uSpan));
+		uPos += sizeof(uSpan);
+		if (uSpan[1] > uBodySize - uPos)
+		{
+			return false;
+		}
+		SSpan span;
+		span.Offset = uSpan[0];
+		span.Data.assign(vJournal.begin() + uPos, vJournal.begin() + uPos + uSpan[1]);
+		a_vSpan.push_back(span);
+		uPos += uSpan[1];
+	}
+	return uPos == uBodySize;
+}
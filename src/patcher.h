@@ -0,0 +1,31 @@
+#ifndef PATCHER_H_
+#define PATCHER_H_
+
+#include <sdw.h>
+
+class CPatcher
+{
+public:
+	struct SRange
+	{
+		u32 Offset;
+		u32 Size;
+	};
+	static bool Patch(const UString& a_sFileName, const u8* a_pData, u32 a_uDataSize, vector<SRange>& a_vRange, bool a_bVerbose);
+	static bool Recover(const UString& a_sFileName);
+private:
+	struct SSpan
+	{
+		u32 Offset;
+		vector<u8> Data;
+	};
+	static UString getJournalFileName(const UString& a_sFileName);
+	static void removeJournal(const UString& a_sJournalFileName);
+	static bool sync(FILE* a_fp);
+	static bool writeJournal(const UString& a_sJournalFileName, const vector<SSpan>& a_vSpan);
+	static bool readJournal(const UString& a_sJournalFileName, vector<SSpan>& a_vSpan);
+	static const u32 s_uSignature;
+	static const u32 s_uMergeGap;
+};
+
+#endif	// PATCHER_H_
@@ -0,0 +1,416 @@
+#include "pngwriter.h"
+#include "fastpng.h"
+#include <png.h>
+#include "threadpool.h"
+#include <zlib.h>
+
+// images at least this large are deflated in independent bands on all threads
+const u32 CPngWriter::s_uParallelSize = 1024 * 1024;
+
+const u32 CPngWriter::s_uBandSize = 256 * 1024;
+
+const u32 CPngWriter::s_uWindowSize = 32 * 1024;
+
+CPngWriter::CPngWriter()
+	: m_eEncoder(kEncoderLibpng)
+	, m_nLevel(Z_DEFAULT_COMPRESSION)
+	, m_eFilter(kFilterAdaptive)
+	, m_eStrategy(kStrategyDefault)
+{
+}
+
+CPngWriter::~CPngWriter()
+{
+}
+
+void CPngWriter::SetEncoder(EEncoder a_eEncoder)
+{
+	m_eEncoder = a_eEncoder;
+}
+
+void CPngWriter::SetLevel(n32 a_nLevel)
+{
+	m_nLevel = a_nLevel;
+}
+
+void CPngWriter::SetFilter(EFilter a_eFilter)
+{
+	m_eFilter = a_eFilter;
+}
+
+void CPngWriter::SetStrategy(EStrategy a_eStrategy)
+{
+	m_eStrategy = a_eStrategy;
+}
+
+bool CPngWriter::Write(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride) const
+{
+	if (m_eEncoder == kEncoderFast)
+	{
+		return CFastPng::Write(a_fp, a_pRGBA, a_uWidth, a_uHeight, a_uStride);
+	}
+	if (static_cast<u64>(a_uWidth) * a_uHeight * 4 >= s_uParallelSize && CThreadPool::GetThreadCount() > 1)
+	{
+		return writeParallel(a_fp, a_pRGBA, a_uWidth, a_uHeight, a_uStride);
+	}
+	return writeLibpng(a_fp, a_pRGBA, a_uWidth, a_uHeight, a_uStride, PNG_COLOR_TYPE_RGB_ALPHA, 8, nullptr, 0);
+}
+
+// the index is one byte per texel, 16 colour palettes are packed to 4 bits by libpng
+bool CPngWriter::WriteIndexed(FILE* a_fp, const u8* a_pIndex, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, const u8* a_pPalette, u32 a_uColorCount) const
+{
+	return writeLibpng(a_fp, a_pIndex, a_uWidth, a_uHeight, a_uStride, PNG_COLOR_TYPE_PALETTE, a_uColorCount <= 16 ? 4 : 8, a_pPalette, a_uColorCount);
+}
+
+// one or two channels as they are stored, 16-bit samples are little endian
+bool CPngWriter::WriteGray(FILE* a_fp, const u8* a_pGray, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u32 a_uChannelCount, n32 a_nBitDepth) const
+{
+	return writeLibpng(a_fp, a_pGray, a_uWidth, a_uHeight, a_uStride, a_uChannelCount == 2 ? PNG_COLOR_TYPE_GRAY_ALPHA : PNG_COLOR_TYPE_GRAY, a_nBitDepth, nullptr, 0);
+}
+
+bool CPngWriter::writeLibpng(FILE* a_fp, const u8* a_pData, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, n32 a_nColorType, n32 a_nBitDepth, const u8* a_pPalette, u32 a_uColorCount) const
+{
+	png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (pPng == nullptr)
+	{
+		UPrintf(USTR("ERROR: png_create_write_struct error\n\n"));
+		return false;
+	}
+	png_infop pInfo = png_create_info_struct(pPng);
+	if (pInfo == nullptr)
+	{
+		png_destroy_write_struct(&pPng, nullptr);
+		UPrintf(USTR("ERROR: png_create_info_struct error\n\n"));
+		return false;
+	}
+	if (setjmp(png_jmpbuf(pPng)) != 0)
+	{
+		png_destroy_write_struct(&pPng, &pInfo);
+		UPrintf(USTR("ERROR: setjmp error\n\n"));
+		return false;
+	}
+	png_init_io(pPng, a_fp);
+	png_set_IHDR(pPng, pInfo, a_uWidth, a_uHeight, a_nBitDepth, a_nColorType, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	if (a_nColorType == PNG_COLOR_TYPE_PALETTE)
+	{
+		png_color color[256];
+		u8 uAlpha[256];
+		u32 uAlphaCount = 0;
+		for (u32 i = 0; i < a_uColorCount; i++)
+		{
+			color[i].red = a_pPalette[i * 4];
+			color[i].green = a_pPalette[i * 4 + 1];
+			color[i].blue = a_pPalette[i * 4 + 2];
+			uAlpha[i] = a_pPalette[i * 4 + 3];
+			if (uAlpha[i] != 0xFF)
+			{
+				uAlphaCount = i + 1;
+			}
+		}
+		png_set_PLTE(pPng, pInfo, color, a_uColorCount);
+		// trailing opaque entries are implied, an opaque palette needs no tRNS at all
+		if (uAlphaCount != 0)
+		{
+			png_set_tRNS(pPng, pInfo, uAlpha, uAlphaCount, nullptr);
+		}
+	}
+	png_set_compression_level(pPng, m_nLevel);
+	png_set_compression_strategy(pPng, getZlibStrategy());
+	switch (m_eFilter)
+	{
+	case kFilterNone:
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+		break;
+	case kFilterSub:
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+		break;
+	case kFilterUp:
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+		break;
+	case kFilterAverage:
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG);
+		break;
+	case kFilterPaeth:
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH);
+		break;
+	case kFilterAdaptive:
+		// like libpng's own default, indexed rows are not filtered
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, a_nColorType == PNG_COLOR_TYPE_PALETTE ? PNG_FILTER_NONE : PNG_ALL_FILTERS);
+		break;
+	}
+	// rows go straight from the decoded image to the compressor, no row table is built
+	png_write_info(pPng, pInfo);
+	if (a_nBitDepth < 8)
+	{
+		png_set_packing(pPng);
+	}
+	else if (a_nBitDepth == 16)
+	{
+		png_set_swap(pPng);
+	}
+	for (u32 i = 0; i < a_uHeight; i++)
+	{
+		png_write_row(pPng, a_pData + i * a_uStride);
+	}
+	png_write_end(pPng, pInfo);
+	png_destroy_write_struct(&pPng, &pInfo);
+	return true;
+}
+
+// pigz style: the filtered image is cut into bands that are deflated as separate raw streams, each
+// primed with the window before it and ended on a byte boundary, so that their concatenation is
+// one valid zlib stream
+bool CPngWriter::writeParallel(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride) const
+{
+	u32 uRowSize = a_uWidth * 4 + 1;
+	u32 uBandHeight = std::max<u32>(s_uBandSize / uRowSize, 1);
+	u32 uBandCount = (a_uHeight + uBandHeight - 1) / uBandHeight;
+	vector<u8> vFiltered(static_cast<size_t>(uRowSize) * a_uHeight);
+	CThreadPool::ParallelFor(uBandCount, [&](u32 a_uBand)
+	{
+		u32 uEnd = std::min<u32>((a_uBand + 1) * uBandHeight, a_uHeight);
+		// the adaptive trials of every row in the band share one scratch row
+		vector<u8> vScratch(m_eFilter == kFilterAdaptive ? uRowSize : 0);
+		for (u32 i = a_uBand * uBandHeight; i < uEnd; i++)
+		{
+			filterRow(a_pRGBA + i * a_uStride, i == 0 ? nullptr : a_pRGBA + (i - 1) * a_uStride, a_uWidth * 4, &vFiltered[static_cast<size_t>(i) * uRowSize], vScratch.empty() ? nullptr : &*vScratch.begin());
+		}
+	});
+	vector<vector<u8>> vBand(uBandCount);
+	vector<uLong> vAdler(uBandCount, 0);
+	vector<u8> vResult(uBandCount, 0);
+	CThreadPool::ParallelFor(uBandCount, [&](u32 a_uBand)
+	{
+		size_t uBegin = static_cast<size_t>(a_uBand) * uBandHeight * uRowSize;
+		size_t uEnd = std::min<size_t>(uBegin + static_cast<size_t>(uBandHeight) * uRowSize, vFiltered.size());
+		z_stream stream = {};
+		if (deflateInit2(&stream, m_nLevel, Z_DEFLATED, -15, 8, getZlibStrategy()) != Z_OK)
+		{
+			return;
+		}
+		if (uBegin != 0)
+		{
+			size_t uWindow = std::min<size_t>(uBegin, s_uWindowSize);
+			deflateSetDictionary(&stream, &vFiltered[uBegin - uWindow], static_cast<uInt>(uWindow));
+		}
+		vector<u8>& vData = vBand[a_uBand];
+		vData.resize(deflateBound(&stream, static_cast<uLong>(uEnd - uBegin)) + 16);
+		stream.next_in = &vFiltered[uBegin];
+		stream.avail_in = static_cast<uInt>(uEnd - uBegin);
+		stream.next_out = &*vData.begin();
+		stream.avail_out = static_cast<uInt>(vData.size());
+		n32 nResult = deflate(&stream, a_uBand + 1 == uBandCount ? Z_FINISH : Z_FULL_FLUSH);
+		if ((a_uBand + 1 == uBandCount ? nResult == Z_STREAM_END : nResult == Z_OK) && stream.avail_in == 0)
+		{
+			vData.resize(vData.size() - stream.avail_out);
+			vAdler[a_uBand] = adler32(adler32(0, nullptr, 0), &vFiltered[uBegin], static_cast<uInt>(uEnd - uBegin));
+			vResult[a_uBand] = 1;
+		}
+		deflateEnd(&stream);
+	});
+	uLong uAdler = adler32(0, nullptr, 0);
+	for (u32 i = 0; i < uBandCount; i++)
+	{
+		if (vResult[i] == 0)
+		{
+			UPrintf(USTR("ERROR: deflate error\n\n"));
+			return false;
+		}
+		size_t uBegin = static_cast<size_t>(i) * uBandHeight * uRowSize;
+		size_t uEnd = std::min<size_t>(uBegin + static_cast<size_t>(uBandHeight) * uRowSize, vFiltered.size());
+		uAdler = adler32_combine(uAdler, vAdler[i], static_cast<z_off_t>(uEnd - uBegin));
+	}
+	if (!WriteHeader(a_fp, a_uWidth, a_uHeight))
+	{
+		return false;
+	}
+	// zlib header with the level hint that zlib itself would write
+	n32 nLevelFlag = m_nLevel == Z_DEFAULT_COMPRESSION || m_nLevel == 6 ? 2 : (m_nLevel < 2 ? 0 : (m_nLevel < 6 ? 1 : 3));
+	u32 uZlibHeader = 0x7800 | nLevelFlag << 6;
+	uZlibHeader += (31 - uZlibHeader % 31) % 31;
+	vBand.front().insert(vBand.front().begin(), static_cast<u8>(uZlibHeader >> 8));
+	vBand.front().insert(vBand.front().begin() + 1, static_cast<u8>(uZlibHeader));
+	for (n32 i = 0; i < 4; i++)
+	{
+		vBand.back().push_back(static_cast<u8>(uAdler >> (24 - i * 8)));
+	}
+	for (vector<vector<u8>>::iterator it = vBand.begin(); it != vBand.end(); ++it)
+	{
+		if (!it->empty() && !WriteChunk(a_fp, "IDAT", &*it->begin(), static_cast<u32>(it->size())))
+		{
+			return false;
+		}
+	}
+	return WriteChunk(a_fp, "IEND", nullptr, 0);
+}
+
+void CPngWriter::filterRow(const u8* a_pRow, const u8* a_pPrevRow, u32 a_uSize, u8* a_pFiltered, u8* a_pScratch) const
+{
+	switch (m_eFilter)
+	{
+	case kFilterNone:
+		filterRow(PNG_FILTER_VALUE_NONE, a_pRow, a_pPrevRow, a_uSize, a_pFiltered);
+		break;
+	case kFilterSub:
+		filterRow(PNG_FILTER_VALUE_SUB, a_pRow, a_pPrevRow, a_uSize, a_pFiltered);
+		break;
+	case kFilterUp:
+		filterRow(PNG_FILTER_VALUE_UP, a_pRow, a_pPrevRow, a_uSize, a_pFiltered);
+		break;
+	case kFilterAverage:
+		filterRow(PNG_FILTER_VALUE_AVG, a_pRow, a_pPrevRow, a_uSize, a_pFiltered);
+		break;
+	case kFilterPaeth:
+		filterRow(PNG_FILTER_VALUE_PAETH, a_pRow, a_pPrevRow, a_uSize, a_pFiltered);
+		break;
+	case kFilterAdaptive:
+		{
+			// the usual heuristic: keep the filter with the smallest sum of absolute values,
+			// the best row and the trial row swap between the output and the scratch row
+			u8* pBest = a_pFiltered;
+			u8* pTrial = a_pScratch;
+			u64 uBestSum = UINT64_MAX;
+			for (n32 nFilter = PNG_FILTER_VALUE_NONE; nFilter <= PNG_FILTER_VALUE_PAETH; nFilter++)
+			{
+				filterRow(nFilter, a_pRow, a_pPrevRow, a_uSize, pTrial);
+				u64 uSum = 0;
+				for (u32 i = 1; i <= a_uSize; i++)
+				{
+					uSum += abs(static_cast<n8>(pTrial[i]));
+				}
+				if (uSum < uBestSum)
+				{
+					uBestSum = uSum;
+					swap(pBest, pTrial);
+				}
+			}
+			if (pBest != a_pFiltered)
+			{
+				memcpy(a_pFiltered, pBest, a_uSize + 1);
+			}
+		}
+		break;
+	}
+}
+
+n32 CPngWriter::getZlibStrategy() const
+{
+	switch (m_eStrategy)
+	{
+	case kStrategyFiltered:
+		return Z_FILTERED;
+	case kStrategyHuffmanOnly:
+		return Z_HUFFMAN_ONLY;
+	case kStrategyRle:
+		return Z_RLE;
+	case kStrategyFixed:
+		return Z_FIXED;
+	default:
+		return Z_DEFAULT_STRATEGY;
+	}
+}
+
+// one loop per filter, the first pixel has no left neighbour and the first row no upper one
+void CPngWriter::filterRow(n32 a_nFilter, const u8* a_pRow, const u8* a_pPrevRow, u32 a_uSize, u8* a_pFiltered)
+{
+	a_pFiltered[0] = static_cast<u8>(a_nFilter);
+	u8* pOut = a_pFiltered + 1;
+	u32 uLeftSize = std::min<u32>(a_uSize, 4);
+	switch (a_nFilter)
+	{
+	case PNG_FILTER_VALUE_SUB:
+		memcpy(pOut, a_pRow, uLeftSize);
+		for (u32 i = uLeftSize; i < a_uSize; i++)
+		{
+			pOut[i] = static_cast<u8>(a_pRow[i] - a_pRow[i - 4]);
+		}
+		break;
+	case PNG_FILTER_VALUE_UP:
+		if (a_pPrevRow == nullptr)
+		{
+			memcpy(pOut, a_pRow, a_uSize);
+			break;
+		}
+		for (u32 i = 0; i < a_uSize; i++)
+		{
+			pOut[i] = static_cast<u8>(a_pRow[i] - a_pPrevRow[i]);
+		}
+		break;
+	case PNG_FILTER_VALUE_AVG:
+		if (a_pPrevRow == nullptr)
+		{
+			memcpy(pOut, a_pRow, uLeftSize);
+			for (u32 i = uLeftSize; i < a_uSize; i++)
+			{
+				pOut[i] = static_cast<u8>(a_pRow[i] - a_pRow[i - 4] / 2);
+			}
+			break;
+		}
+		for (u32 i = 0; i < uLeftSize; i++)
+		{
+			pOut[i] = static_cast<u8>(a_pRow[i] - a_pPrevRow[i] / 2);
+		}
+		for (u32 i = uLeftSize; i < a_uSize; i++)
+		{
+			pOut[i] = static_cast<u8>(a_pRow[i] - (a_pRow[i - 4] + a_pPrevRow[i]) / 2);
+		}
+		break;
+	case PNG_FILTER_VALUE_PAETH:
+		// without an upper row paeth predicts the left pixel, without a left pixel the upper one
+		if (a_pPrevRow == nullptr)
+		{
+			memcpy(pOut, a_pRow, uLeftSize);
+			for (u32 i = uLeftSize; i < a_uSize; i++)
+			{
+				pOut[i] = static_cast<u8>(a_pRow[i] - a_pRow[i - 4]);
+			}
+			break;
+		}
+		for (u32 i = 0; i < uLeftSize; i++)
+		{
+			pOut[i] = static_cast<u8>(a_pRow[i] - a_pPrevRow[i]);
+		}
+		for (u32 i = uLeftSize; i < a_uSize; i++)
+		{
+			n32 nLeft = a_pRow[i - 4];
+			n32 nUp = a_pPrevRow[i];
+			n32 nUpLeft = a_pPrevRow[i - 4];
+			n32 nPLeft = abs(nUp - nUpLeft);
+			n32 nPUp = abs(nLeft - nUpLeft);
+			n32 nPUpLeft = abs(nLeft + nUp - nUpLeft * 2);
+			n32 nPredict = nPLeft <= nPUp && nPLeft <= nPUpLeft ? nLeft : (nPUp <= nPUpLeft ? nUp : nUpLeft);
+			pOut[i] = static_cast<u8>(a_pRow[i] - nPredict);
+		}
+		break;
+	default:
+		memcpy(pOut, a_pRow, a_uSize);
+		break;
+	}
+}
+
+bool CPngWriter::WriteHeader(FILE* a_fp, u32 a_uWidth, u32 a_uHeight)
+{
+	static const u8 c_uSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	u8 uHeader[13] = {};
+	for (n32 i = 0; i < 4; i++)
+	{
+		uHeader[i] = static_cast<u8>(a_uWidth >> (24 - i * 8));
+		uHeader[4 + i] = static_cast<u8>(a_uHeight >> (24 - i * 8));
+	}
+	// 8 bit rgba, deflate, adaptive filtering, not interlaced
+	uHeader[8] = 8;
+	uHeader[9] = 6;
+	return fwrite(c_uSignature, 1, sizeof(c_uSignature), a_fp) == sizeof(c_uSignature) && WriteChunk(a_fp, "IHDR", uHeader, sizeof(uHeader));
+}
+
+bool CPngWriter::WriteChunk(FILE* a_fp, const char* a_pType, const u8* a_pData, u32 a_uSize)
+{
+	u8 uLength[4] = { static_cast<u8>(a_uSize >> 24), static_cast<u8>(a_uSize >> 16), static_cast<u8>(a_uSize >> 8), static_cast<u8>(a_uSize) };
+	uLong uCrc = crc32(0, reinterpret_cast<const Bytef*>(a_pType), 4);
+	if (a_uSize != 0)
+	{
+		uCrc = crc32(uCrc, a_pData, a_uSize);
+	}
+	u8 uCrcBytes[4] = { static_cast<u8>(uCrc >> 24), static_cast<u8>(uCrc >> 16), static_cast<u8>(uCrc >> 8), static_cast<u8>(uCrc) };
+	return fwrite(uLength, 1, 4, a_fp) == 4 && fwrite(a_pType, 1, 4, a_fp) == 4 && (a_uSize == 0 || fwrite(a_pData, 1, a_uSize, a_fp) == a_uSize) && fwrite(uCrcBytes, 1, 4, a_fp) == 4;
+}
@@ -0,0 +1,57 @@
+#ifndef PNGWRITER_H_
+#define PNGWRITER_H_
+
+#include <sdw.h>
+
+class CPngWriter
+{
+public:
+	enum EEncoder
+	{
+		kEncoderLibpng,
+		kEncoderFast
+	};
+	enum EFilter
+	{
+		kFilterNone,
+		kFilterSub,
+		kFilterUp,
+		kFilterAverage,
+		kFilterPaeth,
+		kFilterAdaptive
+	};
+	enum EStrategy
+	{
+		kStrategyDefault,
+		kStrategyFiltered,
+		kStrategyHuffmanOnly,
+		kStrategyRle,
+		kStrategyFixed
+	};
+	CPngWriter();
+	~CPngWriter();
+	void SetEncoder(EEncoder a_eEncoder);
+	void SetLevel(n32 a_nLevel);
+	void SetFilter(EFilter a_eFilter);
+	void SetStrategy(EStrategy a_eStrategy);
+	bool Write(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride) const;
+	bool WriteIndexed(FILE* a_fp, const u8* a_pIndex, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, const u8* a_pPalette, u32 a_uColorCount) const;
+	bool WriteGray(FILE* a_fp, const u8* a_pGray, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, u32 a_uChannelCount, n32 a_nBitDepth) const;
+	static bool WriteHeader(FILE* a_fp, u32 a_uWidth, u32 a_uHeight);
+	static bool WriteChunk(FILE* a_fp, const char* a_pType, const u8* a_pData, u32 a_uSize);
+private:
+	bool writeLibpng(FILE* a_fp, const u8* a_pData, u32 a_uWidth, u32 a_uHeight, u32 a_uStride, n32 a_nColorType, n32 a_nBitDepth, const u8* a_pPalette, u32 a_uColorCount) const;
+	bool writeParallel(FILE* a_fp, const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uStride) const;
+	void filterRow(const u8* a_pRow, const u8* a_pPrevRow, u32 a_uSize, u8* a_pFiltered, u8* a_pScratch) const;
+	n32 getZlibStrategy() const;
+	static void filterRow(n32 a_nFilter, const u8* a_pRow, const u8* a_pPrevRow, u32 a_uSize, u8* a_pFiltered);
+	static const u32 s_uParallelSize;
+	static const u32 s_uBandSize;
+	static const u32 s_uWindowSize;
+	EEncoder m_eEncoder;
+	n32 m_nLevel;
+	EFilter m_eFilter;
+	EStrategy m_eStrategy;
+};
+
+#endif	// PNGWRITER_H_
@@ -0,0 +1,536 @@
+#include "pvrtc.h"
+#include "gxt.h"
+#include "threadpool.h"
+#include <cmath>
+
+const n32 CPvrtc::s_nRefinePassCount = 4;
+
+bool CPvrtc::Encode(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp, bool a_bPvrtII, bool a_bOpaque, bool a_bFast, u8* a_pData)
+{
+	if (a_uBpp != 2 && a_uBpp != 4)
+	{
+		CGxt::Report(Format(USTR("ERROR: pvrtc bpp %u error\n\n"), a_uBpp));
+		return false;
+	}
+	CPvrtc pvrtc(a_pRGBA, a_uWidth, a_uHeight, a_uBpp, a_bPvrtII, a_bOpaque);
+	if (a_uWidth == 0 || a_uHeight == 0 || a_uWidth % pvrtc.m_uBlockWidth != 0 || a_uHeight % pvrtc.m_uBlockHeight != 0)
+	{
+		CGxt::Report(Format(USTR("ERROR: pvrtc size %ux%u error\n\n"), a_uWidth, a_uHeight));
+		return false;
+	}
+	pvrtc.m_vBlock.resize(pvrtc.m_uBlockCountX * pvrtc.m_uBlockCountY);
+	// every pass only writes the blocks of its own row and reads the neighbours of the previous pass, so rows are independent
+	CThreadPool::ParallelFor(pvrtc.m_uBlockCountY, [&](u32 a_uBlockY)
+	{
+		for (u32 uBlockX = 0; uBlockX < pvrtc.m_uBlockCountX; uBlockX++)
+		{
+			pvrtc.initBlock(uBlockX, a_uBlockY, a_bFast);
+		}
+	});
+	CThreadPool::ParallelFor(pvrtc.m_uBlockCountY, [&](u32 a_uBlockY)
+	{
+		for (u32 uBlockX = 0; uBlockX < pvrtc.m_uBlockCountX; uBlockX++)
+		{
+			pvrtc.selectModulation(uBlockX, a_uBlockY, a_bFast);
+		}
+	});
+	if (!a_bFast)
+	{
+		for (n32 i = 0; i < s_nRefinePassCount; i++)
+		{
+			vector<SBlock> vBlock(pvrtc.m_vBlock);
+			CThreadPool::ParallelFor(pvrtc.m_uBlockCountY, [&](u32 a_uBlockY)
+			{
+				for (u32 uBlockX = 0; uBlockX < pvrtc.m_uBlockCountX; uBlockX++)
+				{
+					pvrtc.refineBlock(uBlockX, a_uBlockY, vBlock[a_uBlockY * pvrtc.m_uBlockCountX + uBlockX]);
+				}
+			});
+			pvrtc.m_vBlock.swap(vBlock);
+			CThreadPool::ParallelFor(pvrtc.m_uBlockCountY, [&](u32 a_uBlockY)
+			{
+				for (u32 uBlockX = 0; uBlockX < pvrtc.m_uBlockCountX; uBlockX++)
+				{
+					pvrtc.selectModulation(uBlockX, a_uBlockY, a_bFast);
+				}
+			});
+		}
+	}
+	for (u32 uBlockY = 0; uBlockY < pvrtc.m_uBlockCountY; uBlockY++)
+	{
+		for (u32 uBlockX = 0; uBlockX < pvrtc.m_uBlockCountX; uBlockX++)
+		{
+			u64 uBlock = pvrtc.packBlock(pvrtc.m_vBlock[uBlockY * pvrtc.m_uBlockCountX + uBlockX]);
+			u8* pBlock = a_pData + sce::Texture::getMortonNumber(uBlockX, uBlockY, pvrtc.m_uBlockCountX, pvrtc.m_uBlockCountY) * 8;
+			for (n32 i = 0; i < 8; i++)
+			{
+				pBlock[i] = static_cast<u8>(uBlock >> (i * 8));
+			}
+		}
+	}
+	return true;
+}
+
+CPvrtc::CPvrtc(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp, bool a_bPvrtII, bool a_bOpaque)
+	: m_pRGBA(a_pRGBA)
+	, m_uWidth(a_uWidth)
+	, m_uHeight(a_uHeight)
+	, m_uBpp(a_uBpp)
+	, m_bPvrtII(a_bPvrtII)
+	, m_bOpaque(a_bOpaque)
+	, m_uBlockWidth(a_uBpp == 2 ? 8 : 4)
+	, m_uBlockHeight(4)
+	, m_uBlockCountX(a_uWidth / m_uBlockWidth)
+	, m_uBlockCountY(a_uHeight / m_uBlockHeight)
+{
+	initQuantizeTable();
+}
+
+void CPvrtc::initQuantizeTable()
+{
+	static const n32 c_nBitCount[kQuantizeCount] = { 5, 4, 3, 3 };
+	for (n32 i = 0; i < kQuantizeCount; i++)
+	{
+		for (n32 j = 0; j < (1 << c_nBitCount[i]); j++)
+		{
+			n32 nValue = 0;
+			switch (i)
+			{
+			case kQuantize5:
+				nValue = j;
+				break;
+			case kQuantize4:
+				nValue = j << 1 | j >> 3;
+				break;
+			case kQuantize3:
+				nValue = j << 2 | j >> 1;
+				break;
+			case kQuantizeAlpha3:
+				nValue = j << 1;
+				break;
+			}
+			// colors are stored as 5 bits and alpha as 4 bits after the hardware expansion
+			m_nExpand[i][j] = i == kQuantizeAlpha3 ? nValue * 17 : (nValue << 3 | nValue >> 2);
+		}
+		for (n32 j = 0; j < 256; j++)
+		{
+			n32 nBest = 0;
+			for (n32 k = 1; k < (1 << c_nBitCount[i]); k++)
+			{
+				if (abs(m_nExpand[i][k] - j) < abs(m_nExpand[i][nBest] - j))
+				{
+					nBest = k;
+				}
+			}
+			m_uQuantize[i][j] = static_cast<u8>(nBest);
+		}
+	}
+}
+
+void CPvrtc::getInterpolation(u32 a_uX, u32 a_uY, u32* a_pBlockIndex, n32* a_pWeight) const
+{
+	// the colors of a block are centred on it and bilinearly blended with the neighbours, wrapping at the edges
+	n32 nU = static_cast<n32>(a_uX) - static_cast<n32>(m_uBlockWidth / 2);
+	n32 nV = static_cast<n32>(a_uY) - static_cast<n32>(m_uBlockHeight / 2);
+	n32 nBlockX = nU >= 0 ? nU / static_cast<n32>(m_uBlockWidth) : -1;
+	n32 nBlockY = nV >= 0 ? nV / static_cast<n32>(m_uBlockHeight) : -1;
+	n32 nFracX = nU - nBlockX * static_cast<n32>(m_uBlockWidth);
+	n32 nFracY = nV - nBlockY * static_cast<n32>(m_uBlockHeight);
+	u32 uX0 = static_cast<u32>(nBlockX + m_uBlockCountX) % m_uBlockCountX;
+	u32 uX1 = static_cast<u32>(nBlockX + 1) % m_uBlockCountX;
+	u32 uY0 = static_cast<u32>(nBlockY + m_uBlockCountY) % m_uBlockCountY;
+	u32 uY1 = static_cast<u32>(nBlockY + 1) % m_uBlockCountY;
+	a_pBlockIndex[0] = uY0 * m_uBlockCountX + uX0;
+	a_pBlockIndex[1] = uY0 * m_uBlockCountX + uX1;
+	a_pBlockIndex[2] = uY1 * m_uBlockCountX + uX0;
+	a_pBlockIndex[3] = uY1 * m_uBlockCountX + uX1;
+	a_pWeight[0] = (m_uBlockWidth - nFracX) * (m_uBlockHeight - nFracY);
+	a_pWeight[1] = nFracX * (m_uBlockHeight - nFracY);
+	a_pWeight[2] = (m_uBlockWidth - nFracX) * nFracY;
+	a_pWeight[3] = nFracX * nFracY;
+}
+
+n32 CPvrtc::getModulationWeight(const SBlock& a_Block, u32 a_uIndex, bool& a_bAlphaZero) const
+{
+	static const n32 c_nStandard[4] = { 0, 3, 5, 8 };
+	static const n32 c_nPunchThrough[4] = { 0, 4, 4, 8 };
+	u8 uModulation = a_Block.Modulation[a_uIndex];
+	a_bAlphaZero = false;
+	if (m_uBpp == 2)
+	{
+		return uModulation != 0 ? 8 : 0;
+	}
+	if (a_Block.PunchThrough)
+	{
+		a_bAlphaZero = uModulation == 2;
+		return c_nPunchThrough[uModulation];
+	}
+	return c_nStandard[uModulation];
+}
+
+void CPvrtc::quantize(const f32* a_pColorA, const f32* a_pColorB, SBlock& a_Block) const
+{
+	n32 nColorA[4];
+	n32 nColorB[4];
+	for (n32 i = 0; i < 4; i++)
+	{
+		nColorA[i] = std::min<n32>(std::max<n32>(static_cast<n32>(a_pColorA[i] + 0.5f), 0), 255);
+		nColorB[i] = std::min<n32>(std::max<n32>(static_cast<n32>(a_pColorB[i] + 0.5f), 0), 255);
+	}
+	u32 uColorA = 0;
+	u32 uColorB = 0;
+	if (a_Block.Opaque)
+	{
+		u32 uR = m_uQuantize[kQuantize5][nColorA[0]];
+		u32 uG = m_uQuantize[kQuantize5][nColorA[1]];
+		u32 uB = m_uQuantize[kQuantize4][nColorA[2]];
+		uColorA = uR << 10 | uG << 5 | uB << 1;
+		a_Block.ColorA[0] = m_nExpand[kQuantize5][uR];
+		a_Block.ColorA[1] = m_nExpand[kQuantize5][uG];
+		a_Block.ColorA[2] = m_nExpand[kQuantize4][uB];
+		a_Block.ColorA[3] = 255;
+		uR = m_uQuantize[kQuantize5][nColorB[0]];
+		uG = m_uQuantize[kQuantize5][nColorB[1]];
+		uB = m_uQuantize[kQuantize5][nColorB[2]];
+		uColorB = uR << 10 | uG << 5 | uB;
+		a_Block.ColorB[0] = m_nExpand[kQuantize5][uR];
+		a_Block.ColorB[1] = m_nExpand[kQuantize5][uG];
+		a_Block.ColorB[2] = m_nExpand[kQuantize5][uB];
+		a_Block.ColorB[3] = 255;
+		// PVRTC2 keeps a single opacity flag for both colors and reuses the bit of color A as the hard transition flag
+		if (!m_bPvrtII)
+		{
+			uColorA |= 0x8000;
+		}
+		uColorB |= 0x8000;
+	}
+	else
+	{
+		u32 uA = m_uQuantize[kQuantizeAlpha3][nColorA[3]];
+		u32 uR = m_uQuantize[kQuantize4][nColorA[0]];
+		u32 uG = m_uQuantize[kQuantize4][nColorA[1]];
+		u32 uB = m_uQuantize[kQuantize3][nColorA[2]];
+		uColorA = uA << 12 | uR << 8 | uG << 4 | uB << 1;
+		a_Block.ColorA[0] = m_nExpand[kQuantize4][uR];
+		a_Block.ColorA[1] = m_nExpand[kQuantize4][uG];
+		a_Block.ColorA[2] = m_nExpand[kQuantize3][uB];
+		a_Block.ColorA[3] = m_nExpand[kQuantizeAlpha3][uA];
+		uA = m_uQuantize[kQuantizeAlpha3][nColorB[3]];
+		uR = m_uQuantize[kQuantize4][nColorB[0]];
+		uG = m_uQuantize[kQuantize4][nColorB[1]];
+		uB = m_uQuantize[kQuantize4][nColorB[2]];
+		uColorB = uA << 12 | uR << 8 | uG << 4 | uB;
+		a_Block.ColorB[0] = m_nExpand[kQuantize4][uR];
+		a_Block.ColorB[1] = m_nExpand[kQuantize4][uG];
+		a_Block.ColorB[2] = m_nExpand[kQuantize4][uB];
+		a_Block.ColorB[3] = m_nExpand[kQuantizeAlpha3][uA];
+	}
+	a_Block.Color = uColorB << 16 | uColorA;
+}
+
+void CPvrtc::initBlock(u32 a_uBlockX, u32 a_uBlockY, bool a_bFast)
+{
+	SBlock& block = m_vBlock[a_uBlockY * m_uBlockCountX + a_uBlockX];
+	u32 uPixelCount = m_uBlockWidth * m_uBlockHeight;
+	f32 fPixel[32][4];
+	block.Opaque = true;
+	for (u32 i = 0; i < uPixelCount; i++)
+	{
+		u32 uX = a_uBlockX * m_uBlockWidth + i % m_uBlockWidth;
+		u32 uY = a_uBlockY * m_uBlockHeight + i / m_uBlockWidth;
+		const u8* pPixel = m_pRGBA + (uY * m_uWidth + uX) * 4;
+		for (n32 j = 0; j < 4; j++)
+		{
+			fPixel[i][j] = pPixel[j];
+		}
+		if (m_bOpaque)
+		{
+			fPixel[i][3] = 255.0f;
+		}
+		else if (pPixel[3] != 255)
+		{
+			block.Opaque = false;
+		}
+	}
+	f32 fColorA[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	f32 fColorB[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	if (a_bFast)
+	{
+		for (u32 i = 0; i < uPixelCount; i++)
+		{
+			for (n32 j = 0; j < 4; j++)
+			{
+				fColorA[j] = std::min<f32>(fColorA[j], fPixel[i][j]);
+				fColorB[j] = std::max<f32>(fColorB[j], fPixel[i][j]);
+			}
+		}
+	}
+	else
+	{
+		// principal axis of the block, found by power iteration on the covariance matrix
+		f32 fMean[4] = {};
+		for (u32 i = 0; i < uPixelCount; i++)
+		{
+			for (n32 j = 0; j < 4; j++)
+			{
+				fMean[j] += fPixel[i][j];
+			}
+		}
+		for (n32 j = 0; j < 4; j++)
+		{
+			fMean[j] /= uPixelCount;
+		}
+		f32 fCovariance[4][4] = {};
+		for (u32 i = 0; i < uPixelCount; i++)
+		{
+			for (n32 j = 0; j < 4; j++)
+			{
+				for (n32 k = 0; k < 4; k++)
+				{
+					fCovariance[j][k] += (fPixel[i][j] - fMean[j]) * (fPixel[i][k] - fMean[k]);
+				}
+			}
+		}
+		f32 fAxis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (n32 i = 0; i < 8; i++)
+		{
+			f32 fNext[4] = {};
+			f32 fLength = 0.0f;
+			for (n32 j = 0; j < 4; j++)
+			{
+				for (n32 k = 0; k < 4; k++)
+				{
+					fNext[j] += fCovariance[j][k] * fAxis[k];
+				}
+				fLength = std::max<f32>(fLength, fabsf(fNext[j]));
+			}
+			if (fLength < 1e-6f)
+			{
+				break;
+			}
+			for (n32 j = 0; j < 4; j++)
+			{
+				fAxis[j] = fNext[j] / fLength;
+			}
+		}
+		f32 fLength = sqrtf(fAxis[0] * fAxis[0] + fAxis[1] * fAxis[1] + fAxis[2] * fAxis[2] + fAxis[3] * fAxis[3]);
+		f32 fMin = 0.0f;
+		f32 fMax = 0.0f;
+		if (fLength > 1e-6f)
+		{
+			for (n32 j = 0; j < 4; j++)
+			{
+				fAxis[j] /= fLength;
+			}
+			for (u32 i = 0; i < uPixelCount; i++)
+			{
+				f32 fT = 0.0f;
+				for (n32 j = 0; j < 4; j++)
+				{
+					fT += (fPixel[i][j] - fMean[j]) * fAxis[j];
+				}
+				fMin = std::min<f32>(fMin, fT);
+				fMax = std::max<f32>(fMax, fT);
+			}
+		}
+		for (n32 j = 0; j < 4; j++)
+		{
+			fColorA[j] = fMean[j] + fAxis[j] * fMin;
+			fColorB[j] = fMean[j] + fAxis[j] * fMax;
+		}
+	}
+	quantize(fColorA, fColorB, block);
+	block.PunchThrough = false;
+	memset(block.Modulation, 0, sizeof(block.Modulation));
+}
+
+void CPvrtc::selectModulation(u32 a_uBlockX, u32 a_uBlockY, bool a_bFast)
+{
+	static const n32 c_nStandard[4] = { 0, 3, 5, 8 };
+	static const n32 c_nPunchThrough[4] = { 0, 4, 4, 8 };
+	SBlock& block = m_vBlock[a_uBlockY * m_uBlockCountX + a_uBlockX];
+	u32 uPixelCount = m_uBlockWidth * m_uBlockHeight;
+	n32 nScale = m_uBlockWidth * m_uBlockHeight * 8;
+	n32 nChannelCount = m_bOpaque ? 3 : 4;
+	n32 nModulationCount = m_uBpp == 2 ? 2 : 4;
+	bool bPunchThrough = !a_bFast && !m_bPvrtII && m_uBpp == 4 && !block.Opaque;
+	u8 uStandard[32] = {};
+	u8 uPunchThrough[32] = {};
+	u64 uStandardError = 0;
+	u64 uPunchThroughError = 0;
+	for (u32 i = 0; i < uPixelCount; i++)
+	{
+		u32 uX = a_uBlockX * m_uBlockWidth + i % m_uBlockWidth;
+		u32 uY = a_uBlockY * m_uBlockHeight + i / m_uBlockWidth;
+		const u8* pPixel = m_pRGBA + (uY * m_uWidth + uX) * 4;
+		u32 uBlockIndex[4];
+		n32 nWeight[4];
+		getInterpolation(uX, uY, uBlockIndex, nWeight);
+		n32 nColorA[4] = {};
+		n32 nColorB[4] = {};
+		n32 nTarget[4] = {};
+		for (n32 j = 0; j < nChannelCount; j++)
+		{
+			for (n32 k = 0; k < 4; k++)
+			{
+				nColorA[j] += nWeight[k] * m_vBlock[uBlockIndex[k]].ColorA[j];
+				nColorB[j] += nWeight[k] * m_vBlock[uBlockIndex[k]].ColorB[j];
+			}
+			nTarget[j] = pPixel[j] * nScale;
+		}
+		u64 uBest = UINT64_MAX;
+		for (n32 k = 0; k < nModulationCount; k++)
+		{
+			n32 nModulation = m_uBpp == 2 ? k * 8 : c_nStandard[k];
+			u64 uError = 0;
+			for (n32 j = 0; j < nChannelCount; j++)
+			{
+				n64 nDiff = nColorA[j] * (8 - nModulation) + nColorB[j] * nModulation - nTarget[j];
+				uError += nDiff * nDiff;
+			}
+			if (uError < uBest)
+			{
+				uBest = uError;
+				uStandard[i] = static_cast<u8>(k);
+			}
+		}
+		uStandardError += uBest;
+		if (bPunchThrough)
+		{
+			uBest = UINT64_MAX;
+			for (n32 k = 0; k < 4; k++)
+			{
+				n32 nModulation = c_nPunchThrough[k];
+				u64 uError = 0;
+				for (n32 j = 0; j < nChannelCount; j++)
+				{
+					n64 nDiff = (j == 3 && k == 2) ? -nTarget[j] : nColorA[j] * (8 - nModulation) + nColorB[j] * nModulation - nTarget[j];
+					uError += nDiff * nDiff;
+				}
+				if (uError < uBest)
+				{
+					uBest = uError;
+					uPunchThrough[i] = static_cast<u8>(k);
+				}
+			}
+			uPunchThroughError += uBest;
+		}
+	}
+	block.PunchThrough = bPunchThrough && uPunchThroughError < uStandardError;
+	memcpy(block.Modulation, block.PunchThrough ? uPunchThrough : uStandard, sizeof(block.Modulation));
+}
+
+void CPvrtc::refineBlock(u32 a_uBlockX, u32 a_uBlockY, SBlock& a_Block) const
+{
+	// least squares fit of both colors of one block, keeping the neighbours and the modulation of the previous pass
+	u32 uIndex = a_uBlockY * m_uBlockCountX + a_uBlockX;
+	const SBlock& block = m_vBlock[uIndex];
+	n32 nScale = m_uBlockWidth * m_uBlockHeight * 8;
+	n32 nChannelCount = m_bOpaque ? 3 : 4;
+	f64 fAA[4] = {};
+	f64 fAB[4] = {};
+	f64 fBB[4] = {};
+	f64 fAR[4] = {};
+	f64 fBR[4] = {};
+	for (u32 uRegionY = 0; uRegionY < m_uBlockHeight * 2; uRegionY++)
+	{
+		u32 uY = (a_uBlockY * m_uBlockHeight + m_uHeight - m_uBlockHeight / 2 + uRegionY) % m_uHeight;
+		for (u32 uRegionX = 0; uRegionX < m_uBlockWidth * 2; uRegionX++)
+		{
+			u32 uX = (a_uBlockX * m_uBlockWidth + m_uWidth - m_uBlockWidth / 2 + uRegionX) % m_uWidth;
+			u32 uBlockIndex[4];
+			n32 nWeight[4];
+			getInterpolation(uX, uY, uBlockIndex, nWeight);
+			n32 nOwnWeight = 0;
+			for (n32 k = 0; k < 4; k++)
+			{
+				if (uBlockIndex[k] == uIndex)
+				{
+					nOwnWeight += nWeight[k];
+				}
+			}
+			if (nOwnWeight == 0)
+			{
+				continue;
+			}
+			const SBlock& owner = m_vBlock[(uY / m_uBlockHeight) * m_uBlockCountX + uX / m_uBlockWidth];
+			bool bAlphaZero = false;
+			n32 nModulation = getModulationWeight(owner, (uY % m_uBlockHeight) * m_uBlockWidth + uX % m_uBlockWidth, bAlphaZero);
+			f64 fCoefficientA = nOwnWeight * (8 - nModulation);
+			f64 fCoefficientB = nOwnWeight * nModulation;
+			const u8* pPixel = m_pRGBA + (uY * m_uWidth + uX) * 4;
+			for (n32 j = 0; j < nChannelCount; j++)
+			{
+				if (j == 3 && bAlphaZero)
+				{
+					continue;
+				}
+				n32 nOther = 0;
+				for (n32 k = 0; k < 4; k++)
+				{
+					if (uBlockIndex[k] != uIndex)
+					{
+						const SBlock& neighbour = m_vBlock[uBlockIndex[k]];
+						nOther += nWeight[k] * (neighbour.ColorA[j] * (8 - nModulation) + neighbour.ColorB[j] * nModulation);
+					}
+				}
+				f64 fResidual = pPixel[j] * nScale - nOther;
+				fAA[j] += fCoefficientA * fCoefficientA;
+				fAB[j] += fCoefficientA * fCoefficientB;
+				fBB[j] += fCoefficientB * fCoefficientB;
+				fAR[j] += fCoefficientA * fResidual;
+				fBR[j] += fCoefficientB * fResidual;
+			}
+		}
+	}
+	f32 fColorA[4];
+	f32 fColorB[4];
+	for (n32 j = 0; j < 4; j++)
+	{
+		fColorA[j] = static_cast<f32>(block.ColorA[j]);
+		fColorB[j] = static_cast<f32>(block.ColorB[j]);
+		if (j >= nChannelCount)
+		{
+			continue;
+		}
+		f64 fDeterminant = fAA[j] * fBB[j] - fAB[j] * fAB[j];
+		if (fDeterminant > 1e-6 * fAA[j] * fBB[j] && fDeterminant > 0.0)
+		{
+			fColorA[j] = static_cast<f32>((fBB[j] * fAR[j] - fAB[j] * fBR[j]) / fDeterminant);
+			fColorB[j] = static_cast<f32>((fAA[j] * fBR[j] - fAB[j] * fAR[j]) / fDeterminant);
+		}
+		else if (fBB[j] > fAA[j])
+		{
+			fColorB[j] = static_cast<f32>((fBR[j] - fAB[j] * fColorA[j]) / fBB[j]);
+		}
+		else if (fAA[j] > 0.0)
+		{
+			fColorA[j] = static_cast<f32>((fAR[j] - fAB[j] * fColorB[j]) / fAA[j]);
+		}
+		// all blocks move at once, so only go half way to keep neighbours from overshooting each other
+		fColorA[j] = (fColorA[j] + block.ColorA[j]) * 0.5f;
+		fColorB[j] = (fColorB[j] + block.ColorB[j]) * 0.5f;
+	}
+	quantize(fColorA, fColorB, a_Block);
+}
+
+u64 CPvrtc::packBlock(const SBlock& a_Block) const
+{
+	u32 uModulation = 0;
+	if (m_uBpp == 2)
+	{
+		for (n32 i = 0; i < 32; i++)
+		{
+			uModulation |= static_cast<u32>(a_Block.Modulation[i] & 1) << i;
+		}
+	}
+	else
+	{
+		for (n32 i = 0; i < 16; i++)
+		{
+			uModulation |= static_cast<u32>(a_Block.Modulation[i] & 3) << (i * 2);
+		}
+	}
+	u32 uColor = a_Block.Color | (a_Block.PunchThrough ? 1 : 0);
+	return static_cast<u64>(uColor) << 32 | uModulation;
+}
@@ -0,0 +1,53 @@
+#ifndef PVRTC_H_
+#define PVRTC_H_
+
+#include <sdw.h>
+
+class CPvrtc
+{
+public:
+	static bool Encode(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp, bool a_bPvrtII, bool a_bOpaque, bool a_bFast, u8* a_pData);
+private:
+	struct SBlock
+	{
+		n32 ColorA[4];
+		n32 ColorB[4];
+		u32 Color;
+		bool Opaque;
+		bool PunchThrough;
+		u8 Modulation[32];
+	};
+	enum
+	{
+		kQuantize5,
+		kQuantize4,
+		kQuantize3,
+		kQuantizeAlpha3,
+		kQuantizeCount
+	};
+	CPvrtc(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, u32 a_uBpp, bool a_bPvrtII, bool a_bOpaque);
+	void initQuantizeTable();
+	void getInterpolation(u32 a_uX, u32 a_uY, u32* a_pBlockIndex, n32* a_pWeight) const;
+	n32 getModulationWeight(const SBlock& a_Block, u32 a_uIndex, bool& a_bAlphaZero) const;
+	void quantize(const f32* a_pColorA, const f32* a_pColorB, SBlock& a_Block) const;
+	void initBlock(u32 a_uBlockX, u32 a_uBlockY, bool a_bFast);
+	void selectModulation(u32 a_uBlockX, u32 a_uBlockY, bool a_bFast);
+	void refineBlock(u32 a_uBlockX, u32 a_uBlockY, SBlock& a_Block) const;
+	u64 packBlock(const SBlock& a_Block) const;
+	const u8* m_pRGBA;
+	u32 m_uWidth;
+	u32 m_uHeight;
+	u32 m_uBpp;
+	bool m_bPvrtII;
+	bool m_bOpaque;
+	u32 m_uBlockWidth;
+	u32 m_uBlockHeight;
+	u32 m_uBlockCountX;
+	u32 m_uBlockCountY;
+	u8 m_uQuantize[kQuantizeCount][256];
+	n32 m_nExpand[kQuantizeCount][32];
+	vector<SBlock> m_vBlock;
+	static const n32 s_nRefinePassCount;
+};
+
+#endif	// PVRTC_H_
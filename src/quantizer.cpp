@@ -0,0 +1,283 @@
+#include "quantizer.h"
+#include <climits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUANTIZER_USE_SSE2 1
+#else
+#define QUANTIZER_USE_SSE2 0
+#endif
+
+const n32 CQuantizer::s_nKMeansPassCount = 16;
+
+const n32 CQuantizer::s_nBayer[4][4] =
+{
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 }
+};
+
+// palette entries are packed in groups of 4 as { r0, g0, r1, g1, r2, g2, r3, g3, b0, a0, b1, a1, b2, a2, b3, a3 }
+// so that one _mm_madd_epi16 yields the partial distances of 4 entries
+static void packPalette(const u8* a_pPalette, u32 a_uColorCount, vector<n16>& a_vPacked)
+{
+	u32 uGroupCount = (a_uColorCount + 3) / 4;
+	a_vPacked.assign(uGroupCount * 16, SHRT_MAX / 2);
+	for (u32 i = 0; i < a_uColorCount; i++)
+	{
+		n16* pGroup = &*a_vPacked.begin() + i / 4 * 16;
+		u32 uLane = i % 4;
+		pGroup[uLane * 2] = a_pPalette[i * 4];
+		pGroup[uLane * 2 + 1] = a_pPalette[i * 4 + 1];
+		pGroup[8 + uLane * 2] = a_pPalette[i * 4 + 2];
+		pGroup[8 + uLane * 2 + 1] = a_pPalette[i * 4 + 3];
+	}
+}
+
+static u32 findNearestPacked(const vector<n16>& a_vPacked, n32 a_nR, n32 a_nG, n32 a_nB, n32 a_nA, n32* a_pDistance = nullptr)
+{
+	u32 uGroupCount = static_cast<u32>(a_vPacked.size() / 16);
+	const n16* pPacked = &*a_vPacked.begin();
+#if QUANTIZER_USE_SSE2
+	const __m128i vRG = _mm_set1_epi32(static_cast<n32>((static_cast<u32>(a_nG) << 16) | static_cast<u16>(a_nR)));
+	const __m128i vBA = _mm_set1_epi32(static_cast<n32>((static_cast<u32>(a_nA) << 16) | static_cast<u16>(a_nB)));
+	const __m128i vFour = _mm_set1_epi32(4);
+	__m128i vIndex = _mm_setr_epi32(0, 1, 2, 3);
+	__m128i vBestDistance = _mm_set1_epi32(INT_MAX);
+	__m128i vBestIndex = _mm_setzero_si128();
+	for (u32 i = 0; i < uGroupCount; i++)
+	{
+		__m128i vDeltaRG = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pPacked + i * 16)), vRG);
+		__m128i vDeltaBA = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pPacked + i * 16 + 8)), vBA);
+		__m128i vDistance = _mm_add_epi32(_mm_madd_epi16(vDeltaRG, vDeltaRG), _mm_madd_epi16(vDeltaBA, vDeltaBA));
+		__m128i vLess = _mm_cmplt_epi32(vDistance, vBestDistance);
+		vBestDistance = _mm_or_si128(_mm_and_si128(vLess, vDistance), _mm_andnot_si128(vLess, vBestDistance));
+		vBestIndex = _mm_or_si128(_mm_and_si128(vLess, vIndex), _mm_andnot_si128(vLess, vBestIndex));
+		vIndex = _mm_add_epi32(vIndex, vFour);
+	}
+	n32 nDistance[4];
+	n32 nIndex[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(nDistance), vBestDistance);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(nIndex), vBestIndex);
+	u32 uBest = 0;
+	for (u32 i = 1; i < 4; i++)
+	{
+		if (nDistance[i] < nDistance[uBest] || (nDistance[i] == nDistance[uBest] && nIndex[i] < nIndex[uBest]))
+		{
+			uBest = i;
+		}
+	}
+	if (a_pDistance != nullptr)
+	{
+		*a_pDistance = nDistance[uBest];
+	}
+	return nIndex[uBest];
+#else
+	n32 nBestDistance = INT_MAX;
+	u32 uBestIndex = 0;
+	for (u32 i = 0; i < uGroupCount * 4; i++)
+	{
+		const n16* pGroup = pPacked + i / 4 * 16;
+		u32 uLane = i % 4;
+		n32 nDeltaR = pGroup[uLane * 2] - a_nR;
+		n32 nDeltaG = pGroup[uLane * 2 + 1] - a_nG;
+		n32 nDeltaB = pGroup[8 + uLane * 2] - a_nB;
+		n32 nDeltaA = pGroup[8 + uLane * 2 + 1] - a_nA;
+		n32 nDistance = nDeltaR * nDeltaR + nDeltaG * nDeltaG + nDeltaB * nDeltaB + nDeltaA * nDeltaA;
+		if (nDistance < nBestDistance)
+		{
+			nBestDistance = nDistance;
+			uBestIndex = i;
+		}
+	}
+	if (a_pDistance != nullptr)
+	{
+		*a_pDistance = nBestDistance;
+	}
+	return uBestIndex;
+#endif
+}
+
+static inline n32 clamp255(n32 a_nValue)
+{
+	return a_nValue < 0 ? 0 : (a_nValue > 255 ? 255 : a_nValue);
+}
+
+void CQuantizer::GeneratePalette(const vector<u32>& a_vColor, const vector<u32>& a_vCount, u32 a_uColorCount, u8* a_pPalette)
+{
+	u32 uUniqueCount = static_cast<u32>(a_vColor.size());
+	if (uUniqueCount == 0)
+	{
+		return;
+	}
+	if (uUniqueCount <= a_uColorCount)
+	{
+		// every colour fits, keep the entries that are still in use where they are and put new colours into the free slots
+		vector<bool> vUsed(a_uColorCount, false);
+		vector<u32> vNew;
+		for (u32 i = 0; i < uUniqueCount; i++)
+		{
+			bool bFound = false;
+			for (u32 j = 0; j < a_uColorCount; j++)
+			{
+				if (memcmp(a_pPalette + j * 4, &a_vColor[i], 4) == 0)
+				{
+					vUsed[j] = true;
+					bFound = true;
+					break;
+				}
+			}
+			if (!bFound)
+			{
+				vNew.push_back(a_vColor[i]);
+			}
+		}
+		u32 uSlot = 0;
+		for (vector<u32>::iterator it = vNew.begin(); it != vNew.end(); ++it)
+		{
+			while (vUsed[uSlot])
+			{
+				uSlot++;
+			}
+			memcpy(a_pPalette + uSlot * 4, &*it, 4);
+			vUsed[uSlot] = true;
+		}
+		return;
+	}
+	// weighted k-means over the histogram, seeded from the current palette
+	vector<u32> vAssign(uUniqueCount, UINT32_MAX);
+	vector<n32> vDistance(uUniqueCount, 0);
+	vector<n16> vPacked;
+	for (n32 nPass = 0; nPass < s_nKMeansPassCount; nPass++)
+	{
+		packPalette(a_pPalette, a_uColorCount, vPacked);
+		bool bChanged = false;
+		vector<f64> vSum(a_uColorCount * 4, 0.0);
+		vector<f64> vWeight(a_uColorCount, 0.0);
+		for (u32 i = 0; i < uUniqueCount; i++)
+		{
+			const u8* pColor = reinterpret_cast<const u8*>(&a_vColor[i]);
+			u32 uIndex = findNearestPacked(vPacked, pColor[0], pColor[1], pColor[2], pColor[3], &vDistance[i]);
+			if (uIndex != vAssign[i])
+			{
+				vAssign[i] = uIndex;
+				bChanged = true;
+			}
+			f64 fWeight = a_vCount[i];
+			for (n32 j = 0; j < 4; j++)
+			{
+				vSum[uIndex * 4 + j] += pColor[j] * fWeight;
+			}
+			vWeight[uIndex] += fWeight;
+		}
+		if (!bChanged)
+		{
+			break;
+		}
+		for (u32 i = 0; i < a_uColorCount; i++)
+		{
+			if (vWeight[i] > 0.0)
+			{
+				for (n32 j = 0; j < 4; j++)
+				{
+					a_pPalette[i * 4 + j] = static_cast<u8>(clamp255(static_cast<n32>(vSum[i * 4 + j] / vWeight[i] + 0.5)));
+				}
+			}
+			else
+			{
+				// an empty cluster takes over the colour with the largest weighted error
+				u32 uWorst = 0;
+				f64 fWorstError = -1.0;
+				for (u32 j = 0; j < uUniqueCount; j++)
+				{
+					f64 fError = static_cast<f64>(vDistance[j]) * a_vCount[j];
+					if (fError > fWorstError)
+					{
+						fWorstError = fError;
+						uWorst = j;
+					}
+				}
+				memcpy(a_pPalette + i * 4, &a_vColor[uWorst], 4);
+				vDistance[uWorst] = 0;
+			}
+		}
+	}
+}
+
+void CQuantizer::Map(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, const u8* a_pPalette, u32 a_uColorCount, EDither a_eDither, u8* a_pIndex)
+{
+	vector<n16> vPacked;
+	packPalette(a_pPalette, a_uColorCount, vPacked);
+	if (a_eDither == kDitherDiffusion)
+	{
+		// Floyd-Steinberg with serpentine scanning, errors are kept in 1/16 units,
+		// only rgb carries error, alpha maps to the nearest entry as it is
+		vector<n32> vError[2];
+		vError[0].assign((a_uWidth + 2) * 3, 0);
+		vError[1].assign((a_uWidth + 2) * 3, 0);
+		for (u32 y = 0; y < a_uHeight; y++)
+		{
+			vector<n32>& vCurrent = vError[y % 2];
+			vector<n32>& vNext = vError[(y + 1) % 2];
+			fill(vNext.begin(), vNext.end(), 0);
+			bool bReverse = y % 2 != 0;
+			n32 nStep = bReverse ? -1 : 1;
+			for (u32 i = 0; i < a_uWidth; i++)
+			{
+				u32 x = bReverse ? a_uWidth - 1 - i : i;
+				const u8* pPixel = a_pRGBA + (y * a_uWidth + x) * 4;
+				n32 nColor[4];
+				for (n32 j = 0; j < 3; j++)
+				{
+					nColor[j] = clamp255(pPixel[j] + (vCurrent[(x + 1) * 3 + j] + 8) / 16);
+				}
+				nColor[3] = pPixel[3];
+				u32 uIndex = findNearestPacked(vPacked, nColor[0], nColor[1], nColor[2], nColor[3]);
+				a_pIndex[y * a_uWidth + x] = static_cast<u8>(uIndex);
+				for (n32 j = 0; j < 3; j++)
+				{
+					n32 nError = nColor[j] - a_pPalette[uIndex * 4 + j];
+					vCurrent[(x + 1 + nStep) * 3 + j] += nError * 7;
+					vNext[(x + 1 - nStep) * 3 + j] += nError * 3;
+					vNext[(x + 1) * 3 + j] += nError * 5;
+					vNext[(x + 1 + nStep) * 3 + j] += nError;
+				}
+			}
+		}
+		return;
+	}
+	n32 nStrength = a_uColorCount <= 16 ? 32 : 12;
+	u32 uLastColor = 0;
+	u32 uLastIndex = UINT32_MAX;
+	for (u32 y = 0; y < a_uHeight; y++)
+	{
+		for (u32 x = 0; x < a_uWidth; x++)
+		{
+			const u8* pPixel = a_pRGBA + (y * a_uWidth + x) * 4;
+			if (a_eDither == kDitherOrdered)
+			{
+				// the threshold only shifts rgb, alpha maps to the nearest entry as it is
+				n32 nOffset = (s_nBayer[y % 4][x % 4] * 2 - 15) * nStrength / 32;
+				a_pIndex[y * a_uWidth + x] = static_cast<u8>(findNearestPacked(vPacked, clamp255(pPixel[0] + nOffset), clamp255(pPixel[1] + nOffset), clamp255(pPixel[2] + nOffset), pPixel[3]));
+			}
+			else
+			{
+				u32 uColor = 0;
+				memcpy(&uColor, pPixel, 4);
+				if (uLastIndex == UINT32_MAX || uColor != uLastColor)
+				{
+					uLastColor = uColor;
+					uLastIndex = findNearestPacked(vPacked, pPixel[0], pPixel[1], pPixel[2], pPixel[3]);
+				}
+				a_pIndex[y * a_uWidth + x] = static_cast<u8>(uLastIndex);
+			}
+		}
+	}
+}
+
+u32 CQuantizer::FindNearest(const u8* a_pPalette, u32 a_uColorCount, n32 a_nR, n32 a_nG, n32 a_nB, n32 a_nA)
+{
+	vector<n16> vPacked;
+	packPalette(a_pPalette, a_uColorCount, vPacked);
+	return findNearestPacked(vPacked, a_nR, a_nG, a_nB, a_nA);
+}
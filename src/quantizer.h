@@ -0,0 +1,23 @@
+#ifndef QUANTIZER_H_
+#define QUANTIZER_H_
+
+#include <sdw.h>
+
+class CQuantizer
+{
+public:
+	enum EDither
+	{
+		kDitherNone,
+		kDitherOrdered,
+		kDitherDiffusion
+	};
+	static void GeneratePalette(const vector<u32>& a_vColor, const vector<u32>& a_vCount, u32 a_uColorCount, u8* a_pPalette);
+	static void Map(const u8* a_pRGBA, u32 a_uWidth, u32 a_uHeight, const u8* a_pPalette, u32 a_uColorCount, EDither a_eDither, u8* a_pIndex);
+	static u32 FindNearest(const u8* a_pPalette, u32 a_uColorCount, n32 a_nR, n32 a_nG, n32 a_nB, n32 a_nA);
+private:
+	static const n32 s_nKMeansPassCount;
+	static const n32 s_nBayer[4][4];
+};
+
+#endif	// QUANTIZER_H_
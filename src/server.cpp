@@ -0,0 +1,491 @@
+#include "server.h"
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#if SDW_PLATFORM != SDW_PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// parsed files kept warm, the least recently used one is dropped first
+const u32 CServer::s_uCacheCount = 64;
+
+const u32 CServer::s_uMaxRequestSize = 64 * 1024;
+
+// milliseconds to wait before accepting again when the process runs out of descriptors
+const u32 CServer::s_uAcceptRetryDelay = 100;
+
+CServer::CServer()
+	: m_uJobCount(0)
+	, m_bVerbose(false)
+	, m_nListenSocket(-1)
+	, m_bStop(false)
+	, m_uShmSerial(0)
+	, m_uActiveJobCount(0)
+	, m_uCacheTick(0)
+{
+}
+
+CServer::~CServer()
+{
+}
+
+void CServer::SetSocketName(const UString& a_sSocketName)
+{
+	m_sSocketName = a_sSocketName;
+}
+
+void CServer::SetJobCount(u32 a_uJobCount)
+{
+	m_uJobCount = a_uJobCount;
+}
+
+void CServer::SetVerbose(bool a_bVerbose)
+{
+	m_bVerbose = a_bVerbose;
+}
+
+#if SDW_PLATFORM != SDW_PLATFORM_WINDOWS
+// every connection gets its own thread, the job count only limits the requests that run at the same time
+bool CServer::Run()
+{
+	if (m_uJobCount == 0)
+	{
+		m_uJobCount = std::max<u32>(thread::hardware_concurrency(), 1);
+	}
+	string sSocketName = UToA(m_sSocketName);
+	sockaddr_un address = {};
+	if (sSocketName.size() >= sizeof(address.sun_path))
+	{
+		UPrintf(USTR("ERROR: socket name %") PRIUS USTR(" is too long\n\n"), m_sSocketName.c_str());
+		return false;
+	}
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, sSocketName.c_str(), sSocketName.size());
+	signal(SIGPIPE, SIG_IGN);
+	m_nListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_nListenSocket < 0)
+	{
+		UPrintf(USTR("ERROR: create socket failed\n\n"));
+		return false;
+	}
+	// a socket left behind by a previous server is replaced
+	unlink(sSocketName.c_str());
+	if (bind(m_nListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(m_nListenSocket, SOMAXCONN) != 0)
+	{
+		close(m_nListenSocket);
+		UPrintf(USTR("ERROR: listen on %") PRIUS USTR(" failed\n\n"), m_sSocketName.c_str());
+		return false;
+	}
+	if (m_bVerbose)
+	{
+		UPrintf(USTR("serve: %") PRIUS USTR(", %u jobs\n"), m_sSocketName.c_str(), m_uJobCount);
+	}
+	bool bResult = true;
+	while (!m_bStop)
+	{
+		n32 nSocket = accept(m_nListenSocket, nullptr, nullptr);
+		if (nSocket < 0)
+		{
+			n32 nError = errno;
+			if (nError == EINTR || nError == ECONNABORTED)
+			{
+				continue;
+			}
+			// the pending connection stays queued until a served one closes
+			if (nError == EMFILE || nError == ENFILE || nError == ENOBUFS || nError == ENOMEM)
+			{
+				this_thread::sleep_for(chrono::milliseconds(s_uAcceptRetryDelay));
+				continue;
+			}
+			UPrintf(USTR("ERROR: accept failed, errno %d\n\n"), nError);
+			bResult = false;
+			break;
+		}
+		unique_lock<mutex> lock(m_ConnectionMutex);
+		if (m_bStop)
+		{
+			close(nSocket);
+			break;
+		}
+		m_sConnection.insert(nSocket);
+		lock.unlock();
+		thread(&CServer::serve, this, nSocket).detach();
+	}
+	close(m_nListenSocket);
+	unlink(sSocketName.c_str());
+	// idle connections are woken up and every thread is waited for before the members go away
+	unique_lock<mutex> lock(m_ConnectionMutex);
+	for (set<n32>::iterator it = m_sConnection.begin(); it != m_sConnection.end(); ++it)
+	{
+		shutdown(*it, SHUT_RDWR);
+	}
+	m_ConnectionCondition.wait(lock, [this]() { return m_sConnection.empty(); });
+	return bResult;
+}
+
+// a request is a u32 little endian size and the arguments separated by newlines,
+// a response is a u32 little endian size, a json header line and the body
+void CServer::serve(n32 a_nSocket)
+{
+	vector<u8> vRequest;
+	vector<u8> vBody;
+	vector<u8> vResponse;
+	for (;;)
+	{
+		u8 uSize[4] = {};
+		if (!readFull(a_nSocket, uSize, sizeof(uSize)))
+		{
+			break;
+		}
+		u32 uRequestSize = uSize[0] | uSize[1] << 8 | uSize[2] << 16 | static_cast<u32>(uSize[3]) << 24;
+		if (uRequestSize > s_uMaxRequestSize)
+		{
+			break;
+		}
+		vRequest.resize(uRequestSize);
+		if (uRequestSize != 0 && !readFull(a_nSocket, &*vRequest.begin(), uRequestSize))
+		{
+			break;
+		}
+		vector<string> vArgument;
+		split(string(vRequest.begin(), vRequest.end()), vArgument);
+		string sHeader;
+		vBody.clear();
+		acquireJob();
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+		bool bResult = handle(vArgument, sHeader, vBody);
+		u64 uTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin).count();
+		releaseJob();
+		if (m_bVerbose)
+		{
+			UPrintf(USTR("serve: %") PRIUS USTR(" %") PRIUS USTR(", %llu us\n"), AToU(vArgument.empty() ? "" : vArgument[0]).c_str(), bResult ? USTR("ok") : USTR("error"), static_cast<unsigned long long>(uTime));
+		}
+		sHeader = Format("{\"status\": \"%s\", \"time_us\": %llu%s}\n", bResult ? "ok" : "error", static_cast<unsigned long long>(uTime), sHeader.c_str());
+		u32 uResponseSize = static_cast<u32>(sHeader.size() + vBody.size());
+		vResponse.resize(4 + uResponseSize);
+		for (n32 i = 0; i < 4; i++)
+		{
+			vResponse[i] = static_cast<u8>(uResponseSize >> (i * 8));
+		}
+		memcpy(&*vResponse.begin() + 4, sHeader.c_str(), sHeader.size());
+		if (!vBody.empty())
+		{
+			memcpy(&*vResponse.begin() + 4 + sHeader.size(), &*vBody.begin(), vBody.size());
+		}
+		if (!writeFull(a_nSocket, &*vResponse.begin(), vResponse.size()))
+		{
+			break;
+		}
+		if (bResult && vArgument[0] == "stop")
+		{
+			// the reply is out, the accept loop is woken up by a connection of its own
+			wake();
+		}
+	}
+	close(a_nSocket);
+	lock_guard<mutex> lock(m_ConnectionMutex);
+	m_sConnection.erase(a_nSocket);
+	m_ConnectionCondition.notify_all();
+}
+
+void CServer::wake()
+{
+	n32 nSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (nSocket < 0)
+	{
+		return;
+	}
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	string sSocketName = UToA(m_sSocketName);
+	memcpy(address.sun_path, sSocketName.c_str(), sSocketName.size());
+	connect(nSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	close(nSocket);
+}
+
+// a_sHeader gets the extra header fields, each one starting with ", "
+bool CServer::handle(const vector<string>& a_vArgument, string& a_sHeader, vector<u8>& a_vBody)
+{
+	const string sCommand = a_vArgument.empty() ? "" : a_vArgument[0];
+	if (sCommand == "info" && a_vArgument.size() == 2)
+	{
+		UString sInfo;
+		if (!CGxt::GetInfo(AToU(a_vArgument[1]), sInfo))
+		{
+			a_sHeader = ", \"message\": \"info failed\"";
+			return false;
+		}
+		string sBody = UToA(sInfo);
+		a_vBody.assign(sBody.begin(), sBody.end());
+		return true;
+	}
+	if (sCommand == "export" && (a_vArgument.size() == 3 || a_vArgument.size() == 4))
+	{
+		CGxt gxt;
+		gxt.SetFileName(AToU(a_vArgument[1]));
+		gxt.SetDirName(AToU(a_vArgument[2]));
+		if (a_vArgument.size() == 4)
+		{
+			static const char* const c_pFormat[] = { "png", "dds", "ktx", "pvr", "raw" };
+			static const CGxt::EFormat c_eFormat[] = { CGxt::kFormatPng, CGxt::kFormatDds, CGxt::kFormatKtx, CGxt::kFormatPvr, CGxt::kFormatRaw };
+			n32 nFormat = -1;
+			for (n32 i = 0; i < static_cast<n32>(SDW_ARRAY_COUNT(c_pFormat)); i++)
+			{
+				if (a_vArgument[3] == c_pFormat[i])
+				{
+					nFormat = i;
+				}
+			}
+			if (nFormat < 0)
+			{
+				a_sHeader = ", \"message\": \"unknown format\"";
+				return false;
+			}
+			gxt.SetFormat(c_eFormat[nFormat]);
+		}
+		if (!CGxt::IsGxtFile(AToU(a_vArgument[1])) || !gxt.ExportFile())
+		{
+			a_sHeader = ", \"message\": \"export failed\"";
+			return false;
+		}
+		return true;
+	}
+	if (sCommand == "thumbnail" || sCommand == "rect")
+	{
+		return handleImage(a_vArgument, a_sHeader, a_vBody);
+	}
+	if (sCommand == "stop" && a_vArgument.size() == 1)
+	{
+		m_bStop = true;
+		return true;
+	}
+	a_sHeader = ", \"message\": \"unknown request\"";
+	return false;
+}
+
+// thumbnail file texture size [shm], rect file texture x y width height [shm],
+// the body is rgba8 rows, or it is left in a shared memory object the client unlinks
+bool CServer::handleImage(const vector<string>& a_vArgument, string& a_sHeader, vector<u8>& a_vBody)
+{
+	bool bThumbnail = a_vArgument[0] == "thumbnail";
+	u32 uArgumentCount = bThumbnail ? 4 : 7;
+	bool bShm = a_vArgument.size() == uArgumentCount + 1 && a_vArgument.back() == "shm";
+	if (a_vArgument.size() != uArgumentCount && !bShm)
+	{
+		a_sHeader = ", \"message\": \"wrong arguments\"";
+		return false;
+	}
+	for (u32 i = 2; i < uArgumentCount; i++)
+	{
+		if (a_vArgument[i].empty() || a_vArgument[i].find_first_not_of("0123456789") != string::npos)
+		{
+			a_sHeader = ", \"message\": \"wrong arguments\"";
+			return false;
+		}
+	}
+	string sError;
+	shared_ptr<CGxt> pGxt = loadGxt(a_vArgument[1], sError);
+	if (!pGxt)
+	{
+		a_sHeader = Format(", \"message\": \"%s\"", escape(sError).c_str());
+		return false;
+	}
+	u32 uIndex = SToU32(a_vArgument[2]);
+	u32 uWidth = 0;
+	u32 uHeight = 0;
+	bool bResult = bThumbnail ? pGxt->GetThumbnail(uIndex, SToU32(a_vArgument[3]), a_vBody, uWidth, uHeight) : pGxt->GetRect(uIndex, 0, SToU32(a_vArgument[3]), SToU32(a_vArgument[4]), SToU32(a_vArgument[5]), SToU32(a_vArgument[6]), a_vBody, uWidth, uHeight);
+	if (!bResult)
+	{
+		a_vBody.clear();
+		a_sHeader = Format(", \"message\": \"%s failed\"", a_vArgument[0].c_str());
+		return false;
+	}
+	a_sHeader = Format(", \"width\": %u, \"height\": %u, \"size\": %u", uWidth, uHeight, static_cast<u32>(a_vBody.size()));
+	if (bShm)
+	{
+		string sShmName;
+		if (!putShm(a_vBody, sShmName))
+		{
+			a_vBody.clear();
+			a_sHeader = ", \"message\": \"shared memory failed\"";
+			return false;
+		}
+		a_vBody.clear();
+		a_sHeader += Format(", \"shm\": \"%s\"", sShmName.c_str());
+	}
+	return true;
+}
+
+// files are parsed once and reused until their size or modify time changes
+shared_ptr<CGxt> CServer::loadGxt(const string& a_sFileName, string& a_sError)
+{
+	struct stat st;
+	if (stat(a_sFileName.c_str(), &st) != 0)
+	{
+		a_sError = "open " + a_sFileName + " failed";
+		return shared_ptr<CGxt>();
+	}
+	unique_lock<mutex> lock(m_CacheMutex);
+	map<string, SCacheEntry>::iterator it = m_mCache.find(a_sFileName);
+	if (it != m_mCache.end() && it->second.ModifyTime == st.st_mtime && it->second.Size == static_cast<u64>(st.st_size))
+	{
+		it->second.LastUse = ++m_uCacheTick;
+		return it->second.Gxt;
+	}
+	lock.unlock();
+	FILE* fp = fopen(a_sFileName.c_str(), "rb");
+	if (fp == nullptr)
+	{
+		a_sError = "open " + a_sFileName + " failed";
+		return shared_ptr<CGxt>();
+	}
+	vector<u8> vGxt(static_cast<size_t>(st.st_size));
+	bool bResult = !vGxt.empty() && fread(&*vGxt.begin(), 1, vGxt.size(), fp) == vGxt.size();
+	fclose(fp);
+	shared_ptr<CGxt> pGxt = make_shared<CGxt>();
+	if (!bResult || vGxt.size() > UINT32_MAX || !pGxt->ParseBuffer(&*vGxt.begin(), static_cast<u32>(vGxt.size())))
+	{
+		a_sError = a_sFileName + " is not a gxt file";
+		return shared_ptr<CGxt>();
+	}
+	lock.lock();
+	SCacheEntry& entry = m_mCache[a_sFileName];
+	entry.Gxt = pGxt;
+	entry.ModifyTime = st.st_mtime;
+	entry.Size = st.st_size;
+	entry.LastUse = ++m_uCacheTick;
+	if (m_mCache.size() > s_uCacheCount)
+	{
+		map<string, SCacheEntry>::iterator itOldest = m_mCache.begin();
+		for (it = m_mCache.begin(); it != m_mCache.end(); ++it)
+		{
+			if (it->second.LastUse < itOldest->second.LastUse)
+			{
+				itOldest = it;
+			}
+		}
+		m_mCache.erase(itOldest);
+	}
+	return pGxt;
+}
+
+bool CServer::putShm(const vector<u8>& a_vData, string& a_sShmName)
+{
+	a_sShmName = Format("/gxttool.%d.%u", static_cast<n32>(getpid()), m_uShmSerial++);
+	n32 nFd = shm_open(a_sShmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (nFd < 0)
+	{
+		return false;
+	}
+	bool bResult = ftruncate(nFd, a_vData.size()) == 0;
+	if (bResult && !a_vData.empty())
+	{
+		void* pData = mmap(nullptr, a_vData.size(), PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+		bResult = pData != MAP_FAILED;
+		if (bResult)
+		{
+			memcpy(pData, &*a_vData.begin(), a_vData.size());
+			munmap(pData, a_vData.size());
+		}
+	}
+	close(nFd);
+	if (!bResult)
+	{
+		shm_unlink(a_sShmName.c_str());
+	}
+	return bResult;
+}
+
+bool CServer::readFull(n32 a_nSocket, void* a_pData, size_t a_uSize)
+{
+	u8* pData = static_cast<u8*>(a_pData);
+	while (a_uSize != 0)
+	{
+		ssize_t nSize = read(a_nSocket, pData, a_uSize);
+		if (nSize <= 0)
+		{
+			return false;
+		}
+		pData += nSize;
+		a_uSize -= nSize;
+	}
+	return true;
+}
+
+bool CServer::writeFull(n32 a_nSocket, const void* a_pData, size_t a_uSize)
+{
+	const u8* pData = static_cast<const u8*>(a_pData);
+	while (a_uSize != 0)
+	{
+		ssize_t nSize = write(a_nSocket, pData, a_uSize);
+		if (nSize <= 0)
+		{
+			return false;
+		}
+		pData += nSize;
+		a_uSize -= nSize;
+	}
+	return true;
+}
+#else
+bool CServer::Run()
+{
+	UPrintf(USTR("ERROR: serve is not supported on this platform\n\n"));
+	return false;
+}
+#endif
+
+void CServer::acquireJob()
+{
+	unique_lock<mutex> lock(m_JobMutex);
+	m_JobCondition.wait(lock, [this]() { return m_uActiveJobCount < m_uJobCount; });
+	m_uActiveJobCount++;
+}
+
+void CServer::releaseJob()
+{
+	lock_guard<mutex> lock(m_JobMutex);
+	m_uActiveJobCount--;
+	m_JobCondition.notify_one();
+}
+
+void CServer::split(const string& a_sRequest, vector<string>& a_vArgument)
+{
+	a_vArgument.clear();
+	string::size_type uPos = 0;
+	while (uPos <= a_sRequest.size() && !a_sRequest.empty())
+	{
+		string::size_type uEnd = a_sRequest.find('\n', uPos);
+		if (uEnd == string::npos)
+		{
+			uEnd = a_sRequest.size();
+		}
+		a_vArgument.push_back(a_sRequest.substr(uPos, uEnd - uPos));
+		uPos = uEnd + 1;
+	}
+}
+
+string CServer::escape(const string& a_sText)
+{
+	string sText;
+	for (string::const_iterator it = a_sText.begin(); it != a_sText.end(); ++it)
+	{
+		if (*it == '\\' || *it == '"')
+		{
+			sText += '\\';
+		}
+		else if (static_cast<u8>(*it) < 0x20)
+		{
+			sText += Format("\\u%04X", static_cast<u8>(*it));
+			continue;
+		}
+		sText += *it;
+	}
+	return sText;
+}
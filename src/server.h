@@ -0,0 +1,60 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <sdw.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "gxt.h"
+
+class CServer
+{
+public:
+	CServer();
+	~CServer();
+	void SetSocketName(const UString& a_sSocketName);
+	void SetJobCount(u32 a_uJobCount);
+	void SetVerbose(bool a_bVerbose);
+	bool Run();
+private:
+	struct SCacheEntry
+	{
+		shared_ptr<CGxt> Gxt;
+		n64 ModifyTime;
+		u64 Size;
+		u64 LastUse;
+	};
+	void serve(n32 a_nSocket);
+	void wake();
+	bool handle(const vector<string>& a_vArgument, string& a_sHeader, vector<u8>& a_vBody);
+	bool handleImage(const vector<string>& a_vArgument, string& a_sHeader, vector<u8>& a_vBody);
+	shared_ptr<CGxt> loadGxt(const string& a_sFileName, string& a_sError);
+	bool putShm(const vector<u8>& a_vData, string& a_sShmName);
+	void acquireJob();
+	void releaseJob();
+	static bool readFull(n32 a_nSocket, void* a_pData, size_t a_uSize);
+	static bool writeFull(n32 a_nSocket, const void* a_pData, size_t a_uSize);
+	static void split(const string& a_sRequest, vector<string>& a_vArgument);
+	static string escape(const string& a_sText);
+	UString m_sSocketName;
+	u32 m_uJobCount;
+	bool m_bVerbose;
+	n32 m_nListenSocket;
+	atomic<bool> m_bStop;
+	atomic<u32> m_uShmSerial;
+	mutex m_JobMutex;
+	condition_variable m_JobCondition;
+	u32 m_uActiveJobCount;
+	mutex m_ConnectionMutex;
+	condition_variable m_ConnectionCondition;
+	set<n32> m_sConnection;
+	mutex m_CacheMutex;
+	map<string, SCacheEntry> m_mCache;
+	u64 m_uCacheTick;
+	static const u32 s_uCacheCount;
+	static const u32 s_uMaxRequestSize;
+	static const u32 s_uAcceptRetryDelay;
+};
+
+#endif	// SERVER_H_
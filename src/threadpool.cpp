@@ -0,0 +1,153 @@
+#include "threadpool.h"
+
+u32 CThreadPool::s_uThreadCount = 0;
+
+// greater than 0 while the thread runs a task of a parallel loop
+static thread_local u32 s_uDepth = 0;
+
+CThreadPool::CThreadPool()
+	: m_bStop(false)
+{
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_Mutex);
+		m_bStop = true;
+	}
+	m_WorkCondition.notify_all();
+	for (vector<thread>::iterator it = m_vThread.begin(); it != m_vThread.end(); ++it)
+	{
+		it->join();
+	}
+}
+
+void CThreadPool::SetThreadCount(u32 a_uThreadCount)
+{
+	s_uThreadCount = a_uThreadCount;
+}
+
+u32 CThreadPool::GetThreadCount()
+{
+	if (s_uThreadCount != 0)
+	{
+		return s_uThreadCount;
+	}
+	u32 uThreadCount = thread::hardware_concurrency();
+	return uThreadCount != 0 ? uThreadCount : 1;
+}
+
+void CThreadPool::ParallelFor(u32 a_uCount, const function<void(u32)>& a_fTask)
+{
+	u32 uThreadCount = std::min<u32>(GetThreadCount(), a_uCount);
+	// nested calls run on the calling thread so that the outer loop owns all workers,
+	// unrelated threads calling at the same time share the workers
+	if (uThreadCount <= 1 || s_uDepth != 0)
+	{
+		for (u32 i = 0; i < a_uCount; i++)
+		{
+			a_fTask(i);
+		}
+		return;
+	}
+	getInstance().run(a_uCount, a_fTask, uThreadCount - 1);
+}
+
+CThreadPool& CThreadPool::getInstance()
+{
+	static CThreadPool s_ThreadPool;
+	return s_ThreadPool;
+}
+
+void CThreadPool::run(u32 a_uCount, const function<void(u32)>& a_fTask, u32 a_uHelperCount)
+{
+	SJob job = { &a_fTask, a_uCount, 0, 0, 0, a_uHelperCount, exception_ptr() };
+	s_uDepth++;
+	{
+		unique_lock<mutex> lock(m_Mutex);
+		// workers are started once and kept for the next loops
+		while (m_vThread.size() < a_uHelperCount)
+		{
+			m_vThread.push_back(thread(&CThreadPool::work, this));
+		}
+		m_lJob.push_back(&job);
+		m_WorkCondition.notify_all();
+		while (runNext(job, lock))
+		{
+		}
+		m_DoneCondition.wait(lock, [&job]() { return job.Done == job.Count; });
+	}
+	s_uDepth--;
+	if (job.Exception)
+	{
+		rethrow_exception(job.Exception);
+	}
+}
+
+void CThreadPool::work()
+{
+	s_uDepth = 1;
+	unique_lock<mutex> lock(m_Mutex);
+	while (!m_bStop)
+	{
+		SJob* pJob = nullptr;
+		for (list<SJob*>::iterator it = m_lJob.begin(); it != m_lJob.end(); ++it)
+		{
+			if ((*it)->HelperCount < (*it)->MaxHelperCount)
+			{
+				pJob = *it;
+				break;
+			}
+		}
+		if (pJob == nullptr)
+		{
+			m_WorkCondition.wait(lock);
+			continue;
+		}
+		pJob->HelperCount++;
+		while (runNext(*pJob, lock))
+		{
+		}
+	}
+}
+
+// called with the lock held, the task itself runs unlocked
+bool CThreadPool::runNext(SJob& a_Job, unique_lock<mutex>& a_Lock)
+{
+	if (a_Job.Next >= a_Job.Count)
+	{
+		return false;
+	}
+	u32 uIndex = a_Job.Next++;
+	if (a_Job.Next == a_Job.Count)
+	{
+		m_lJob.remove(&a_Job);
+	}
+	a_Lock.unlock();
+	exception_ptr pException;
+	try
+	{
+		(*a_Job.Task)(uIndex);
+	}
+	catch (...)
+	{
+		pException = current_exception();
+	}
+	a_Lock.lock();
+	if (pException && !a_Job.Exception)
+	{
+		// the first failure stops handing out tasks, the caller rethrows it
+		a_Job.Exception = pException;
+		if (a_Job.Next < a_Job.Count)
+		{
+			a_Job.Count = a_Job.Next;
+			m_lJob.remove(&a_Job);
+		}
+	}
+	if (++a_Job.Done == a_Job.Count)
+	{
+		m_DoneCondition.notify_all();
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <sdw.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+
+class CThreadPool
+{
+public:
+	static void SetThreadCount(u32 a_uThreadCount);
+	static u32 GetThreadCount();
+	static void ParallelFor(u32 a_uCount, const function<void(u32)>& a_fTask);
+private:
+	struct SJob
+	{
+		const function<void(u32)>* Task;
+		u32 Count;
+		u32 Next;
+		u32 Done;
+		u32 HelperCount;
+		u32 MaxHelperCount;
+		exception_ptr Exception;
+	};
+	CThreadPool();
+	~CThreadPool();
+	static CThreadPool& getInstance();
+	void run(u32 a_uCount, const function<void(u32)>& a_fTask, u32 a_uHelperCount);
+	void work();
+	bool runNext(SJob& a_Job, unique_lock<mutex>& a_Lock);
+	mutex m_Mutex;
+	condition_variable m_WorkCondition;
+	condition_variable m_DoneCondition;
+	vector<thread> m_vThread;
+	list<SJob*> m_lJob;
+	bool m_bStop;
+	static u32 s_uThreadCount;
+};
+
+#endif	// THREADPOOL_H_